@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <QtEndian>
+#include "logsbinary.h"
+
+/*
+ * Binary logs written by the radio when built with LOGS_BINARY (see radio/src/logs.cpp).
+ * They are converted to the same rows than the CSV logs.
+ */
+enum LogsBinaryColumnType {
+  LOGS_BINARY_COLUMN_INT8,
+  LOGS_BINARY_COLUMN_INT16,
+  LOGS_BINARY_COLUMN_INT32,
+  LOGS_BINARY_COLUMN_GPS,
+  LOGS_BINARY_COLUMN_DATETIME,
+  LOGS_BINARY_COLUMN_BITS64,
+};
+
+struct LogsBinaryColumn {
+  int type;
+  int prec;
+};
+
+QString formatLogsBinaryValue(qint32 value, int prec)
+{
+  if (prec == 0) {
+    return QString::number(value);
+  }
+  qint64 divisor = 1;
+  for (int i=0; i<prec; i++) {
+    divisor *= 10;
+  }
+  qint64 absolute = qAbs((qint64)value);
+  return QString("%1%2.%3").arg(value < 0 ? "-" : "").arg(absolute / divisor).arg(absolute % divisor, prec, 10, QChar('0'));
+}
+
+QString formatLogsBinaryColumn(const LogsBinaryColumn & column, const uchar * data)
+{
+  switch (column.type) {
+    case LOGS_BINARY_COLUMN_INT8:
+      return formatLogsBinaryValue((qint8)data[0], column.prec);
+    case LOGS_BINARY_COLUMN_INT16:
+      return formatLogsBinaryValue(qFromLittleEndian<qint16>(data), column.prec);
+    case LOGS_BINARY_COLUMN_INT32:
+      return formatLogsBinaryValue(qFromLittleEndian<qint32>(data), column.prec);
+    case LOGS_BINARY_COLUMN_GPS:
+    {
+      qint32 latitude = qFromLittleEndian<qint32>(data);
+      qint32 longitude = qFromLittleEndian<qint32>(data + 4);
+      if (!latitude || !longitude)
+        return QString();
+      return formatLogsBinaryValue(latitude, 6) + " " + formatLogsBinaryValue(longitude, 6);
+    }
+    case LOGS_BINARY_COLUMN_DATETIME:
+      return QString("%1-%2-%3 %4:%5:%6").arg(qFromLittleEndian<quint16>(data), 4, 10, QChar('0')).arg(data[2], 2, 10, QChar('0')).arg(data[3], 2, 10, QChar('0'))
+                                         .arg(data[4], 2, 10, QChar('0')).arg(data[5], 2, 10, QChar('0')).arg(data[6], 2, 10, QChar('0'));
+    case LOGS_BINARY_COLUMN_BITS64:
+      return "0x" + QString("%1%2").arg(qFromLittleEndian<quint32>(data + 4), 8, 16, QChar('0')).arg(qFromLittleEndian<quint32>(data), 8, 16, QChar('0')).toUpper();
+    default:
+      return QString();
+  }
+}
+
+int getLogsBinaryColumnSize(int type)
+{
+  switch (type) {
+    case LOGS_BINARY_COLUMN_INT8:
+      return 1;
+    case LOGS_BINARY_COLUMN_INT16:
+      return 2;
+    case LOGS_BINARY_COLUMN_INT32:
+      return 4;
+    default:
+      return 8;
+  }
+}
+
+// returns the size of the session header at pos (with its columns), 0 if there is no valid header there
+static int parseLogsBinaryHeader(const QByteArray & buffer, int pos, QStringList & labels, QList<LogsBinaryColumn> & columns)
+{
+  const uchar * data = (const uchar *)buffer.constData();
+  int size = buffer.size();
+
+  if (pos + LOGS_BINARY_HEADER_SIZE > size || buffer.mid(pos, 4) != LOGS_BINARY_MAGIC) {
+    return 0;
+  }
+
+  int version = data[pos+4];
+  int columnsCount = data[pos+5];
+  int recordSize = qFromLittleEndian<quint16>(data + pos + 6);
+  int headerSize = LOGS_BINARY_HEADER_SIZE + columnsCount * LOGS_BINARY_COLUMN_SIZE;
+
+  if (version != LOGS_BINARY_VERSION || pos + headerSize > size) {
+    return 0;
+  }
+
+  labels.clear();
+  labels << "Date" << "Time";
+  columns.clear();
+  int expectedRecordSize = 4;
+  const uchar * column = data + pos + LOGS_BINARY_HEADER_SIZE;
+  for (int i=0; i<columnsCount; i++, column+=LOGS_BINARY_COLUMN_SIZE) {
+    const char * label = (const char *)column;
+    labels << QString::fromLatin1(label, qstrnlen(label, LOGS_BINARY_LABEL_LEN));
+    LogsBinaryColumn value;
+    value.type = column[LOGS_BINARY_LABEL_LEN];
+    value.prec = column[LOGS_BINARY_LABEL_LEN + 1];
+    columns.append(value);
+    expectedRecordSize += getLogsBinaryColumnSize(value.type);
+  }
+
+  if (recordSize != expectedRecordSize) {
+    return 0;
+  }
+
+  return headerSize;
+}
+
+// returns the position of the next valid session header after pos, or the buffer size
+static int findLogsBinaryHeader(const QByteArray & buffer, int pos)
+{
+  QStringList labels;
+  QList<LogsBinaryColumn> columns;
+
+  while ((pos = buffer.indexOf(LOGS_BINARY_MAGIC, pos)) >= 0) {
+    if (parseLogsBinaryHeader(buffer, pos, labels, columns)) {
+      return pos;
+    }
+    pos += 1;
+  }
+
+  return buffer.size();
+}
+
+int parseLogsBinary(const QByteArray & buffer, QList<QStringList> & csvlog)
+{
+  const uchar * data = (const uchar *)buffer.constData();
+  int errors = 0;
+
+  // Sessions are appended to the same file and padded up to the end of their last sector when closed.
+  // A session interrupted by a power loss has no padding, so the next one is searched by its header
+  // instead of relying on the sectors alignment.
+  int pos = findLogsBinaryHeader(buffer, 0);
+  while (pos < buffer.size()) {
+    QStringList labels;
+    QList<LogsBinaryColumn> columns;
+    int headerSize = parseLogsBinaryHeader(buffer, pos, labels, columns);
+    QDateTime start = QDateTime::fromTime_t(qFromLittleEndian<quint32>(data + pos + 8), Qt::UTC);
+    int recordSize = qFromLittleEndian<quint16>(data + pos + 6);
+    int end = findLogsBinaryHeader(buffer, pos + headerSize);
+    pos += headerSize;
+
+    // only the sessions with the same columns than the first one are imported
+    if (csvlog.isEmpty()) {
+      csvlog.append(labels);
+    }
+    bool sameColumns = (csvlog.at(0) == labels);
+
+    while (pos + recordSize <= end) {
+      const uchar * record = data + pos;
+      quint32 time = qFromLittleEndian<quint32>(record);
+      if (time == 0xFFFFFFFF) {
+        break; // padding at the end of the session
+      }
+      pos += recordSize;
+
+      if (!sameColumns) {
+        errors++;
+        continue;
+      }
+
+      QDateTime timestamp = start.addMSecs((qint64)time * 10);
+      QStringList row;
+      row << timestamp.toString("yyyy-MM-dd") << timestamp.toString("HH:mm:ss.zzz");
+      int offset = 4;
+      foreach (const LogsBinaryColumn & column, columns) {
+        row << formatLogsBinaryColumn(column, record + offset);
+        offset += getLogsBinaryColumnSize(column.type);
+      }
+      csvlog.append(row);
+    }
+
+    // anything else than the padding left before the next session is a record truncated by a power loss
+    while (pos < end) {
+      if (data[pos++] != 0xFF) {
+        errors++;
+        break;
+      }
+    }
+
+    pos = end;
+  }
+
+  return errors;
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _LOGSBINARY_H_
+#define _LOGSBINARY_H_
+
+#include <QtCore>
+
+#define LOGS_BINARY_MAGIC        "OTXL"
+#define LOGS_BINARY_VERSION      1
+#define LOGS_BINARY_HEADER_SIZE  12
+#define LOGS_BINARY_LABEL_LEN    12
+#define LOGS_BINARY_COLUMN_SIZE  (LOGS_BINARY_LABEL_LEN + 2)
+
+// converts the sessions of a binary log to the same rows than the CSV logs (header first)
+// returns the number of records which could not be imported
+int parseLogsBinary(const QByteArray & buffer, QList<QStringList> & csvlog);
+
+#endif // _LOGSBINARY_H_
@@ -20,6 +20,7 @@
 
 #include <math.h>
 #include "logsdialog.h"
+#include "logsbinary.h"
 #include "appdata.h"
 #include "ui_logsdialog.h"
 #include "helpers.h"
@@ -616,9 +617,16 @@ bool LogsDialog::cvsFileParse()
   int errors=0;
   int lines=-1;
 
-  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) { // reading HEX TEXT file
+  if (!file.open(QIODevice::ReadOnly)) {
     return false;
   }
+  else if (file.peek(4) == LOGS_BINARY_MAGIC) {
+    csvlog.clear();
+    logFilename.clear();
+    errors = binaryFileParse(file);
+    lines = qMax(0, csvlog.count() - 1) + errors;
+    logFilename = QFileInfo(file.fileName()).baseName();
+  }
   else {
     csvlog.clear();
     logFilename.clear();
@@ -657,7 +665,7 @@ bool LogsDialog::cvsFileParse()
   }
 
   int n = csvlog.count();
-  if (n == 1) {
+  if (n <= 1) {
     csvlog.clear();
     return false;
   }
@@ -669,6 +677,12 @@ bool LogsDialog::cvsFileParse()
   return true;
 }
 
+// returns the number of records which could not be imported
+int LogsDialog::binaryFileParse(QFile & file)
+{
+  return parseLogsBinary(file.readAll(), csvlog);
+}
+
 struct FlightSession {
   QDateTime start;
   QDateTime end;
@@ -24,13 +24,261 @@
 #include "bin_allocator.h"
 
 
+SlabAllocator::SlabAllocator():
+  Arena(NULL),
+  FirstFreePage(SLAB_NONE),
+  ArenaFailed(false)
+{
+  memclear(Pages, sizeof(Pages));
+  memclear(&Stats, sizeof(Stats));
+  for (int i=0; i<SLAB_CLASSES; i++) {
+    FirstPartialPage[i] = SLAB_NONE;
+  }
+}
+
+void SlabAllocator::init()
+{
+  Arena = (uint8_t *)::malloc(SLAB_PAGES * SLAB_PAGE_SIZE);
+  if (!Arena) {
+    TRACE("SlabAllocator: arena allocation failed");
+    ArenaFailed = true;
+    return;
+  }
+  for (int page=0; page<SLAB_PAGES; page++) {
+    Pages[page].next = (page < SLAB_PAGES-1 ? page+1 : SLAB_NONE);
+  }
+  FirstFreePage = 0;
+  Stats.pages = Stats.freePages = SLAB_PAGES;
+}
+
+void SlabAllocator::release()
+{
+  if (Arena && Stats.freePages == Stats.pages) {
+    ::free(Arena);
+    Arena = NULL;
+    FirstFreePage = SLAB_NONE;
+    Stats.pages = Stats.freePages = 0;
+  }
+  // the arena will be allocated again at the next small block
+  ArenaFailed = false;
+}
+
+int SlabAllocator::getClass(size_t size)
+{
+  int sizeClass = 0;
+  while (getClassSize(sizeClass) < size) {
+    sizeClass++;
+  }
+  return sizeClass;
+}
+
+bool SlabAllocator::is_member(void * ptr) const
+{
+  return Arena && (uint8_t *)ptr >= Arena && (uint8_t *)ptr < Arena + SLAB_PAGES * SLAB_PAGE_SIZE;
+}
+
+size_t SlabAllocator::block_size(void * ptr) const
+{
+  if (!is_member(ptr)) {
+    return 0;
+  }
+  return getClassSize(Pages[((uint8_t *)ptr - Arena) / SLAB_PAGE_SIZE].sizeClass);
+}
+
+void SlabAllocator::linkPartialPage(uint16_t page)
+{
+  Page & p = Pages[page];
+  p.prev = SLAB_NONE;
+  p.next = FirstPartialPage[p.sizeClass];
+  if (p.next != SLAB_NONE) {
+    Pages[p.next].prev = page;
+  }
+  FirstPartialPage[p.sizeClass] = page;
+}
+
+void SlabAllocator::unlinkPartialPage(uint16_t page)
+{
+  Page & p = Pages[page];
+  if (p.prev != SLAB_NONE)
+    Pages[p.prev].next = p.next;
+  else
+    FirstPartialPage[p.sizeClass] = p.next;
+  if (p.next != SLAB_NONE) {
+    Pages[p.next].prev = p.prev;
+  }
+}
+
+void * SlabAllocator::allocBlock(int sizeClass)
+{
+  uint16_t page = FirstPartialPage[sizeClass];
+  if (page == SLAB_NONE) {
+    page = FirstFreePage;
+    if (page == SLAB_NONE) {
+      return NULL;
+    }
+    Page & p = Pages[page];
+    FirstFreePage = p.next;
+    p.sizeClass = sizeClass;
+    p.used = 0;
+    p.allocated = 0;
+    p.firstFree = SLAB_NONE;
+    linkPartialPage(page);
+    Stats.freePages--;
+    Stats.classes[sizeClass].pages++;
+  }
+
+  Page & p = Pages[page];
+  uint8_t * block;
+  if (p.firstFree != SLAB_NONE) {
+    block = Arena + page * SLAB_PAGE_SIZE + p.firstFree * getClassSize(sizeClass);
+    memcpy(&p.firstFree, block, sizeof(p.firstFree));
+  }
+  else {
+    block = Arena + page * SLAB_PAGE_SIZE + p.allocated++ * getClassSize(sizeClass);
+  }
+  if (++p.used == SLAB_PAGE_SIZE / getClassSize(sizeClass)) {
+    // full pages aren't in any list
+    unlinkPartialPage(page);
+  }
+  Stats.classes[sizeClass].blocks++;
+  return block;
+}
+
+void SlabAllocator::freeBlock(void * ptr)
+{
+  uint32_t offset = (uint8_t *)ptr - Arena;
+  uint16_t page = offset / SLAB_PAGE_SIZE;
+  Page & p = Pages[page];
+  uint16_t block = (offset % SLAB_PAGE_SIZE) / getClassSize(p.sizeClass);
+  bool full = (p.used == SLAB_PAGE_SIZE / getClassSize(p.sizeClass));
+
+  memcpy(ptr, &p.firstFree, sizeof(p.firstFree));
+  p.firstFree = block;
+  Stats.classes[p.sizeClass].blocks--;
+
+  if (--p.used == 0) {
+    // empty pages go back to the free pages, they may be used for another class
+    if (!full) {
+      unlinkPartialPage(page);
+    }
+    Stats.classes[p.sizeClass].pages--;
+    Stats.freePages++;
+    p.next = FirstFreePage;
+    FirstFreePage = page;
+  }
+  else if (full) {
+    linkPartialPage(page);
+  }
+}
+
+void * SlabAllocator::malloc(size_t size)
+{
+  if (size <= SLAB_MAX_SIZE) {
+    if (!Arena && !ArenaFailed) {
+      init();
+    }
+    if (Arena) {
+      int sizeClass = getClass(size);
+      void * res = allocBlock(sizeClass);
+      if (res) {
+        Stats.classes[sizeClass].requested += size;
+        return res;
+      }
+    }
+    Stats.failures++;
+  }
+  void * res = ::malloc(size);
+  if (res) {
+    Stats.heapBytes += size;
+  }
+  return res;
+}
+
+void SlabAllocator::free(void * ptr, size_t size)
+{
+  if (is_member(ptr)) {
+    Stats.classes[Pages[((uint8_t *)ptr - Arena) / SLAB_PAGE_SIZE].sizeClass].requested -= size;
+    freeBlock(ptr);
+  }
+  else if (ptr) {
+    Stats.heapBytes -= size;
+    ::free(ptr);
+  }
+}
+
+void * SlabAllocator::realloc(void * ptr, size_t osize, size_t nsize)
+{
+  if (!ptr) {
+    return malloc(nsize);
+  }
+
+  if (is_member(ptr)) {
+    int sizeClass = Pages[((uint8_t *)ptr - Arena) / SLAB_PAGE_SIZE].sizeClass;
+    if (getClass(nsize) == sizeClass) {
+      Stats.classes[sizeClass].requested += nsize - osize;
+      return ptr;
+    }
+  }
+  else if (nsize > SLAB_MAX_SIZE) {
+    // heap to heap
+    void * res = ::realloc(ptr, nsize);
+    if (res) {
+      Stats.heapBytes += nsize - osize;
+    }
+    return res;
+  }
+
+  void * res = malloc(nsize);
+  if (!res) {
+    if (nsize >= osize) {
+      return NULL;
+    }
+    // Lua expects that shrinking a block never fails, we keep it where it is
+    if (is_member(ptr)) {
+      Stats.classes[Pages[((uint8_t *)ptr - Arena) / SLAB_PAGE_SIZE].sizeClass].requested += nsize - osize;
+    }
+    else {
+      res = ::realloc(ptr, nsize);
+      if (res) {
+        ptr = res;
+      }
+      Stats.heapBytes += nsize - osize;
+    }
+    return ptr;
+  }
+  memcpy(res, ptr, min(osize, nsize));
+  free(ptr, osize);
+  return res;
+}
+
+unsigned int SlabAllocator::fragmentation(int sizeClass) const
+{
+  uint32_t size = Stats.classes[sizeClass].pages * SLAB_PAGE_SIZE;
+  if (size == 0) {
+    return 0;
+  }
+  return 100 - (Stats.classes[sizeClass].requested * 100) / size;
+}
+
+unsigned int SlabAllocator::fragmentation() const
+{
+  uint32_t size = 0, requested = 0;
+  for (int i=0; i<SLAB_CLASSES; i++) {
+    size += Stats.classes[i].pages * SLAB_PAGE_SIZE;
+    requested += Stats.classes[i].requested;
+  }
+  if (size == 0) {
+    return 0;
+  }
+  return 100 - (requested * 100) / size;
+}
+
+#if defined(USE_SLAB_ALLOCATOR)
+SlabAllocator slabAllocator;
+#else
 BinAllocator_slots1 slots1;
 BinAllocator_slots2 slots2;
 
-#if defined(DEBUG)
-int SimulateMallocFailure = 0;    //set this to simulate allocation failure
-#endif 
-
 bool bin_free(void * ptr)
 {
   //return TRUE if ours
@@ -43,60 +291,60 @@ void * bin_malloc(size_t size) {
   return res ? res : slots2.malloc(size);
 }
 
+// returns NULL only when there is no memory left, ptr is then kept
 void * bin_realloc(void * ptr, size_t size)
 {
   if (ptr == 0) {
     //no previous data, try our malloc
-    return bin_malloc(size);
+    void * res = bin_malloc(size);
+    return res ? res : malloc(size);
   }
-  else {
-    if (! (slots1.is_member(ptr) || slots2.is_member(ptr)) ) {
-      // not our data, leave it to libc realloc
-      return 0;
-    }
 
-    //we have existing data
-    // if it fits in current slot, return it
-    // TODO if new size is smaller, try to relocate in smaller slot
-    if ( slots1.can_fit(ptr, size) ) {
-      // TRACE("OUR realloc %p[%lu] fits in slot1", ptr, size);
-      return ptr;
-    }
-    if ( slots2.can_fit(ptr, size) ) {
-      // TRACE("OUR realloc %p[%lu] fits in slot2", ptr, size);
-      return ptr;
-    }
+  if (! (slots1.is_member(ptr) || slots2.is_member(ptr)) ) {
+    // not our data, leave it to libc realloc
+    return realloc(ptr, size);
+  }
 
-    //we need a bigger slot
-    void * res = bin_malloc(size);
+  //we have existing data
+  // if it fits in current slot, return it
+  if ( slots1.can_fit(ptr, size) || slots2.can_fit(ptr, size) ) {
+    return ptr;
+  }
+
+  //we need a bigger slot
+  void * res = bin_malloc(size);
+  if (res == 0) {
+    // we don't have the space, use libc malloc
+    res = malloc(size);
     if (res == 0) {
-      // we don't have the space, use libc malloc
-      // TRACE("bin_malloc [%lu] FAILURE", size);
-      res = malloc(size);
-      if (res == 0) {
-        TRACE("libc malloc [%lu] FAILURE", size);  
-        return 0;
-      }
+      TRACE("libc malloc [%lu] FAILURE", size);
+      return 0;
     }
-    //copy data
-    memcpy(res, ptr, slots1.size(ptr) + slots2.size(ptr));
-    bin_free(ptr);
-    return res;
   }
+  //copy data
+  memcpy(res, ptr, slots1.size(ptr) + slots2.size(ptr));
+  bin_free(ptr);
+  return res;
 }
+#endif
 
+#if defined(DEBUG)
+int SimulateMallocFailure = 0;    //set this to simulate allocation failure
+#endif 
 
 void *bin_l_alloc (void *ud, void *ptr, size_t osize, size_t nsize)
 {
-  (void)ud; (void)osize;  /* not used */
+  (void)ud;  /* not used */
   if (nsize == 0) {
-    if (ptr) {   // avoid a bunch of NULL pointer free calls
-      if (!bin_free(ptr)) {
-        // not our range, use libc allocator
-        // TRACE("libc free %p", ptr);
-        free(ptr);
-      }
+#if defined(USE_SLAB_ALLOCATOR)
+    // osize is the size of the block when ptr isn't NULL
+    slabAllocator.free(ptr, osize);
+#else
+    if (ptr && !bin_free(ptr)) {
+      // not our range, use libc allocator
+      free(ptr);
     }
+#endif
     return NULL;
   }
   else {
@@ -113,18 +361,18 @@ void *bin_l_alloc (void *ud, void *ptr, size_t osize, size_t nsize)
       return 0;
     }
 #endif // #if defined(DEBUG)
-    // try our allocator, if it fails use libc allocator
-    void * res = bin_realloc(ptr, nsize);
-    if (res && ptr) {
-      // TRACE("OUR realloc %p[%lu] -> %p[%lu]", ptr, osize, res, nsize); 
+    // when ptr is NULL, osize is the type of the new object, not a size
+    if (!ptr) {
+      osize = 0;
     }
-    if (res == 0) {
-      res = realloc(ptr, nsize);
-      // TRACE("libc realloc %p[%lu] -> %p[%lu]", ptr, osize, res, nsize);
-      // if (res == 0 ){
-      //   TRACE("realloc FAILURE %lu", nsize);
-      //   dumpFreeMemory();
-      // }
+#if defined(USE_SLAB_ALLOCATOR)
+    void * res = slabAllocator.realloc(ptr, osize, nsize);
+#else
+    void * res = bin_realloc(ptr, nsize);
+#endif
+    if (res && luaScriptStats && nsize > osize) {
+      // accounted to the script which is running
+      luaScriptStats->allocated += nsize - osize;
     }
     return res;
   }
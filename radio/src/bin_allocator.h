@@ -23,6 +23,14 @@
 
 #include "debug.h"
 
+struct BinAllocatorStats {
+  unsigned int used;
+  unsigned int maxUsed;           // high-water mark
+  unsigned int failures;          // allocations refused because all the bins were used
+};
+
+// The free bins are chained through their data (the index of the next free bin),
+// so that malloc() and free() don't have to search
 template <int SIZE_SLOT, int NUM_BINS> class BinAllocator {
 private:
   PACK(struct Bin {
@@ -31,22 +39,52 @@ private:
   });
   struct Bin Bins[NUM_BINS];
   int NoUsedBins;
+  int FirstFreeBin;
+  BinAllocatorStats Stats;
+
+  static_assert(SIZE_SLOT >= sizeof(int16_t), "BinAllocator slots too small for the free list");
+  static_assert(NUM_BINS <= 32767, "BinAllocator too many bins for the free list");
+
+  int16_t getNextFree(int n) const {
+    int16_t next;
+    memcpy(&next, Bins[n].data, sizeof(next));
+    return next;
+  }
+  void setNextFree(int n, int16_t next) {
+    memcpy(Bins[n].data, &next, sizeof(next));
+  }
+  // returns the bin index of ptr, -1 if ptr isn't the start of one of our bins
+  int index(void * ptr) const {
+    if (!is_member(ptr)) {
+      return -1;
+    }
+    size_t offset = (char *)ptr - Bins[0].data;
+    if (offset % sizeof(struct Bin) != 0) {
+      return -1;
+    }
+    return offset / sizeof(struct Bin);
+  }
 public:
-  BinAllocator() : NoUsedBins(0) {
+  BinAllocator() : NoUsedBins(0), FirstFreeBin(0) {
     memclear(Bins, sizeof(Bins));
+    memclear(&Stats, sizeof(Stats));
+    for (int n = 0; n < NUM_BINS; ++n) {
+      setNextFree(n, n < NUM_BINS-1 ? n+1 : -1);
+    }
   }
   bool free(void * ptr) {
-    for (size_t n = 0; n < NUM_BINS; ++n) {
-      if (ptr == Bins[n].data) {
-        Bins[n].Used = false;
-        --NoUsedBins;
-        // TRACE("\tBinAllocator<%d> free %lu ------", SIZE_SLOT, n);
-        return true;
-      }
+    int n = index(ptr);
+    if (n < 0 || !Bins[n].Used) {
+      return false;
     }
-    return false;
+    Bins[n].Used = false;
+    setNextFree(n, FirstFreeBin);
+    FirstFreeBin = n;
+    --NoUsedBins;
+    // TRACE("\tBinAllocator<%d> free %d ------", SIZE_SLOT, n);
+    return true;
   }
-  bool is_member(void * ptr) {
+  bool is_member(void * ptr) const {
     return (ptr >= Bins[0].data && ptr <= Bins[NUM_BINS-1].data);
   }
   void * malloc(size_t size) {
@@ -54,20 +92,19 @@ public:
       // TRACE("BinAllocator<%d> malloc [%lu] size > SIZE_SLOT", SIZE_SLOT, size);
       return 0;
     }
-    if (NoUsedBins >= NUM_BINS) {
+    if (FirstFreeBin < 0) {
       // TRACE("BinAllocator<%d> malloc [%lu] no free slots", SIZE_SLOT, size);
+      ++Stats.failures;
       return 0;
     }
-    for (size_t n = 0; n < NUM_BINS; ++n) {
-      if (!Bins[n].Used) {
-        Bins[n].Used = true;
-        ++NoUsedBins;
-        // TRACE("\tBinAllocator<%d> malloc %lu[%lu]", SIZE_SLOT, n, size);
-        return Bins[n].data;
-      }
+    int n = FirstFreeBin;
+    FirstFreeBin = getNextFree(n);
+    Bins[n].Used = true;
+    if (++NoUsedBins > (int)Stats.maxUsed) {
+      Stats.maxUsed = NoUsedBins;
     }
-    // TRACE("BinAllocator<%d> malloc [%lu] no free slots", SIZE_SLOT , size);
-    return 0;
+    // TRACE("\tBinAllocator<%d> malloc %d[%lu]", SIZE_SLOT, n, size);
+    return Bins[n].data;
   }
   size_t size(void * ptr) {
     return is_member(ptr) ? SIZE_SLOT : 0;
@@ -77,6 +114,88 @@ public:
   }
   unsigned int capacity() { return NUM_BINS; }
   unsigned int size() { return NoUsedBins; }
+  unsigned int slot_size() { return SIZE_SLOT; }
+  const BinAllocatorStats & stats() {
+    Stats.used = NoUsedBins;
+    return Stats;
+  }
+};
+
+/*
+ * Lua heap
+ *
+ * Small blocks (up to SLAB_MAX_SIZE) are rounded to a power of 2 size class and allocated in
+ * pages which only hold blocks of their class, so that the blocks which Lua allocates and
+ * frees all the time don't fragment the system heap. The pages are taken from an arena which
+ * is allocated on the system heap the first time it is needed, and given back when the Lua
+ * states are closed. Bigger blocks, and the blocks which don't fit when all the pages are
+ * used, go to the system heap.
+ */
+#define SLAB_CLASSES                   5    // 16, 32, 64, 128 and 256 bytes
+#define SLAB_MIN_SIZE                  16
+#define SLAB_MAX_SIZE                  (SLAB_MIN_SIZE << (SLAB_CLASSES-1))
+#define SLAB_NONE                      0xFFFF
+#if !defined(SLAB_PAGES)
+  // the arena size is set by the target CMakeLists.txt
+  #define SLAB_PAGE_SIZE               1024
+  #define SLAB_PAGES                   24
+#endif
+
+struct SlabClassStats {
+  uint16_t pages;
+  uint32_t blocks;                // blocks allocated
+  uint32_t requested;             // bytes requested for these blocks
+};
+
+struct SlabAllocatorStats {
+  uint16_t pages;                 // arena size, 0 if the arena couldn't be allocated
+  uint16_t freePages;
+  SlabClassStats classes[SLAB_CLASSES];
+  uint32_t heapBytes;             // bytes which went to the system heap
+  uint32_t failures;              // blocks which went to the system heap because all the pages were used
+};
+
+class SlabAllocator {
+  public:
+    SlabAllocator();
+    ~SlabAllocator() { ::free(Arena); }
+    static unsigned int class_size(int sizeClass) { return getClassSize(sizeClass); }
+    // size is the size which was requested for ptr, it is only used for the statistics
+    void * malloc(size_t size);
+    void * realloc(void * ptr, size_t osize, size_t nsize);
+    void free(void * ptr, size_t size);
+    bool is_member(void * ptr) const;
+    size_t block_size(void * ptr) const;
+    const SlabAllocatorStats & stats() const { return Stats; }
+    // gives the arena back to the system heap if no block is allocated in it
+    void release();
+    // percentage of the used pages which doesn't hold requested bytes
+    unsigned int fragmentation() const;
+    unsigned int fragmentation(int sizeClass) const;
+
+  private:
+    struct Page {
+      uint8_t sizeClass;
+      uint16_t prev;              // pages of the same class with free blocks, free pages (next only)
+      uint16_t next;
+      uint16_t used;
+      uint16_t allocated;         // blocks allocated at least once, the next ones have never been used
+      uint16_t firstFree;         // the freed blocks are chained through their data
+    };
+    uint8_t * Arena;
+    Page Pages[SLAB_PAGES];
+    uint16_t FirstFreePage;
+    uint16_t FirstPartialPage[SLAB_CLASSES];
+    bool ArenaFailed;
+    SlabAllocatorStats Stats;
+
+    static int getClass(size_t size);
+    static unsigned int getClassSize(int sizeClass) { return SLAB_MIN_SIZE << sizeClass; }
+    void init();
+    void * allocBlock(int sizeClass);
+    void freeBlock(void * ptr);
+    void linkPartialPage(uint16_t page);
+    void unlinkPartialPage(uint16_t page);
 };
 
 #if defined(SIMU)
@@ -88,10 +207,14 @@ typedef BinAllocator<91,50> BinAllocator_slots2;
 #endif
 
 #if defined(USE_BIN_ALLOCATOR)
+#if defined(USE_SLAB_ALLOCATOR)
+extern SlabAllocator slabAllocator;
+#else
 extern BinAllocator_slots1 slots1;
 extern BinAllocator_slots2 slots2;
+#endif
 
-// wrapper for our BinAllocator for Lua
+// wrapper for our SlabAllocator or BinAllocator for Lua
 void *bin_l_alloc (void *ud, void *ptr, size_t osize, size_t nsize);
 #endif   //#if defined(USE_BIN_ALLOCATOR)
 
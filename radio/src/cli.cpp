@@ -23,6 +23,9 @@
 #include <ctype.h>
 #include <malloc.h>
 #include <new>
+#if defined(USE_BIN_ALLOCATOR)
+#include "bin_allocator.h"
+#endif
 
 #define CLI_COMMAND_MAX_ARGS           8
 #define CLI_COMMAND_MAX_LEN            256
@@ -380,6 +383,9 @@ int cliStackInfo(const char ** argv)
   serialPrint("[MIXER] %d available / %d", mixerStack.available(), mixerStack.size());
   serialPrint("[AUDIO] %d available / %d", audioStack.available(), audioStack.size());
   serialPrint("[CLI] %d available / %d", cliStack.available(), cliStack.size());
+#if defined(SD_WRITE_QUEUE)
+  serialPrint("[SDWRITE] %d available / %d", sdWriteStack.available(), sdWriteStack.size());
+#endif
   return 0;
 }
 
@@ -387,6 +393,27 @@ extern int _end;
 extern int _heap_end;
 extern unsigned char *heap;
 
+#if defined(USE_SLAB_ALLOCATOR)
+void printSlabAllocatorStats(const SlabAllocator & allocator)
+{
+  const SlabAllocatorStats & stats = allocator.stats();
+  serialPrint("\tSlabs   %u pages of %u bytes, %u free", stats.pages, SLAB_PAGE_SIZE, stats.freePages);
+  for (int i=0; i<SLAB_CLASSES; i++) {
+    const SlabClassStats & slabClass = stats.classes[i];
+    serialPrint("\t  %3u bytes: %u pages, %u blocks, %u bytes used, %u%% fragmentation", SlabAllocator::class_size(i), slabClass.pages, slabClass.blocks, slabClass.requested, allocator.fragmentation(i));
+  }
+  serialPrint("\tSlabs fragmentation %u%%", allocator.fragmentation());
+  serialPrint("\tHeap    %u bytes, %u slab failures", stats.heapBytes, stats.failures);
+}
+#elif defined(USE_BIN_ALLOCATOR)
+template <class T>
+void printBinAllocatorStats(const char * name, T & allocator)
+{
+  const BinAllocatorStats & stats = allocator.stats();
+  serialPrint("\t%s %ux%u bytes: used %u, max %u, failures %u", name, allocator.capacity(), allocator.slot_size(), stats.used, stats.maxUsed, stats.failures);
+}
+#endif
+
 int cliMemoryInfo(const char ** argv)
 {
   // struct mallinfo {
@@ -428,10 +455,36 @@ int cliMemoryInfo(const char ** argv)
   serialPrint("------------");
   serialPrint("\tTotal   %u", s + w + e);
 #endif
+#if defined(USE_SLAB_ALLOCATOR)
+  printSlabAllocatorStats(slabAllocator);
+#elif defined(USE_BIN_ALLOCATOR)
+  printBinAllocatorStats("slots1", slots1);
+  printBinAllocatorStats("slots2", slots2);
+#endif
 #endif
   return 0;
 }
 
+#if defined(LUA)
+int cliLuaStats(const char ** argv)
+{
+  if (!strcmp(argv[1], "reset")) {
+    luaResetScriptsStats();
+    return 0;
+  }
+
+  char name[LUA_SCRIPT_NAME_LEN+1];
+  const LuaScriptStats * stats;
+  serialPrint("Lua scripts:");
+  for (int i=0; (stats = luaGetScriptStats(i, name)); i++) {
+    serialPrint("\t%-16s runs %u, time %uus (avg %uus, max %uus), instructions %u (max %u), allocated %u bytes", name,
+                stats->runs, stats->time, stats->runs ? stats->time / stats->runs : 0, stats->maxTime,
+                stats->instructions, stats->maxInstructions, stats->allocated);
+  }
+  return 0;
+}
+#endif
+
 int cliReboot(const char ** argv)
 {
 #if !defined(SIMU)
@@ -559,6 +612,11 @@ void printTaskSwitchLog()
     else if (audioTaskId == n) {
       serialPrint("%d: audio", n);
     }
+#if defined(SD_WRITE_QUEUE)
+    else if (sdWriteTaskId == n) {
+      serialPrint("%d: SD write", n);
+    }
+#endif
 #if defined(BLUETOOTH)
     else if (btTaskId == n) {
       serialPrint("%d: BT", n);
@@ -812,7 +870,12 @@ int cliDisplay(const char ** argv)
   else if (!strcmp(argv[1], "dc")) {
     DiskCacheStats stats = diskCache.getStats();
     uint32_t hitRate = diskCache.getHitRate();
-    serialPrint("Disk Cache stats: w:%u r: %u, h: %u(%0.1f%%), m: %u", stats.noWrites, (stats.noHits + stats.noMisses), stats.noHits, hitRate/10.0, stats.noMisses);
+    serialPrint("Disk Cache stats: w:%u r: %u, h: %u(%0.1f%%), m: %u, ra: %u", stats.noWrites, (stats.noHits + stats.noMisses), stats.noHits, hitRate/10.0, stats.noMisses, stats.noReadAheads);
+    serialPrint("  writes: cached: %u, to disk: %u", stats.noWriteBacks, stats.noDiskWrites);
+    const char * const consumers[DISK_CACHE_CONSUMERS_COUNT] = { "menus", "audio", "other" };
+    for (int i=0; i<DISK_CACHE_CONSUMERS_COUNT; i++) {
+      serialPrint("  %s: h: %u(%0.1f%%), m: %u", consumers[i], stats.noConsumerHits[i], diskCache.getHitRate(i)/10.0, stats.noConsumerMisses[i]);
+    }
   }
 #endif
   else if (toLongLongInt(argv, 1, &address) > 0) {
@@ -955,6 +1018,9 @@ const CliCommand cliCommands[] = {
   { "set", cliSet, "<what> <value>" },
   { "stackinfo", cliStackInfo, "" },
   { "meminfo", cliMemoryInfo, "" },
+#if defined(LUA)
+  { "luastats", cliLuaStats, "[reset]" },
+#endif
   { "test", cliTest, "new | std::exception" },
   { "trace", cliTrace, "on | off" },
 #if defined(PCBFLAMENCO)
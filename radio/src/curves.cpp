@@ -197,6 +197,44 @@ int32_t compute_tangent(CurveInfo * crv, int8_t * points, int i)
     return m;
 }
 
+/* The tangents of the smooth curves only depend on the curve points, they are
+   computed once and kept until the model is edited (same version counter than
+   the mixer programs). The table is indexed like g_model.points, a curve uses
+   one entry per point. It is only written by the mixer, the other callers (the
+   curves editors) compute the tangents on the stack while it is not valid.
+*/
+int32_t curveTangents[MAX_CURVE_POINTS];
+uint32_t curveTangentsVersion[MAX_CURVES];
+
+#define IS_CURVE_TANGENTS_VALID(idx) (curveTangentsVersion[idx] == mixerProgramVersion)
+
+void computeCurveTangents(uint8_t idx, int32_t * tangents)
+{
+  CurveInfo & crv = g_model.curves[idx];
+  int8_t * points = curveAddress(idx);
+  uint8_t count = crv.points+5;
+  for (int i=0; i<count; i++) {
+    tangents[i] = compute_tangent(&crv, points, i);
+  }
+}
+
+// computes the missing tangents, called by the mixer before the curves are evaluated
+void prepareCurveTangents()
+{
+  for (uint8_t idx=0; idx<MAX_CURVES; idx++) {
+    CurveInfo & crv = g_model.curves[idx];
+    int8_t * points = curveAddress(idx);
+    if (crv.smooth && points + crv.points + 5 <= g_model.points + MAX_CURVE_POINTS && !IS_CURVE_TANGENTS_VALID(idx)) {
+      // the version is taken first, an edit during the computation will trigger a new one
+      uint32_t version = mixerProgramVersion;
+      computeCurveTangents(idx, &curveTangents[points - g_model.points]);
+      // the version is published once the whole table is written
+      __sync_synchronize();
+      curveTangentsVersion[idx] = version;
+    }
+  }
+}
+
 /* The following is a hermite cubic spline.
    The basis functions can be found here:
    http://en.wikipedia.org/wiki/Cubic_Hermite_spline
@@ -209,6 +247,16 @@ int16_t hermite_spline(int16_t x, uint8_t idx)
   uint8_t count = crv.points+5;
   bool custom = (crv.type == CURVE_TYPE_CUSTOM);
 
+  if (points + count > g_model.points + MAX_CURVE_POINTS)
+    return 0;
+
+  int32_t localTangents[MAX_POINTS_PER_CURVE];
+  int32_t * tangents = &curveTangents[points - g_model.points];
+  if (!IS_CURVE_TANGENTS_VALID(idx)) {
+    tangents = localTangents;
+    computeCurveTangents(idx, tangents);
+  }
+
   if (x < -RESX)
     x = -RESX;
   else if (x > RESX)
@@ -228,8 +276,8 @@ int16_t hermite_spline(int16_t x, uint8_t idx)
     if (x >= p0x && x <= p3x) {
       int32_t p0y = calc100toRESX(points[i]);
       int32_t p3y = calc100toRESX(points[i+1]);
-      int32_t m0 = compute_tangent(&crv, points, i);
-      int32_t m3 = compute_tangent(&crv, points, i+1);
+      int32_t m0 = tangents[i];
+      int32_t m3 = tangents[i+1];
       int32_t y;
       int32_t h = p3x - p0x;
       int32_t t = (h > 0 ? (MMULT * (x - p0x)) / h : 0);
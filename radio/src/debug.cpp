@@ -21,6 +21,9 @@
 #include "opentx.h"
 #include "stamp.h"
 #include <stdarg.h>
+#if defined(SIMU)
+  #include <chrono>
+#endif
 
 #if defined(SIMU)
 traceCallbackFunc traceCallback = 0;
@@ -204,6 +207,25 @@ void CoTaskSwitchHook(uint8_t taskID)
 
 #if defined(DEBUG_TIMERS)
 
+#if defined(SIMU)
+// the SIMU getTmr2MHz() and get_tmr10ms() don't follow the host time, the timers use its steady clock
+static uint32_t debugTimerMicros()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void DebugTimer::start()
+{
+  _start_loprec = debugTimerMicros();
+}
+
+void DebugTimer::stop()
+{
+  if (_start_loprec == 0) return;
+  last = debugTimerMicros() - _start_loprec;
+  evalStats();
+}
+#else
 void DebugTimer::start()
 {
   _start_hiprec = getTmr2MHz();
@@ -228,6 +250,7 @@ void DebugTimer::stop()
   }
   evalStats(); 
 }
+#endif
 
 DebugTimer debugTimers[DEBUG_TIMERS_COUNT];
 
@@ -245,6 +268,7 @@ const char * const debugTimerNames[DEBUG_TIMERS_COUNT] = {
   ,"  LUA bg   "   // debugTimerLuaBg,
   ,"  LCD wait "   // debugTimerLcdRefreshWait,
   ,"  LUA fg   "   // debugTimerLuaFg,
+  ,"LUA gc     "   // debugTimerLuaGc,
   ,"  LCD refr."   // debugTimerLcdRefresh,
   ,"  Menus    "   // debugTimerMenus,
   ,"   Menu hnd"   // debugTimerMenuHandlers,
@@ -256,6 +280,9 @@ const char * const debugTimerNames[DEBUG_TIMERS_COUNT] = {
   ,"Mix getsw  "   // debugTimerGetSwitches,
   ,"Mix eval   "   // debugTimerEvalMixes,
   ,"Mix 10ms   "   // debugTimerMixes10ms,
+  ,"Mix f.modes"   // debugTimerFlightModeMixes,
+  ,"Mix funcs  "   // debugTimerFunctions,
+  ,"Mix limits "   // debugTimerLimits,
   ,"ADC read   "   // debugTimerAdcRead,
   ,"mix-pulses "   // debugTimerMixerCalcToUsage
   ,"mix-int.   "   // debugTimerMixerIterval
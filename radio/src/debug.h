@@ -365,6 +365,7 @@ enum DebugTimers {
   debugTimerLuaBg,
   debugTimerLcdRefreshWait,
   debugTimerLuaFg,
+  debugTimerLuaGc,
   debugTimerLcdRefresh,
   debugTimerMenus,
   debugTimerMenuHandlers,
@@ -377,6 +378,9 @@ enum DebugTimers {
   debugTimerGetSwitches,
   debugTimerEvalMixes,
   debugTimerMixes10ms,
+  debugTimerFlightModeMixes,
+  debugTimerFunctions,
+  debugTimerLimits,
 
   debugTimerAdcRead,
 
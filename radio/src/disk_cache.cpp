@@ -32,25 +32,42 @@
   #define TRACE_DISK_CACHE(...)
 #endif
 
+/*
+ * The cache blocks are aligned on DISK_CACHE_BLOCK_SECTORS, they are found through a hash
+ * of their first sector and evicted in LRU order.
+ *
+ * When a consumer reads sequentially (a WAV file, a bitmap), the block following the one
+ * which missed is read ahead, and a block which has been read to its end goes to the end
+ * of the LRU list, so that streamed data doesn't evict the blocks which are reused (FAT,
+ * directories).
+ *
+ * Writes to sectors which are in the cache only go to the cache (write-back), so that the
+ * frequent updates of the FAT and of the directory entries are coalesced. The dirty blocks
+ * are written when evicted, when there are more than DISK_CACHE_DIRTY_BLOCKS of them, after
+ * DISK_CACHE_WRITE_DELAY (diskCacheFlush(false), called by the SD write task) and on f_sync()
+ * or unmount (CTRL_SYNC). Other writes go straight to the card and update the cached copies.
+ */
+
 DiskCache diskCache;
 
 DiskCacheBlock::DiskCacheBlock():
   startSector(0),
-  endSector(0) 
+  endSector(0),
+  dirtySectors(0),
+  dirtyTime(0),
+  hashNext(DISK_CACHE_NONE),
+  lruPrev(DISK_CACHE_NONE),
+  lruNext(DISK_CACHE_NONE)
 {
 }
 
-bool DiskCacheBlock::read(BYTE * buff, DWORD sector, UINT count)
+void DiskCacheBlock::read(BYTE * buff, DWORD sector, UINT count) const
 {
-  if (sector >= startSector && (sector+count) <= endSector) {
-    TRACE_DISK_CACHE("\tcache read(%u, %u) from %p", (uint32_t)sector, (uint32_t)count, this);
-    memcpy(buff, data + ((sector - startSector) * BLOCK_SIZE), count * BLOCK_SIZE);
-    return true;
-  }
-  return false;
+  TRACE_DISK_CACHE("\tcache read(%u, %u) from %p", (uint32_t)sector, (uint32_t)count, this);
+  memcpy(buff, data + ((sector - startSector) * BLOCK_SIZE), count * BLOCK_SIZE);
 }
 
-DRESULT DiskCacheBlock::fill(BYTE drv, BYTE * buff, DWORD sector, UINT count)
+DRESULT DiskCacheBlock::fill(BYTE drv, DWORD sector)
 {
   DRESULT res = __disk_read(drv, data, sector, DISK_CACHE_BLOCK_SECTORS);
   if (res != RES_OK) {
@@ -58,22 +75,61 @@ DRESULT DiskCacheBlock::fill(BYTE drv, BYTE * buff, DWORD sector, UINT count)
   }
   startSector = sector;
   endSector = sector + DISK_CACHE_BLOCK_SECTORS;
-  memcpy(buff, data, count * BLOCK_SIZE);
-  TRACE_DISK_CACHE("\tcache %p FILLED from read(%u, %u)", this, (uint32_t)sector, (uint32_t)count);
+  TRACE_DISK_CACHE("\tcache %p FILLED from read(%u)", this, (uint32_t)sector);
   return RES_OK;
 }
 
-void DiskCacheBlock::free(DWORD sector, UINT count) 
+// copies the sectors of a write which are in this block, returns them as a mask
+uint16_t DiskCacheBlock::update(const BYTE * buff, DWORD sector, UINT count)
+{
+  DWORD first = max<DWORD>(sector, startSector);
+  DWORD last = min<DWORD>(sector + count, endSector);
+  if (first >= last) {
+    return 0;
+  }
+  memcpy(data + ((first - startSector) * BLOCK_SIZE), buff + ((first - sector) * BLOCK_SIZE), (last - first) * BLOCK_SIZE);
+  return ((1 << (last - startSector)) - 1) & ~((1 << (first - startSector)) - 1);
+}
+
+// copies the dirty sectors of this block over a read done directly on the card
+void DiskCacheBlock::patch(BYTE * buff, DWORD sector, UINT count) const
+{
+  for (UINT i=0; i<DISK_CACHE_BLOCK_SECTORS; i++) {
+    DWORD dirtySector = startSector + i;
+    if ((dirtySectors & (1 << i)) && dirtySector >= sector && dirtySector < sector + count) {
+      memcpy(buff + ((dirtySector - sector) * BLOCK_SIZE), data + (i * BLOCK_SIZE), BLOCK_SIZE);
+    }
+  }
+}
+
+DRESULT DiskCacheBlock::flush(BYTE drv)
 {
-  if (sector < endSector && (sector+count) > startSector) {
-    TRACE_DISK_CACHE("\tINVALIDATING disk cache block %p (%u)", this, startSector);
-    endSector = 0;
+  if (!dirtySectors) {
+    return RES_OK;
+  }
+
+  // one write from the first to the last dirty sector, the clean ones in between are the same as on the card
+  UINT first = 0;
+  while (!(dirtySectors & (1 << first))) {
+    first++;
+  }
+  UINT last = DISK_CACHE_BLOCK_SECTORS;
+  while (!(dirtySectors & (1 << (last - 1)))) {
+    last--;
+  }
+
+  TRACE_DISK_CACHE("\tcache %p WRITE BACK(%u, %u)", this, (uint32_t)(startSector + first), (uint32_t)(last - first));
+  DRESULT res = __disk_write(drv, data + (first * BLOCK_SIZE), startSector + first, last - first);
+  if (res == RES_OK) {
+    dirtySectors = 0;
   }
+  return res;
 }
 
 void DiskCacheBlock::free()
 {
   endSector = 0;
+  dirtySectors = 0;
 }
 
 bool DiskCacheBlock::empty() const
@@ -81,84 +137,338 @@ bool DiskCacheBlock::empty() const
   return (endSector == 0);
 }
 
-DiskCache::DiskCache():
-  lastBlock(0)
+bool DiskCacheBlock::dirty() const
+{
+  return (dirtySectors != 0);
+}
+
+DiskCache::DiskCache()
 {
-  stats.noHits = 0;
-  stats.noMisses = 0;
-  stats.noWrites = 0;
   blocks = new DiskCacheBlock[DISK_CACHE_BLOCKS_NUM];
+  clear();
 }
 
 void DiskCache::clear()
 {
-  lastBlock = 0;
-  stats.noHits = 0;
-  stats.noMisses = 0;
-  stats.noWrites = 0;
+  memset(&stats, 0, sizeof(stats));
+  memset(hashHeads, DISK_CACHE_NONE, sizeof(hashHeads));
+  for (int n=0; n<DISK_CACHE_CONSUMERS_COUNT; ++n) {
+    nextSector[n] = 0;
+  }
+  lruFirst = lruLast = DISK_CACHE_NONE;
+  dirtyCount = 0;
   for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
     blocks[n].free();
+    blocks[n].hashNext = DISK_CACHE_NONE;
+    lruPushLast(n);
+  }
+}
+
+uint8_t DiskCache::getConsumer()
+{
+#if !defined(SIMU)
+  OS_TID task = CoGetCurTaskID();
+  if (task == menusTaskId)
+    return DISK_CACHE_CONSUMER_MENUS;
+  else if (task == audioTaskId)
+    return DISK_CACHE_CONSUMER_AUDIO;
+#endif
+  return DISK_CACHE_CONSUMER_OTHER;
+}
+
+uint8_t DiskCache::getHash(DWORD sector)
+{
+  return (sector / DISK_CACHE_BLOCK_SECTORS) & (DISK_CACHE_HASH_SIZE - 1);
+}
+
+// returns the block starting at sector, DISK_CACHE_NONE if not cached
+uint8_t DiskCache::find(DWORD sector) const
+{
+  uint8_t index = hashHeads[getHash(sector)];
+  while (index != DISK_CACHE_NONE && blocks[index].startSector != sector) {
+    index = blocks[index].hashNext;
+  }
+  return index;
+}
+
+void DiskCache::hashInsert(uint8_t index)
+{
+  uint8_t hash = getHash(blocks[index].startSector);
+  blocks[index].hashNext = hashHeads[hash];
+  hashHeads[hash] = index;
+}
+
+void DiskCache::hashRemove(uint8_t index)
+{
+  uint8_t * link = &hashHeads[getHash(blocks[index].startSector)];
+  while (*link != DISK_CACHE_NONE) {
+    if (*link == index) {
+      *link = blocks[index].hashNext;
+      break;
+    }
+    link = &blocks[*link].hashNext;
+  }
+  blocks[index].hashNext = DISK_CACHE_NONE;
+}
+
+void DiskCache::lruRemove(uint8_t index)
+{
+  DiskCacheBlock & block = blocks[index];
+  if (block.lruPrev != DISK_CACHE_NONE)
+    blocks[block.lruPrev].lruNext = block.lruNext;
+  else
+    lruFirst = block.lruNext;
+  if (block.lruNext != DISK_CACHE_NONE)
+    blocks[block.lruNext].lruPrev = block.lruPrev;
+  else
+    lruLast = block.lruPrev;
+  block.lruPrev = block.lruNext = DISK_CACHE_NONE;
+}
+
+void DiskCache::lruPushFirst(uint8_t index)
+{
+  DiskCacheBlock & block = blocks[index];
+  block.lruPrev = DISK_CACHE_NONE;
+  block.lruNext = lruFirst;
+  if (lruFirst != DISK_CACHE_NONE)
+    blocks[lruFirst].lruPrev = index;
+  else
+    lruLast = index;
+  lruFirst = index;
+}
+
+void DiskCache::lruPushLast(uint8_t index)
+{
+  DiskCacheBlock & block = blocks[index];
+  block.lruNext = DISK_CACHE_NONE;
+  block.lruPrev = lruLast;
+  if (lruLast != DISK_CACHE_NONE)
+    blocks[lruLast].lruNext = index;
+  else
+    lruFirst = index;
+  lruLast = index;
+}
+
+DRESULT DiskCache::flushBlock(BYTE drv, uint8_t index)
+{
+  DiskCacheBlock & block = blocks[index];
+  if (!block.dirty()) {
+    return RES_OK;
+  }
+  DRESULT res = block.flush(drv);
+  if (res == RES_OK) {
+    ++stats.noDiskWrites;
+    --dirtyCount;
+  }
+  return res;
+}
+
+DRESULT DiskCache::flushOldest(BYTE drv)
+{
+  uint8_t oldest = DISK_CACHE_NONE;
+  for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
+    if (blocks[n].dirty() && (oldest == DISK_CACHE_NONE || (tmr10ms_t)(blocks[n].dirtyTime - blocks[oldest].dirtyTime) > (tmr10ms_t)(blocks[oldest].dirtyTime - blocks[n].dirtyTime))) {
+      oldest = n;
+    }
+  }
+  return (oldest == DISK_CACHE_NONE ? RES_OK : flushBlock(drv, oldest));
+}
+
+// writes the dirty blocks, or only those which waited for DISK_CACHE_WRITE_DELAY
+DRESULT DiskCache::flush(BYTE drv, bool all)
+{
+  DRESULT result = RES_OK;
+  tmr10ms_t now = get_tmr10ms();
+  for (int n=0; n<DISK_CACHE_BLOCKS_NUM && dirtyCount>0; ++n) {
+    if (blocks[n].dirty() && (all || (tmr10ms_t)(now - blocks[n].dirtyTime) >= DISK_CACHE_WRITE_DELAY)) {
+      DRESULT res = flushBlock(drv, n);
+      if (res != RES_OK) {
+        result = res;
+      }
+    }
+  }
+  return result;
+}
+
+// copies the dirty sectors over a read done directly on the card
+void DiskCache::patch(BYTE * buff, DWORD sector, UINT count) const
+{
+  if (dirtyCount > 0) {
+    for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
+      if (blocks[n].dirty()) {
+        blocks[n].patch(buff, sector, count);
+      }
+    }
+  }
+}
+
+// reads the block starting at sector into the least recently used one
+DRESULT DiskCache::load(BYTE drv, DWORD sector, uint8_t & index)
+{
+  index = lruLast;
+  DiskCacheBlock & block = blocks[index];
+  DRESULT res = flushBlock(drv, index);
+  if (res != RES_OK) {
+    return res;
+  }
+  if (!block.empty()) {
+    hashRemove(index);
+    block.free();
+  }
+
+  res = block.fill(drv, sector);
+  if (res == RES_OK) {
+    hashInsert(index);
+    lruRemove(index);
+    lruPushFirst(index);
+  }
+  return res;
+}
+
+void DiskCache::readAhead(BYTE drv, DWORD sector)
+{
+  if (sector + DISK_CACHE_BLOCK_SECTORS > sdGetNoSectors() || find(sector) != DISK_CACHE_NONE) {
+    return;
+  }
+
+  uint8_t index;
+  if (load(drv, sector, index) == RES_OK) {
+    TRACE_DISK_CACHE("\t\t read ahead(%u)", (uint32_t)sector);
+    ++stats.noReadAheads;
   }
 }
 
 DRESULT DiskCache::read(BYTE drv, BYTE * buff, DWORD sector, UINT count)
 {
-  // TODO: check if not caching first sectors would improve anything
-  // if (sector < 1000) {
-  //   ++stats.noMisses;
-  //   return __disk_read(drv, buff, sector, count);  
-  // }
+  uint8_t consumer = getConsumer();
+  bool sequential = (sector == nextSector[consumer]);
+  nextSector[consumer] = sector + count;
 
   // if read is bigger than cache block, then read it directly without using cache
   if (count > DISK_CACHE_BLOCK_SECTORS) {
     TRACE_DISK_CACHE("\t\t big read(%u, %u)",  (uint32_t)sector, (uint32_t)count);
-    return __disk_read(drv, buff, sector, count);
+    return readDirect(drv, buff, sector, count);
   }
-  
-  // if block + cache block size is beyond the end of the disk, then read it directly without using cache
-  if (sector+DISK_CACHE_BLOCK_SECTORS >= sdGetNoSectors()) {
+
+  // if the cache blocks would be beyond the end of the disk, then read it directly without using cache
+  DWORD endSector = (sector + count + DISK_CACHE_BLOCK_SECTORS - 1) / DISK_CACHE_BLOCK_SECTORS * DISK_CACHE_BLOCK_SECTORS;
+  if (endSector > sdGetNoSectors()) {
     TRACE_DISK_CACHE("\t\t cache would be beyond end of disk %u (%u)", (uint32_t)sector, sdGetNoSectors());
-    return __disk_read(drv, buff, sector, count);
+    return readDirect(drv, buff, sector, count);
   }
 
-  for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
-    if (blocks[n].read(buff, sector, count)) {
-      ++stats.noHits;
-      return RES_OK;
-    }
-  }
+  bool hit = true;
 
-  ++stats.noMisses;
+  // the read may span two blocks
+  while (count > 0) {
+    DWORD blockSector = sector / DISK_CACHE_BLOCK_SECTORS * DISK_CACHE_BLOCK_SECTORS;
+    UINT blockCount = min<UINT>(count, blockSector + DISK_CACHE_BLOCK_SECTORS - sector);
+    uint8_t index = find(blockSector);
+    if (index == DISK_CACHE_NONE) {
+      hit = false;
+      DRESULT res = load(drv, blockSector, index);
+      if (res != RES_OK) {
+        return res;
+      }
+      if (sequential) {
+        readAhead(drv, blockSector + DISK_CACHE_BLOCK_SECTORS);
+      }
+    }
 
-  // find free block
-  for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
-    if (blocks[n].empty()) {
-      TRACE_DISK_CACHE("\t\t using free block");
-      return blocks[n].fill(drv, buff, sector, count);
+    blocks[index].read(buff, sector, blockCount);
+    lruRemove(index);
+    if (sequential && sector + blockCount == blockSector + DISK_CACHE_BLOCK_SECTORS) {
+      // streamed until the end of the block, it will probably not be read again
+      lruPushLast(index);
     }
+    else {
+      lruPushFirst(index);
+    }
+
+    buff += blockCount * BLOCK_SIZE;
+    sector += blockCount;
+    count -= blockCount;
   }
 
-  // use next block (round robin)
-  // TODO: use better strategy to select which used block gets used here
-  if (++lastBlock >= DISK_CACHE_BLOCKS_NUM) {
-    lastBlock = 0;
+  if (hit) {
+    ++stats.noHits;
+    ++stats.noConsumerHits[consumer];
   }
-  
-  return blocks[lastBlock].fill(drv, buff, sector, count);
+  else {
+    ++stats.noMisses;
+    ++stats.noConsumerMisses[consumer];
+  }
+
+  return RES_OK;
+}
+
+DRESULT DiskCache::readDirect(BYTE drv, BYTE * buff, DWORD sector, UINT count)
+{
+  DRESULT res = __disk_read(drv, buff, sector, count);
+  if (res == RES_OK) {
+    patch(buff, sector, count);
+  }
+  return res;
 }
 
 DRESULT DiskCache::write(BYTE drv, const BYTE* buff, DWORD sector, UINT count)
 {
   ++stats.noWrites;
-  for(int n=0; n < DISK_CACHE_BLOCKS_NUM; ++n) {
-    blocks[n].free(sector, count);
+
+  DWORD firstSector = sector / DISK_CACHE_BLOCK_SECTORS * DISK_CACHE_BLOCK_SECTORS;
+
+  // if all the sectors are cached, the write is only done in the cache
+  if (count <= DISK_CACHE_BLOCK_SECTORS) {
+    DWORD lastSector = (sector + count - 1) / DISK_CACHE_BLOCK_SECTORS * DISK_CACHE_BLOCK_SECTORS;
+    uint8_t first = find(firstSector);
+    uint8_t last = (lastSector == firstSector ? first : find(lastSector));
+    if (first != DISK_CACHE_NONE && last != DISK_CACHE_NONE) {
+      tmr10ms_t now = get_tmr10ms();
+      for (uint8_t index=first; ; index=last) {
+        DiskCacheBlock & block = blocks[index];
+        TRACE_DISK_CACHE("\tcache write(%u, %u) to %p", (uint32_t)sector, (uint32_t)count, &block);
+        if (!block.dirty()) {
+          block.dirtyTime = now;
+          ++dirtyCount;
+        }
+        block.dirtySectors |= block.update(buff, sector, count);
+        lruRemove(index);
+        lruPushFirst(index);
+        if (index == last) {
+          break;
+        }
+      }
+      ++stats.noWriteBacks;
+      return (dirtyCount > DISK_CACHE_DIRTY_BLOCKS ? flushOldest(drv) : RES_OK);
+    }
+  }
+
+  // otherwise it goes straight to the card, the cached copies are updated once it is written
+  ++stats.noDiskWrites;
+  DRESULT res = __disk_write(drv, buff, sector, count);
+  if (res != RES_OK) {
+    return res;
+  }
+
+  for (int n=0; n<DISK_CACHE_BLOCKS_NUM; ++n) {
+    DiskCacheBlock & block = blocks[n];
+    if (!block.empty()) {
+      uint16_t updated = block.update(buff, sector, count);
+      if (updated && block.dirty()) {
+        block.dirtySectors &= ~updated;
+        if (!block.dirty()) {
+          --dirtyCount;
+        }
+      }
+    }
   }
-  return __disk_write(drv, buff, sector, count);  
+
+  return RES_OK;
 }
 
-const DiskCacheStats & DiskCache::getStats() const 
-{ 
-  return stats; 
+const DiskCacheStats & DiskCache::getStats() const
+{
+  return stats;
 }
 
 int DiskCache::getHitRate() const
@@ -168,6 +478,29 @@ int DiskCache::getHitRate() const
   return (stats.noHits * 1000) / all;
 }
 
+int DiskCache::getHitRate(uint8_t consumer) const
+{
+  uint32_t all = stats.noConsumerHits[consumer] + stats.noConsumerMisses[consumer];
+  if (all == 0) return 0;
+  return (stats.noConsumerHits[consumer] * 1000) / all;
+}
+
+// writes the dirty blocks (all, or those which waited for DISK_CACHE_WRITE_DELAY) out of a FatFS call
+void diskCacheFlush(bool all)
+{
+#if defined(SIMU)
+  // no FatFS sync object in the simulator
+  if (sdMounted()) {
+    diskCache.flush(0, all);
+  }
+#else
+  if (sdMounted() && ff_req_grant(g_FATFS_Obj.sobj)) {
+    diskCache.flush(0, all);
+    ff_rel_grant(g_FATFS_Obj.sobj);
+  }
+#endif
+}
+
 DRESULT disk_read(BYTE drv, BYTE * buff, DWORD sector, UINT count)
 {
   return diskCache.read(drv, buff, sector, count);
@@ -27,23 +27,48 @@
 // tunable parameters
 #define DISK_CACHE_BLOCKS_NUM      32   // no cache blocks
 #define DISK_CACHE_BLOCK_SECTORS   16   // no sectors
+#define DISK_CACHE_HASH_SIZE       64   // must be a power of 2
+#define DISK_CACHE_DIRTY_BLOCKS    8    // max no blocks waiting to be written
+#define DISK_CACHE_WRITE_DELAY     100  // dirty blocks are written after 1s
 
 #define DISK_CACHE_BLOCK_SIZE   (DISK_CACHE_BLOCK_SECTORS * BLOCK_SIZE)
 
+static_assert(DISK_CACHE_BLOCK_SECTORS <= 16, "DiskCacheBlock::dirtySectors too small");
+#define DISK_CACHE_NONE         0xFF
+
+// the task reading the card, each one has its own statistics and read-ahead
+enum DiskCacheConsumer
+{
+  DISK_CACHE_CONSUMER_MENUS,      // bitmaps, fonts, Lua scripts, models
+  DISK_CACHE_CONSUMER_AUDIO,      // WAV files
+  DISK_CACHE_CONSUMER_OTHER,
+  DISK_CACHE_CONSUMERS_COUNT
+};
+
 class DiskCacheBlock
 {
+  friend class DiskCache;
+
 public:
   DiskCacheBlock();
-  bool read(BYTE* buff, DWORD sector, UINT count);
-  DRESULT fill(BYTE drv, BYTE* buff, DWORD sector, UINT count);
-  void free(DWORD sector, UINT count);
+  void read(BYTE* buff, DWORD sector, UINT count) const;
+  DRESULT fill(BYTE drv, DWORD sector);
+  uint16_t update(const BYTE* buff, DWORD sector, UINT count);
+  void patch(BYTE* buff, DWORD sector, UINT count) const;
+  DRESULT flush(BYTE drv);
   void free();
   bool empty() const;
+  bool dirty() const;
 
 private:
   uint8_t data[DISK_CACHE_BLOCK_SIZE];
-  DWORD startSector;
-  DWORD endSector;
+  DWORD startSector;              // always a multiple of DISK_CACHE_BLOCK_SECTORS
+  DWORD endSector;                // 0 when the block is empty
+  uint16_t dirtySectors;          // sectors modified in the cache and not written yet
+  tmr10ms_t dirtyTime;            // when the block became dirty
+  uint8_t hashNext;               // next block in the same hash bucket
+  uint8_t lruPrev;                // more recently used block
+  uint8_t lruNext;                // less recently used block
 };
 
 struct DiskCacheStats
@@ -51,6 +76,11 @@ struct DiskCacheStats
   uint32_t noHits;
   uint32_t noMisses;
   uint32_t noWrites;
+  uint32_t noWriteBacks;          // writes which only went to the cache
+  uint32_t noDiskWrites;
+  uint32_t noReadAheads;
+  uint32_t noConsumerHits[DISK_CACHE_CONSUMERS_COUNT];
+  uint32_t noConsumerMisses[DISK_CACHE_CONSUMERS_COUNT];
 };
 
 class DiskCache
@@ -61,14 +91,37 @@ class DiskCache
     DRESULT write(BYTE drv, const BYTE* buff, DWORD sector, UINT count);
     const DiskCacheStats & getStats() const;
     int getHitRate() const;
+    int getHitRate(uint8_t consumer) const;
+    DRESULT flush(BYTE drv, bool all=true);
     void clear();
 
   private:
     DiskCacheStats stats;
-    uint32_t lastBlock;
     DiskCacheBlock * blocks;
+    uint8_t hashHeads[DISK_CACHE_HASH_SIZE];
+    uint8_t lruFirst;               // most recently used block
+    uint8_t lruLast;                // least recently used block, the next one to be evicted
+    uint8_t dirtyCount;
+    DWORD nextSector[DISK_CACHE_CONSUMERS_COUNT]; // sector following the last read, to detect sequential reads
+
+    static uint8_t getConsumer();
+    static uint8_t getHash(DWORD sector);
+    uint8_t find(DWORD sector) const;
+    void hashInsert(uint8_t index);
+    void hashRemove(uint8_t index);
+    void lruRemove(uint8_t index);
+    void lruPushFirst(uint8_t index);
+    void lruPushLast(uint8_t index);
+    DRESULT load(BYTE drv, DWORD sector, uint8_t & index);
+    DRESULT flushBlock(BYTE drv, uint8_t index);
+    DRESULT flushOldest(BYTE drv);
+    void patch(BYTE* buff, DWORD sector, UINT count) const;
+    DRESULT readDirect(BYTE drv, BYTE* buff, DWORD sector, UINT count);
+    void readAhead(BYTE drv, DWORD sector);
 };
 
 extern DiskCache diskCache;
 
+void diskCacheFlush(bool all);
+
 #endif // _DISK_CACHE_H_
@@ -68,6 +68,32 @@ class DMAFifo
       }
     }
 
+    // bytes which can be read in place, up to the end of the buffer. The DMA doesn't wait
+    // for them to be released, it keeps writing around the buffer: they are only valid until
+    // it comes back to them, N bytes later
+    uint32_t peekSpan(const uint8_t * & elements)
+    {
+      elements = &fifo[ridx];
+#if defined(SIMU)
+      return 0;
+#endif
+      uint32_t widx = (N - stream->NDTR) & (N-1);
+      return (widx >= ridx ? widx : N) - ridx;
+    }
+
+    // returns false when the DMA wrote over the span before it was released, all the unread
+    // bytes are then dropped
+    bool skip(uint32_t count)
+    {
+      uint32_t widx = (N - stream->NDTR) & (N-1);
+      if (((widx - ridx) & (N-1)) < count) {
+        ridx = widx;
+        return false;
+      }
+      ridx = (ridx+count) & (N-1);
+      return true;
+    }
+
     uint8_t * buffer()
     {
       return fifo;
@@ -96,6 +96,20 @@ class Fifo
       }
     }
 
+    // elements which can be read in place, up to the end of the buffer, push() doesn't
+    // overwrite them until they are skipped
+    uint32_t peekSpan(const T * & elements) const
+    {
+      uint32_t w = widx;
+      elements = &fifo[ridx];
+      return (w >= ridx ? w : N) - ridx;
+    }
+
+    void skip(uint32_t count)
+    {
+      ridx = (ridx+count) & (N-1);
+    }
+
   protected:
     T fifo[N];
     volatile uint32_t widx;
@@ -99,6 +99,7 @@ void onSdManagerMenu(const char * result)
     }
     if (strcmp(clipboard.data.sd.directory, lfn)) {  // prevent copying to the same directory
       POPUP_WARNING(sdCopyFile(clipboard.data.sd.filename, clipboard.data.sd.directory, clipboard.data.sd.filename, lfn));
+      LUA_CACHE_SOURCES_CHANGED();
       REFRESH_FILES();
     }
   }
@@ -114,7 +115,10 @@ void onSdManagerMenu(const char * result)
   }
   else if (result == STR_DELETE_FILE) {
     getSelectionFullPath(lfn);
+    // the file may still be in the SD write queue
+    sdWriteQueueFlush();
     f_unlink(lfn);
+    LUA_CACHE_SOURCES_CHANGED();
     menuVerticalOffset = 0;
     menuVerticalPosition = 0;
     REFRESH_FILES();
@@ -349,7 +353,9 @@ bool menuRadioSdManager(event_t _event)
           else {
             reusableBuffer.sdmanager.lines[i][efflen] = 0;
           }
+          sdWriteQueueFlush();
           f_rename(reusableBuffer.sdmanager.originalName, reusableBuffer.sdmanager.lines[i]);
+          LUA_CACHE_SOURCES_CHANGED();
           REFRESH_FILES();
         }
       }
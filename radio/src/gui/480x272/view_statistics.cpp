@@ -149,6 +149,12 @@ bool menuStatsDebug(event_t event)
   lcdDrawNumber(lcdNextPos+5, MENU_CONTENT_TOP+line*FH, luaExtraMemoryUsage, LEFT);
   ++line;
 
+#if defined(USE_SLAB_ALLOCATOR)
+  lcdDrawText(MENUS_MARGIN_LEFT, MENU_CONTENT_TOP+line*FH, "Lua fragmentation");
+  lcdDrawNumber(MENU_STATS_COLUMN1, MENU_CONTENT_TOP+line*FH, luaGetMemFragmentation(), LEFT, 0, NULL, "%");
+  ++line;
+#endif
+
 #endif
 
   lcdDrawText(LCD_W/2, MENU_FOOTER_TOP+2, STR_MENUTORESET, CENTERED);
@@ -184,6 +190,48 @@ bool menuStatsAnalogs(event_t event)
   return true;
 }
 
+#if defined(LUA)
+#define STATS_LUA_RUNS_POS             (MENUS_MARGIN_LEFT + 120)
+#define STATS_LUA_AVG_POS              (MENUS_MARGIN_LEFT + 190)
+#define STATS_LUA_MAX_POS              (MENUS_MARGIN_LEFT + 260)
+#define STATS_LUA_INSTR_POS            (MENUS_MARGIN_LEFT + 330)
+#define STATS_LUA_ALLOC_POS            (MENUS_MARGIN_LEFT + 400)
+
+bool menuStatsLua(event_t event)
+{
+  switch(event)
+  {
+    case EVT_KEY_FIRST(KEY_ENTER):
+      luaResetScriptsStats();
+      break;
+  }
+
+  MENU("Lua scripts", STATS_ICONS, menuTabStats, e_StatsLua, 0, { 0 });
+
+  lcdDrawText(STATS_LUA_RUNS_POS, MENU_CONTENT_TOP+1, "Runs", HEADER_COLOR|SMLSIZE);
+  lcdDrawText(STATS_LUA_AVG_POS, MENU_CONTENT_TOP+1, "Avg us", HEADER_COLOR|SMLSIZE);
+  lcdDrawText(STATS_LUA_MAX_POS, MENU_CONTENT_TOP+1, "Max us", HEADER_COLOR|SMLSIZE);
+  lcdDrawText(STATS_LUA_INSTR_POS, MENU_CONTENT_TOP+1, "Max instr", HEADER_COLOR|SMLSIZE);
+  lcdDrawText(STATS_LUA_ALLOC_POS, MENU_CONTENT_TOP+1, "Alloc kB", HEADER_COLOR|SMLSIZE);
+
+  char name[LUA_SCRIPT_NAME_LEN+1];
+  const LuaScriptStats * stats;
+  for (int i=0, line=1; (stats = luaGetScriptStats(i, name)) && MENU_CONTENT_TOP+(line+1)*FH < MENU_FOOTER_TOP; i++, line++) {
+    coord_t y = MENU_CONTENT_TOP + line*FH;
+    lcdDrawText(MENUS_MARGIN_LEFT, y, name);
+    lcdDrawNumber(STATS_LUA_RUNS_POS, y, stats->runs, LEFT);
+    lcdDrawNumber(STATS_LUA_AVG_POS, y, stats->runs ? stats->time / stats->runs : 0, LEFT);
+    lcdDrawNumber(STATS_LUA_MAX_POS, y, stats->maxTime, LEFT);
+    lcdDrawNumber(STATS_LUA_INSTR_POS, y, stats->maxInstructions, LEFT);
+    lcdDrawNumber(STATS_LUA_ALLOC_POS, y, stats->allocated / 1024, LEFT);
+  }
+
+  lcdDrawText(LCD_W/2, MENU_FOOTER_TOP+2, STR_MENUTORESET, CENTERED);
+
+  return true;
+}
+#endif
+
 
 #if defined(DEBUG_TRACE_BUFFER)
 #define STATS_TRACES_INDEX_POS         MENUS_MARGIN_LEFT
@@ -31,10 +31,11 @@ const uint8_t BMP_HEADER[] = {
   0x11, 0x00, 0x00, 0x00, 0x00, 0x00
 };
 
+// the SD write task closes the file, once the screenshot is on the card
+FIL screenshotFile __DMA;
+
 const char * writeScreenshot()
 {
-  FIL bmpFile;
-  UINT written;
   char filename[42]; // /SCREENSHOTS/screen-2013-01-01-123540.bmp
 
   // check and create folder here
@@ -48,29 +49,31 @@ const char * writeScreenshot()
   tmp = strAppendDate(tmp, true);
   strcpy(tmp, BMP_EXT);
 
-  FRESULT result = f_open(&bmpFile, filename, FA_CREATE_ALWAYS | FA_WRITE);
+  // the previous screenshot may still be in the queue
+  sdWriteQueueFlush();
+
+  FRESULT result = f_open(&screenshotFile, filename, FA_CREATE_ALWAYS | FA_WRITE);
   if (result != FR_OK) {
     return SDCARD_ERROR(result);
   }
 
-  result = f_write(&bmpFile, BMP_HEADER, sizeof(BMP_HEADER), &written);
-  if (result != FR_OK || written != sizeof(BMP_HEADER)) {
-    f_close(&bmpFile);
-    return SDCARD_ERROR(result);
+  if (!sdWriteQueueAppend(&screenshotFile, BMP_HEADER, sizeof(BMP_HEADER))) {
+    sdWriteQueueClose(&screenshotFile);
+    return STR_SDCARD_ERROR;
   }
 
+  uint8_t line[4*((LCD_W+7)/8)];
   for (int y=LCD_H-1; y>=0; y-=1) {
     for (int x=0; x<8*((LCD_W+7)/8); x+=2) {
-      uint8_t byte = getPixel(x+1, y) + (getPixel(x, y) << 4);
-      f_write(&bmpFile, &byte, 1, &written);
-      if (result != FR_OK || written != 1) {
-        f_close(&bmpFile);
-        return SDCARD_ERROR(result);
-      }
+      line[x/2] = getPixel(x+1, y) + (getPixel(x, y) << 4);
+    }
+    if (!sdWriteQueueAppend(&screenshotFile, line, sizeof(line))) {
+      sdWriteQueueClose(&screenshotFile);
+      return STR_SDCARD_ERROR;
     }
   }
 
-  f_close(&bmpFile);
+  sdWriteQueueClose(&screenshotFile);
 
   return NULL;
-}
\ No newline at end of file
+}
@@ -20,12 +20,20 @@
 
 #include "opentx.h"
 #include "ff.h"
+#include <stdarg.h>
 
 FIL g_oLogFile __DMA;
-const pm_char * g_logError = NULL;
+const pm_char * g_logError = NULL;   // the error displayed, until the logs are stopped
 uint8_t logDelay;
 
 void writeHeader();
+#if defined(LOGS_BINARY)
+void writeBinaryHeader();
+bool writeBinaryRecord();
+bool logsBufferFlush();
+#endif
+
+#define LOGS_LABEL_LEN                 (TELEM_LABEL_LEN+7)
 
 #if defined(PCBTARANIS) || defined(PCBFLAMENCO) || defined(PCBHORUS)
   #define GET_2POS_STATE(sw) (switchState(SW_ ## sw ## 0) ? -1 : 1)
@@ -35,6 +43,40 @@ void writeHeader();
 
 #define GET_3POS_STATE(sw) (switchState(SW_ ## sw ## 0) ? -1 : (switchState(SW_ ## sw ## 2) ? 1 : 0))
 
+#if defined(SD_WRITE_QUEUE)
+// the CSV fields are formatted here, the SD write task writes them to the card
+#define LOGS_PRINTF_BUFFER_SIZE        80
+
+int logsPrintf(const char * format, ...)
+{
+  va_list arglist;
+  char tmp[LOGS_PRINTF_BUFFER_SIZE];
+
+  va_start(arglist, format);
+  int len = vsnprintf(tmp, LOGS_PRINTF_BUFFER_SIZE, format, arglist);
+  va_end(arglist);
+  if (len < 0) {
+    return len;
+  }
+  len = min<int>(len, LOGS_PRINTF_BUFFER_SIZE-1);
+  return sdWriteQueueAppend(&g_oLogFile, tmp, len) ? len : -1;
+}
+
+void logsPuts(const char * str)
+{
+  sdWriteQueueAppend(&g_oLogFile, str, strlen(str));
+}
+
+void logsPutc(char c)
+{
+  sdWriteQueueAppend(&g_oLogFile, &c, 1);
+}
+#else
+  #define logsPrintf(...)              f_printf(&g_oLogFile, __VA_ARGS__)
+  #define logsPuts(str)                f_puts(str, &g_oLogFile)
+  #define logsPutc(c)                  f_putc(c, &g_oLogFile)
+#endif
+
 
 void logsInit()
 {
@@ -104,9 +146,13 @@ const pm_char * logsOpen()
     return SDCARD_ERROR(result);
   }
 
+#if defined(LOGS_BINARY)
+  writeBinaryHeader(); // each session has its own header
+#else
   if (f_size(&g_oLogFile) == 0) {
     writeHeader();
   }
+#endif
 
   return NULL;
 }
@@ -116,8 +162,21 @@ tmr10ms_t lastLogTime = 0;
 void logsClose()
 {
   if (sdMounted()) {
-    if (f_close(&g_oLogFile) != FR_OK) {
-      // close failed, forget file
+    if (g_oLogFile.obj.fs) {
+#if defined(LOGS_BINARY)
+      if (!logsBufferFlush() && !g_logError) {
+        g_logError = STR_SDCARD_ERROR;
+        POPUP_WARNING(STR_SDCARD_ERROR);
+      }
+#endif
+      // closed by the SD write task, its write or close error is reported once it is done
+      sdWriteQueueClose(&g_oLogFile);
+      sdWriteQueueFlush();
+      if (sdWriteQueueError(&g_oLogFile) && !g_logError) {
+        g_logError = STR_SDCARD_ERROR;
+        POPUP_WARNING(STR_SDCARD_ERROR);
+      }
+      // forget the file, even when the close failed
       g_oLogFile.obj.fs = 0;
     }
     lastLogTime = 0;
@@ -132,48 +191,57 @@ getvalue_t getConvertedTelemetryValue(getvalue_t val, uint8_t unit)
 }
 #endif
 
+#if defined(CPUARM)
+// label of a sensor column, e.g. "Alt(m)"
+void getSensorLogLabel(uint8_t index, char * label)
+{
+  TelemetrySensor & sensor = g_model.telemetrySensors[index];
+  memset(label, 0, LOGS_LABEL_LEN);
+  zchar2str(label, sensor.label, TELEM_LABEL_LEN);
+  uint8_t unit = sensor.unit;
+  if (unit == UNIT_CELLS ) unit = UNIT_VOLTS;
+  if (UNIT_RAW < unit && unit < UNIT_FIRST_VIRTUAL) {
+    strcat(label, "(");
+    strncat(label, STR_VTELEMUNIT+1+3*unit, 3);
+    strcat(label, ")");
+  }
+}
+#endif
+
 void writeHeader()
 {
 #if defined(RTCLOCK)
-  f_puts("Date,Time,", &g_oLogFile);
+  logsPuts("Date,Time,");
 #else
-  f_puts("Time,", &g_oLogFile);
+  logsPuts("Time,");
 #endif
 
 #if defined(TELEMETRY_FRSKY)
 #if !defined(CPUARM)
-  f_puts("Buffer,RX,TX,A1,A2,", &g_oLogFile);
+  logsPuts("Buffer,RX,TX,A1,A2,");
 #if defined(FRSKY_HUB)
   if (IS_USR_PROTO_FRSKY_HUB()) {
-    f_puts("GPS Date,GPS Time,Long,Lat,Course,GPS Speed(kts),GPS Alt,Baro Alt(", &g_oLogFile);
-    f_puts(TELEMETRY_BARO_ALT_UNIT, &g_oLogFile);
-    f_puts("),Vertical Speed,Air Speed(kts),Temp1,Temp2,RPM,Fuel," TELEMETRY_CELLS_LABEL "Current,Consumption,Vfas,AccelX,AccelY,AccelZ,", &g_oLogFile);
+    logsPuts("GPS Date,GPS Time,Long,Lat,Course,GPS Speed(kts),GPS Alt,Baro Alt(");
+    logsPuts(TELEMETRY_BARO_ALT_UNIT);
+    logsPuts("),Vertical Speed,Air Speed(kts),Temp1,Temp2,RPM,Fuel," TELEMETRY_CELLS_LABEL "Current,Consumption,Vfas,AccelX,AccelY,AccelZ,");
   }
 #endif
 #if defined(WS_HOW_HIGH)
   if (IS_USR_PROTO_WS_HOW_HIGH()) {
-    f_puts("WSHH Alt,", &g_oLogFile);
+    logsPuts("WSHH Alt,");
   }
 #endif
 #endif
 
 #if defined(CPUARM)
-  char label[TELEM_LABEL_LEN+7];
+  char label[LOGS_LABEL_LEN];
   for (int i=0; i<MAX_TELEMETRY_SENSORS; i++) {
     if (isTelemetryFieldAvailable(i)) {
       TelemetrySensor & sensor = g_model.telemetrySensors[i];
       if (sensor.logs) {
-        memset(label, 0, sizeof(label));
-        zchar2str(label, sensor.label, TELEM_LABEL_LEN);
-        uint8_t unit = sensor.unit;
-        if (unit == UNIT_CELLS ) unit = UNIT_VOLTS;
-        if (UNIT_RAW < unit && unit < UNIT_FIRST_VIRTUAL) {
-          strcat(label, "(");
-          strncat(label, STR_VTELEMUNIT+1+3*unit, 3);
-          strcat(label, ")");
-        }
+        getSensorLogLabel(i, label);
         strcat(label, ",");
-        f_puts(label, &g_oLogFile);
+        logsPuts(label);
       }
     }
   }
@@ -185,22 +253,22 @@ void writeHeader()
     const char * p = STR_VSRCRAW + i * STR_VSRCRAW[0] + 2;
     for (uint8_t j=0; j<STR_VSRCRAW[0]-1; ++j) {
       if (!*p) break;
-      f_putc(*p, &g_oLogFile);
+      logsPutc(*p);
       ++p;
     }
-    f_putc(',', &g_oLogFile);
+    logsPutc(',');
   }
 #if defined(PCBX7)
   #define STR_SWITCHES_LOG_HEADER  "SA,SB,SC,SD,SF,SH"
 #else
   #define STR_SWITCHES_LOG_HEADER  "SA,SB,SC,SD,SE,SF,SG,SH"
 #endif
-  f_puts(STR_SWITCHES_LOG_HEADER ",LSW,", &g_oLogFile);
+  logsPuts(STR_SWITCHES_LOG_HEADER ",LSW,");
 #else
-  f_puts("Rud,Ele,Thr,Ail,P1,P2,P3,THR,RUD,ELE,3POS,AIL,GEA,TRN,", &g_oLogFile);
+  logsPuts("Rud,Ele,Thr,Ail,P1,P2,P3,THR,RUD,ELE,3POS,AIL,GEA,TRN,");
 #endif
 
-  f_puts("TxBat(V)\n", &g_oLogFile);
+  logsPuts("TxBat(V)\n");
 }
 
 uint32_t getLogicalSwitchesStates(uint8_t first)
@@ -212,10 +280,276 @@ uint32_t getLogicalSwitchesStates(uint8_t first)
   return result;
 }
 
-void logsWrite()
+#if defined(LOGS_BINARY)
+#if !defined(CPUARM)
+  #error "LOGS_BINARY needs the ARM telemetry sensors"
+#endif
+
+/*
+ * Binary logs
+ *
+ * Each logging session starts with a header and the description of the columns,
+ * followed by fixed size records. Everything is little endian and packed.
+ *
+ *   LogsHeader                     "OTXL", version, columns count, record size, session start (RTC)
+ *   LogsColumn x columns count     label (as in the CSV header), type, precision
+ *   records                        uint32_t time (10ms since the session start), then the values
+ *
+ * The records are accumulated in RAM and written by whole sectors. When the session is
+ * closed, the last sector is padded with 0xFF, so the next session (appended to the same
+ * file) starts on a sector boundary and a record time of 0xFFFFFFFF ends a session. A session
+ * interrupted by a power loss is not padded, readers find the next one by its header.
+ */
+#define LOGS_MAGIC                     "OTXL"
+#define LOGS_VERSION                   1
+#define LOGS_COLUMN_LABEL_LEN          12
+#define LOGS_SECTOR_SIZE               512
+#define LOGS_BUFFER_SIZE               (2*LOGS_SECTOR_SIZE)
+
+enum LogsColumnType {
+  LOGS_COLUMN_INT8,
+  LOGS_COLUMN_INT16,
+  LOGS_COLUMN_INT32,
+  LOGS_COLUMN_GPS,                     // int32_t latitude, int32_t longitude (1e-6 degree)
+  LOGS_COLUMN_DATETIME,                // uint16_t year, uint8_t month, day, hour, min, sec, 0
+  LOGS_COLUMN_BITS64,                  // uint32_t low, uint32_t high, shown in hexadecimal
+};
+
+PACK(struct LogsHeader {
+  char magic[4];
+  uint8_t version;
+  uint8_t columnsCount;
+  uint16_t recordSize;
+  uint32_t startTime;
+});
+
+PACK(struct LogsColumn {
+  char label[LOGS_COLUMN_LABEL_LEN];
+  uint8_t type;
+  uint8_t prec;
+});
+
+static_assert(LOGS_LABEL_LEN <= LOGS_COLUMN_LABEL_LEN, "LogsColumn label too short");
+
+#if defined(PCBFLAMENCO)
+  const char * const logsSwitchesNames[] = { "SA", "SB", "SE", "SF" };
+#elif defined(PCBX7)
+  const char * const logsSwitchesNames[] = { "SA", "SB", "SC", "SD", "SF", "SH" };
+#elif defined(PCBTARANIS) || defined(PCBHORUS)
+  const char * const logsSwitchesNames[] = { "SA", "SB", "SC", "SD", "SE", "SF", "SG", "SH" };
+#else
+  const char * const logsSwitchesNames[] = { "THR", "RUD", "ELE", "3POS", "AIL", "GEA", "TRN" };
+#endif
+
+uint8_t logsBuffer[LOGS_BUFFER_SIZE] __DMA;
+uint16_t logsBufferCount;
+bool logsBufferError;
+tmr10ms_t logsSessionStart;
+uint8_t logsSensorsCount;
+uint8_t logsSensors[MAX_TELEMETRY_SENSORS]; // the sensors logged in this session
+
+void logsBufferWrite(const void * data, uint16_t size)
 {
-  static const pm_char * error_displayed = NULL;
+  const uint8_t * src = (const uint8_t *)data;
+  while (size > 0) {
+    uint16_t count = min<uint16_t>(size, LOGS_BUFFER_SIZE - logsBufferCount);
+    memcpy(&logsBuffer[logsBufferCount], src, count);
+    logsBufferCount += count;
+    src += count;
+    size -= count;
+    if (logsBufferCount == LOGS_BUFFER_SIZE) {
+      if (!sdWriteQueueAppend(&g_oLogFile, logsBuffer, LOGS_BUFFER_SIZE)) {
+        logsBufferError = true;
+      }
+      logsBufferCount = 0;
+    }
+  }
+}
 
+// writes the pending records, padded to the next sector
+bool logsBufferFlush()
+{
+  if (logsBufferCount > 0) {
+    uint16_t size = (logsBufferCount + LOGS_SECTOR_SIZE - 1) & ~(LOGS_SECTOR_SIZE - 1);
+    memset(&logsBuffer[logsBufferCount], 0xFF, size - logsBufferCount);
+    if (!sdWriteQueueAppend(&g_oLogFile, logsBuffer, size)) {
+      TRACE("logsBufferFlush: %d bytes lost", logsBufferCount);
+      logsBufferError = true;
+    }
+    logsBufferCount = 0;
+  }
+  return !logsBufferError;
+}
+
+void logsWriteColumn(const char * label, uint8_t type, uint8_t prec=0)
+{
+  LogsColumn column;
+  memset(&column, 0, sizeof(column));
+  strncpy(column.label, label, LOGS_COLUMN_LABEL_LEN);
+  column.type = type;
+  column.prec = prec;
+  logsBufferWrite(&column, sizeof(column));
+}
+
+uint8_t getLogsColumnSize(uint8_t type)
+{
+  switch (type) {
+    case LOGS_COLUMN_INT8:
+      return 1;
+    case LOGS_COLUMN_INT16:
+      return 2;
+    case LOGS_COLUMN_INT32:
+      return 4;
+    default:
+      return 8;
+  }
+}
+
+uint8_t getSensorLogsColumnType(uint8_t index)
+{
+  TelemetrySensor & sensor = g_model.telemetrySensors[index];
+  if (sensor.unit == UNIT_GPS)
+    return LOGS_COLUMN_GPS;
+  else if (sensor.unit == UNIT_DATETIME)
+    return LOGS_COLUMN_DATETIME;
+  else
+    return LOGS_COLUMN_INT32;
+}
+
+void writeBinaryHeader()
+{
+  logsBufferCount = 0;
+  logsBufferError = false;
+  logsSessionStart = get_tmr10ms();
+
+  logsSensorsCount = 0;
+  uint16_t recordSize = sizeof(uint32_t);
+  for (int i=0; i<MAX_TELEMETRY_SENSORS; i++) {
+    if (isTelemetryFieldAvailable(i) && g_model.telemetrySensors[i].logs) {
+      logsSensors[logsSensorsCount++] = i;
+      recordSize += getLogsColumnSize(getSensorLogsColumnType(i));
+    }
+  }
+  recordSize += 2 * (NUM_STICKS+NUM_POTS+NUM_SLIDERS) + DIM(logsSwitchesNames) + 2;
+#if defined(PCBTARANIS) || defined(PCBHORUS)
+  recordSize += 8;
+#endif
+
+  LogsHeader header;
+  memcpy(header.magic, LOGS_MAGIC, sizeof(header.magic));
+  header.version = LOGS_VERSION;
+  header.columnsCount = logsSensorsCount + NUM_STICKS+NUM_POTS+NUM_SLIDERS + DIM(logsSwitchesNames) + 1;
+#if defined(PCBTARANIS) || defined(PCBHORUS)
+  header.columnsCount += 1;
+#endif
+  header.recordSize = recordSize;
+#if defined(RTCLOCK)
+  header.startTime = g_rtcTime;
+#else
+  header.startTime = 0;
+#endif
+  logsBufferWrite(&header, sizeof(header));
+
+  char label[LOGS_LABEL_LEN];
+  for (uint8_t i=0; i<logsSensorsCount; i++) {
+    getSensorLogLabel(logsSensors[i], label);
+    logsWriteColumn(label, getSensorLogsColumnType(logsSensors[i]), g_model.telemetrySensors[logsSensors[i]].prec);
+  }
+
+  for (uint8_t i=0; i<NUM_STICKS+NUM_POTS+NUM_SLIDERS; i++) {
+    const char * p = STR_VSRCRAW + (i+1) * STR_VSRCRAW[0] + 2;
+    uint8_t len = 0;
+    while (len < STR_VSRCRAW[0]-1 && p[len]) {
+      label[len] = p[len];
+      len++;
+    }
+    label[len] = '\0';
+    logsWriteColumn(label, LOGS_COLUMN_INT16);
+  }
+
+  for (uint8_t i=0; i<DIM(logsSwitchesNames); i++) {
+    logsWriteColumn(logsSwitchesNames[i], LOGS_COLUMN_INT8);
+  }
+
+#if defined(PCBTARANIS) || defined(PCBHORUS)
+  logsWriteColumn("LSW", LOGS_COLUMN_BITS64);
+#endif
+
+  logsWriteColumn("TxBat(V)", LOGS_COLUMN_INT16, 1);
+}
+
+bool writeBinaryRecord()
+{
+  uint32_t time = get_tmr10ms() - logsSessionStart;
+  logsBufferWrite(&time, sizeof(time));
+
+  for (uint8_t i=0; i<logsSensorsCount; i++) {
+    uint8_t index = logsSensors[i];
+    TelemetryItem & telemetryItem = telemetryItems[index];
+    switch (getSensorLogsColumnType(index)) {
+      case LOGS_COLUMN_GPS:
+        logsBufferWrite(&telemetryItem.gps.latitude, sizeof(int32_t));
+        logsBufferWrite(&telemetryItem.gps.longitude, sizeof(int32_t));
+        break;
+      case LOGS_COLUMN_DATETIME:
+      {
+        uint8_t datetime[8] = { uint8_t(telemetryItem.datetime.year), uint8_t(telemetryItem.datetime.year >> 8), telemetryItem.datetime.month, telemetryItem.datetime.day, telemetryItem.datetime.hour, telemetryItem.datetime.min, telemetryItem.datetime.sec, 0 };
+        logsBufferWrite(datetime, sizeof(datetime));
+        break;
+      }
+      default:
+        logsBufferWrite(&telemetryItem.value, sizeof(int32_t));
+        break;
+    }
+  }
+
+  logsBufferWrite(calibratedAnalogs, 2 * (NUM_STICKS+NUM_POTS+NUM_SLIDERS));
+
+  int8_t switches[DIM(logsSwitchesNames)];
+  uint8_t count = 0;
+#if defined(PCBFLAMENCO)
+  switches[count++] = GET_3POS_STATE(SA);
+  switches[count++] = GET_3POS_STATE(SB);
+  switches[count++] = GET_2POS_STATE(SE);
+  switches[count++] = GET_3POS_STATE(SF);
+#elif defined(PCBTARANIS) || defined(PCBHORUS)
+  switches[count++] = GET_3POS_STATE(SA);
+  switches[count++] = GET_3POS_STATE(SB);
+  switches[count++] = GET_3POS_STATE(SC);
+  switches[count++] = GET_3POS_STATE(SD);
+#if !defined(PCBX7)
+  switches[count++] = GET_3POS_STATE(SE);
+#endif
+  switches[count++] = GET_2POS_STATE(SF);
+#if !defined(PCBX7)
+  switches[count++] = GET_3POS_STATE(SG);
+#endif
+  switches[count++] = GET_2POS_STATE(SH);
+#else
+  switches[count++] = GET_2POS_STATE(THR);
+  switches[count++] = GET_2POS_STATE(RUD);
+  switches[count++] = GET_2POS_STATE(ELE);
+  switches[count++] = GET_3POS_STATE(ID);
+  switches[count++] = GET_2POS_STATE(AIL);
+  switches[count++] = GET_2POS_STATE(GEA);
+  switches[count++] = GET_2POS_STATE(TRN);
+#endif
+  logsBufferWrite(switches, sizeof(switches));
+
+#if defined(PCBTARANIS) || defined(PCBHORUS)
+  uint32_t logicalSwitches[2] = { getLogicalSwitchesStates(0), getLogicalSwitchesStates(32) };
+  logsBufferWrite(logicalSwitches, sizeof(logicalSwitches));
+#endif
+
+  int16_t vbat = g_vbat100mV;
+  logsBufferWrite(&vbat, sizeof(vbat));
+
+  return !logsBufferError;
+}
+#endif
+
+void logsWrite()
+{
   if (isFunctionActive(FUNCTION_LOGS) && logDelay > 0) {
     tmr10ms_t tmr10ms = get_tmr10ms();
     if (lastLogTime == 0 || (tmr10ms_t)(tmr10ms - lastLogTime) >= (tmr10ms_t)logDelay*10) {
@@ -224,14 +558,21 @@ void logsWrite()
       if (!g_oLogFile.obj.fs) {
         const pm_char * result = logsOpen();
         if (result != NULL) {
-          if (result != error_displayed) {
-            error_displayed = result;
+          if (result != g_logError) {
+            g_logError = result;
             POPUP_WARNING(result);
           }
           return;
         }
       }
 
+#if defined(LOGS_BINARY)
+      if (!writeBinaryRecord() && !g_logError) {
+        g_logError = STR_SDCARD_ERROR;
+        POPUP_WARNING(STR_SDCARD_ERROR);
+        logsClose();
+      }
+#else
 #if defined(RTCLOCK)
       {
         static struct gtm utm;
@@ -240,25 +581,25 @@ void logsWrite()
           lastRtcTime = g_rtcTime;
           gettime(&utm);
         }
-        f_printf(&g_oLogFile, "%4d-%02d-%02d,%02d:%02d:%02d.%02d0,", utm.tm_year+TM_YEAR_BASE, utm.tm_mon+1, utm.tm_mday, utm.tm_hour, utm.tm_min, utm.tm_sec, g_ms100);
+        logsPrintf("%4d-%02d-%02d,%02d:%02d:%02d.%02d0,", utm.tm_year+TM_YEAR_BASE, utm.tm_mon+1, utm.tm_mday, utm.tm_hour, utm.tm_min, utm.tm_sec, g_ms100);
       }
 #else
-      f_printf(&g_oLogFile, "%d,", tmr10ms);
+      logsPrintf("%d,", tmr10ms);
 #endif
 
 #if defined(TELEMETRY_FRSKY)
 #if !defined(CPUARM)
-      f_printf(&g_oLogFile, "%d,%d,%d,", telemetryStreaming, RAW_FRSKY_MINMAX(telemetryData.rssi[0]), RAW_FRSKY_MINMAX(telemetryData.rssi[1]));
+      logsPrintf("%d,%d,%d,", telemetryStreaming, RAW_FRSKY_MINMAX(telemetryData.rssi[0]), RAW_FRSKY_MINMAX(telemetryData.rssi[1]));
       for (uint8_t i=0; i<MAX_FRSKY_A_CHANNELS; i++) {
         int16_t converted_value = applyChannelRatio(i, RAW_FRSKY_MINMAX(telemetryData.analog[i]));
-        f_printf(&g_oLogFile, "%d.%02d,", converted_value/100, converted_value%100);
+        logsPrintf("%d.%02d,", converted_value/100, converted_value%100);
       }
 
 #if defined(FRSKY_HUB)
       TELEMETRY_BARO_ALT_PREPARE();
 
       if (IS_USR_PROTO_FRSKY_HUB()) {
-        f_printf(&g_oLogFile, "%4d-%02d-%02d,%02d:%02d:%02d,%03d.%04d%c,%03d.%04d%c,%03d.%02d," TELEMETRY_GPS_SPEED_FORMAT TELEMETRY_GPS_ALT_FORMAT TELEMETRY_BARO_ALT_FORMAT TELEMETRY_VSPEED_FORMAT TELEMETRY_ASPEED_FORMAT "%d,%d,%d,%d," TELEMETRY_CELLS_FORMAT TELEMETRY_CURRENT_FORMAT "%d," TELEMETRY_VFAS_FORMAT "%d,%d,%d,",
+        logsPrintf("%4d-%02d-%02d,%02d:%02d:%02d,%03d.%04d%c,%03d.%04d%c,%03d.%02d," TELEMETRY_GPS_SPEED_FORMAT TELEMETRY_GPS_ALT_FORMAT TELEMETRY_BARO_ALT_FORMAT TELEMETRY_VSPEED_FORMAT TELEMETRY_ASPEED_FORMAT "%d,%d,%d,%d," TELEMETRY_CELLS_FORMAT TELEMETRY_CURRENT_FORMAT "%d," TELEMETRY_VFAS_FORMAT "%d,%d,%d,",
             telemetryData.hub.year+2000,
             telemetryData.hub.month,
             telemetryData.hub.day,
@@ -294,7 +635,7 @@ void logsWrite()
 
 #if defined(WS_HOW_HIGH)
       if (IS_USR_PROTO_WS_HOW_HIGH()) {
-        f_printf(&g_oLogFile, "%d,", TELEMETRY_RELATIVE_BARO_ALT_BP);
+        logsPrintf("%d,", TELEMETRY_RELATIVE_BARO_ALT_BP);
       }
 #endif
 #endif
@@ -308,29 +649,29 @@ void logsWrite()
             if (sensor.unit == UNIT_GPS) {
               if (telemetryItem.gps.longitude && telemetryItem.gps.latitude) {
                 div_t qr = div((int)telemetryItem.gps.latitude, 1000000);
-                f_printf(&g_oLogFile, "%d.%06d ", qr.quot, abs(qr.rem));
+                logsPrintf("%d.%06d ", qr.quot, abs(qr.rem));
                 qr = div((int)telemetryItem.gps.longitude, 1000000);
-                f_printf(&g_oLogFile, "%d.%06d,", qr.quot, abs(qr.rem));
+                logsPrintf("%d.%06d,", qr.quot, abs(qr.rem));
               }
               else {
-                f_printf(&g_oLogFile, ",");
+                logsPrintf(",");
               }
             }
             else if (sensor.unit == UNIT_DATETIME) {
-              f_printf(&g_oLogFile, "%4d-%02d-%02d %02d:%02d:%02d,", telemetryItem.datetime.year, telemetryItem.datetime.month, telemetryItem.datetime.day, telemetryItem.datetime.hour, telemetryItem.datetime.min, telemetryItem.datetime.sec);
+              logsPrintf("%4d-%02d-%02d %02d:%02d:%02d,", telemetryItem.datetime.year, telemetryItem.datetime.month, telemetryItem.datetime.day, telemetryItem.datetime.hour, telemetryItem.datetime.min, telemetryItem.datetime.sec);
             }
             else if (sensor.prec == 2) {
               div_t qr = div((int)telemetryItem.value, 100);
-              if (telemetryItem.value < 0) f_printf(&g_oLogFile, "-");
-              f_printf(&g_oLogFile, "%d.%02d,", abs(qr.quot), abs(qr.rem));
+              if (telemetryItem.value < 0) logsPrintf("-");
+              logsPrintf("%d.%02d,", abs(qr.quot), abs(qr.rem));
             }
             else if (sensor.prec == 1) {
               div_t qr = div((int)telemetryItem.value, 10);
-              if (telemetryItem.value < 0) f_printf(&g_oLogFile, "-");
-              f_printf(&g_oLogFile, "%d.%d,", abs(qr.quot), abs(qr.rem));
+              if (telemetryItem.value < 0) logsPrintf("-");
+              logsPrintf("%d.%d,", abs(qr.quot), abs(qr.rem));
             }
             else {
-              f_printf(&g_oLogFile, "%d,", telemetryItem.value);
+              logsPrintf("%d,", telemetryItem.value);
             }
           }
         }
@@ -339,18 +680,18 @@ void logsWrite()
 #endif
 
       for (uint8_t i=0; i<NUM_STICKS+NUM_POTS+NUM_SLIDERS; i++) {
-        f_printf(&g_oLogFile, "%d,", calibratedAnalogs[i]);
+        logsPrintf("%d,", calibratedAnalogs[i]);
       }
 
 #if defined(PCBFLAMENCO)
-      f_printf(&g_oLogFile, "%d,%d,%d,%d,",
+      logsPrintf("%d,%d,%d,%d,",
           GET_3POS_STATE(SA),
           GET_3POS_STATE(SB),
           // GET_3POS_STATE(SC),
           GET_2POS_STATE(SE),
           GET_3POS_STATE(SF));
 #elif defined(PCBTARANIS) || defined(PCBHORUS)
-      f_printf(&g_oLogFile, "%d,%d,%d,%d,%d,%d,%d,%d,0x%08X%08X,",
+      logsPrintf("%d,%d,%d,%d,%d,%d,%d,%d,0x%08X%08X,",
           GET_3POS_STATE(SA),
           GET_3POS_STATE(SB),
           GET_3POS_STATE(SC),
@@ -366,7 +707,7 @@ void logsWrite()
           getLogicalSwitchesStates(32),
           getLogicalSwitchesStates(0));
 #else
-      f_printf(&g_oLogFile, "%d,%d,%d,%d,%d,%d,%d,",
+      logsPrintf("%d,%d,%d,%d,%d,%d,%d,",
           GET_2POS_STATE(THR),
           GET_2POS_STATE(RUD),
           GET_2POS_STATE(ELE),
@@ -377,17 +718,18 @@ void logsWrite()
 #endif
 
       div_t qr = div(g_vbat100mV, 10);
-      int result = f_printf(&g_oLogFile, "%d.%d\n", abs(qr.quot), abs(qr.rem));
+      int result = logsPrintf("%d.%d\n", abs(qr.quot), abs(qr.rem));
 
-      if (result<0 && !error_displayed) {
-        error_displayed = STR_SDCARD_ERROR;
+      if (result<0 && !g_logError) {
+        g_logError = STR_SDCARD_ERROR;
         POPUP_WARNING(STR_SDCARD_ERROR);
         logsClose();
       }
+#endif
     }
   }
   else {
-    error_displayed = NULL;
+    g_logError = NULL;
     if (g_oLogFile.obj.fs) {
       logsClose();
     }
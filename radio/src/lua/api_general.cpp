@@ -222,43 +222,76 @@ void luaGetValueAndPush(lua_State* L, int src)
   }
 }
 
+static const LuaSingleField * luaFindSingleField(const char * name)
+{
+  // luaSingleFields[] is sorted by name at build time
+  int first = 0;
+  int last = DIM(luaSingleFields) - 1;
+  while (first <= last) {
+    int n = (first + last) / 2;
+    int cmp = strcmp(name, luaSingleFields[n].name);
+    if (cmp == 0)
+      return &luaSingleFields[n];
+    else if (cmp < 0)
+      last = n - 1;
+    else
+      first = n + 1;
+  }
+  return NULL;
+}
+
 /**
-  Return field data for a given field name
+  Return the telemetry field index (0 = value, 1 = min, 2 = max) if name matches the telemetry sensor, -1 otherwise
 */
-bool luaFindFieldByName(const char * name, LuaField & field, unsigned int flags)
+static int luaMatchTelemetryField(int sensor, const char * name)
 {
-  // TODO better search method (binary lookup)
-  for (unsigned int n=0; n<DIM(luaSingleFields); ++n) {
-    if (!strcmp(name, luaSingleFields[n].name)) {
-      field.id = luaSingleFields[n].id;
-      if (flags & FIND_FIELD_DESC) {
-        strncpy(field.desc, luaSingleFields[n].desc, sizeof(field.desc)-1);
-        field.desc[sizeof(field.desc)-1] = '\0';
-      }
-      else {
-        field.desc[0] = '\0';
-      }
-      return true;
+  if (isTelemetryFieldAvailable(sensor)) {
+    char sensorName[TELEM_LABEL_LEN+1];
+    int len = zchar2str(sensorName, g_model.telemetrySensors[sensor].label, TELEM_LABEL_LEN);
+    if (!strncmp(sensorName, name, len)) {
+      if (name[len] == '\0')
+        return 0;
+      else if (name[len] == '-' && name[len+1] == '\0')
+        return 1;
+      else if (name[len] == '+' && name[len+1] == '\0')
+        return 2;
     }
   }
+  return -1;
+}
+
+static bool luaSearchFieldByName(const char * name, LuaField & field, unsigned int flags)
+{
+  const LuaSingleField * single = luaFindSingleField(name);
+  if (single) {
+    field.id = single->id;
+    if (flags & FIND_FIELD_DESC) {
+      strncpy(field.desc, single->desc, sizeof(field.desc)-1);
+      field.desc[sizeof(field.desc)-1] = '\0';
+    }
+    else {
+      field.desc[0] = '\0';
+    }
+    return true;
+  }
 
   // search in multiples
   unsigned int len = strlen(name);
-  for (unsigned int n=0; n<DIM(luaMultipleFields); ++n) {
-    const char * fieldName = luaMultipleFields[n].name;
-    unsigned int fieldLen = strlen(fieldName);
-    if (!strncmp(name, fieldName, fieldLen)) {
-      unsigned int index;
-      if (len == fieldLen+1 && isdigit(name[fieldLen])) {
-        index = name[fieldLen] - '1';
-      }
-      else if (len == fieldLen+2 && isdigit(name[fieldLen]) && isdigit(name[fieldLen+1])) {
-        index = 10 * (name[fieldLen] - '0') + (name[fieldLen+1] - '1');
-      }
-      else {
-        continue;
-      }
-      if (index < luaMultipleFields[n].count) {
+  unsigned int fieldLen = len;
+  while (fieldLen > 0 && len - fieldLen < 2 && isdigit(name[fieldLen-1])) {
+    fieldLen--;
+  }
+  if (fieldLen < len) {
+    unsigned int index;
+    if (len == fieldLen+1) {
+      index = name[fieldLen] - '1';
+    }
+    else {
+      index = 10 * (name[fieldLen] - '0') + (name[fieldLen+1] - '1');
+    }
+    for (unsigned int n=0; n<DIM(luaMultipleFields); ++n) {
+      const char * fieldName = luaMultipleFields[n].name;
+      if (strlen(fieldName) == fieldLen && !strncmp(name, fieldName, fieldLen) && index < luaMultipleFields[n].count) {
         field.id = luaMultipleFields[n].id + index;
         if (flags & FIND_FIELD_DESC) {
           snprintf(field.desc, sizeof(field.desc)-1, luaMultipleFields[n].desc, index+1);
@@ -275,32 +308,81 @@ bool luaFindFieldByName(const char * name, LuaField & field, unsigned int flags)
   // search in telemetry
   field.desc[0] = '\0';
   for (int i=0; i<MAX_TELEMETRY_SENSORS; i++) {
-    if (isTelemetryFieldAvailable(i)) {
-      char sensorName[TELEM_LABEL_LEN+1];
-      int len = zchar2str(sensorName, g_model.telemetrySensors[i].label, TELEM_LABEL_LEN);
-      if (!strncmp(sensorName, name, len)) {
-        if (name[len] == '\0') {
-          field.id = MIXSRC_FIRST_TELEM + 3*i;
-          field.desc[0] = '\0';
-          return true;
-        }
-        else if (name[len] == '-' && name[len+1] == '\0') {
-          field.id = MIXSRC_FIRST_TELEM + 3*i + 1;
-          field.desc[0] = '\0';
-          return true;
-        }
-        else if (name[len] == '+' && name[len+1] == '\0') {
-          field.id = MIXSRC_FIRST_TELEM + 3*i + 2;
-          field.desc[0] = '\0';
-          return true;
-        }
-      }
+    int index = luaMatchTelemetryField(i, name);
+    if (index >= 0) {
+      field.id = MIXSRC_FIRST_TELEM + 3*i + index;
+      return true;
     }
   }
 
   return false;  // not found
 }
 
+/*
+  Cache of the last field names found, scripts usually call getValue() with the same names
+  at each run. The telemetry fields are checked again, the sensors may have changed.
+*/
+#if defined(COLORLCD)
+  #define LUA_FIELD_CACHE_SIZE         32
+#else
+  #define LUA_FIELD_CACHE_SIZE         16
+#endif
+
+struct LuaFieldCacheEntry {
+  char name[14];
+  uint16_t id;
+};
+
+static LuaFieldCacheEntry luaFieldCache[LUA_FIELD_CACHE_SIZE];
+
+static LuaFieldCacheEntry * luaGetFieldCacheEntry(const char * name)
+{
+  uint8_t hash = 0;
+  unsigned int len = 0;
+  while (name[len]) {
+    hash = (hash << 1) + (hash >> 7) + (uint8_t)name[len++];
+  }
+  if (len >= sizeof(luaFieldCache[0].name)) {
+    return NULL;
+  }
+  return &luaFieldCache[hash % LUA_FIELD_CACHE_SIZE];
+}
+
+/**
+  Return field data for a given field name
+*/
+bool luaFindFieldByName(const char * name, LuaField & field, unsigned int flags)
+{
+  LuaFieldCacheEntry * entry = NULL;
+
+  if (!(flags & FIND_FIELD_DESC)) {
+    entry = luaGetFieldCacheEntry(name);
+    if (entry && !strcmp(entry->name, name)) {
+      if (entry->id < MIXSRC_FIRST_TELEM || entry->id > MIXSRC_LAST_TELEM) {
+        field.id = entry->id;
+        field.desc[0] = '\0';
+        return true;
+      }
+      div_t qr = div(entry->id - MIXSRC_FIRST_TELEM, 3);
+      if (luaMatchTelemetryField(qr.quot, name) == qr.rem) {
+        field.id = entry->id;
+        field.desc[0] = '\0';
+        return true;
+      }
+    }
+  }
+
+  if (!luaSearchFieldByName(name, field, flags)) {
+    return false;
+  }
+
+  if (entry) {
+    strcpy(entry->name, name);
+    entry->id = field.id;
+  }
+  return true;
+}
+
 /*luadoc
 @function sportTelemetryPop()
 
@@ -509,6 +591,25 @@ static int luaGetFieldInfo(lua_State * L)
   return 0;
 }
 
+// source identifier (number) or name (string), as accepted by getValue()
+static int luaGetSource(lua_State * L, int index)
+{
+  int src = 0;
+  if (lua_isnumber(L, index)) {
+    src = luaL_checkinteger(L, index);
+  }
+  else {
+    // convert from field name to its id
+    const char *name = luaL_checkstring(L, index);
+    LuaField field;
+    bool found = luaFindFieldByName(name, field);
+    if (found) {
+      src = field.id;
+    }
+  }
+  return src;
+}
+
 /*luadoc
 @function getValue(source)
 
@@ -557,23 +658,124 @@ While `Cels` sensor returns current values of all cells in a table, a `Cels+` or
 */
 static int luaGetValue(lua_State * L)
 {
-  int src = 0;
-  if (lua_isnumber(L, 1)) {
-    src = luaL_checkinteger(L, 1);
-  }
-  else {
-    // convert from field name to its id
-    const char *name = luaL_checkstring(L, 1);
-    LuaField field;
-    bool found = luaFindFieldByName(name, field);
-    if (found) {
-      src = field.id;
+  luaGetValueAndPush(L, luaGetSource(L, 1));
+  return 1;
+}
+
+/*luadoc
+@function addSensorHistory(source)
+
+Start recording the history of a telemetry sensor. The value is sampled every
+second, the 10 seconds and 1 minute resolutions are averages of these samples.
+The last 60 samples of each resolution are kept by the firmware, reading them
+with getSensorHistory() or lcd.drawHistory() does not allocate any Lua memory.
+The history is kept until the script is unloaded or the model is changed
+
+@param source (number or string) the sensor value, its identifier (number)
+obtained by getFieldInfo() or its name (string)
+
+@retval number history slot. If the sensor is already recorded by this script,
+its slot is returned. `nil` is returned when the source is not a telemetry
+sensor value or when all the slots are used
+
+@status current Introduced in 2.2.0
+*/
+static int luaAddSensorHistory(lua_State * L)
+{
+  int src = luaGetSource(L, 1);
+  if (src >= MIXSRC_FIRST_TELEM && src <= MIXSRC_LAST_TELEM && (src - MIXSRC_FIRST_TELEM) % 3 == 0) {
+    int slot = telemetryHistoryAdd((src - MIXSRC_FIRST_TELEM) / 3, luaRunningScript);
+    if (slot >= 0) {
+      lua_pushinteger(L, slot);
+      return 1;
     }
   }
-  luaGetValueAndPush(L, src);
+  lua_pushnil(L);
   return 1;
 }
 
+/*luadoc
+@function delSensorHistory(slot)
+
+Stop recording a sensor history and free its slot. A script can only free
+the slots it has added, an error is raised for the slots of the other scripts
+
+@param slot (number) history slot returned by addSensorHistory()
+
+@status current Introduced in 2.2.0
+*/
+static int luaDelSensorHistory(lua_State * L)
+{
+  unsigned int slot = luaL_checkunsigned(L, 1);
+  if (slot >= TELEMETRY_HISTORY_SLOTS || telemetryHistory[slot].owner != luaRunningScript) {
+    return luaL_error(L, "delSensorHistory: slot %d not added by this script", slot);
+  }
+  telemetryHistoryRemove(slot);
+  return 0;
+}
+
+/*luadoc
+@function getSensorHistory(slot, resolution [, index])
+
+Return the recorded history of a sensor
+
+@param slot (number) history slot returned by addSensorHistory()
+
+@param resolution (number) `HISTORY_1S`, `HISTORY_10S` or `HISTORY_1MIN`
+
+@param index (number) sample index, 1 is the oldest sample
+
+@retval number when index is given, the sample value, `nil` if the sensor was
+not received during this sample
+
+@retval multiple when index is not given, returns 3 values:
+ * (number) count of samples
+ * (number) minimum value, not returned if there is no value
+ * (number) maximum value, not returned if there is no value
+
+@retval nil the slot is not used
+
+@status current Introduced in 2.2.0
+*/
+static void luaPushSensorHistoryValue(lua_State * L, const TelemetrySensor & sensor, int32_t value)
+{
+  if (sensor.prec > 0)
+    lua_pushnumber(L, float(value)/sensor.getPrecDivisor());
+  else
+    lua_pushinteger(L, value);
+}
+
+static int luaGetSensorHistory(lua_State * L)
+{
+  unsigned int slot = luaL_checkunsigned(L, 1);
+  unsigned int resolution = luaL_checkunsigned(L, 2);
+  const TelemetryHistoryRing * ring = getTelemetryHistory(slot, resolution);
+  if (!ring) {
+    lua_pushnil(L);
+    return 1;
+  }
+
+  const TelemetrySensor & sensor = g_model.telemetrySensors[telemetryHistory[slot].sensor-1];
+  if (lua_gettop(L) >= 3) {
+    unsigned int index = luaL_checkunsigned(L, 3);
+    int32_t value = (index >= 1 && index <= ring->count ? ring->get(index-1) : TELEMETRY_HISTORY_NO_VALUE);
+    if (value == TELEMETRY_HISTORY_NO_VALUE)
+      lua_pushnil(L);
+    else
+      luaPushSensorHistoryValue(L, sensor, value);
+    return 1;
+  }
+
+  lua_pushinteger(L, ring->count);
+  int32_t min, max;
+  if (!ring->getRange(min, max)) {
+    return 1;
+  }
+  luaPushSensorHistoryValue(L, sensor, min);
+  luaPushSensorHistoryValue(L, sensor, max);
+  return 3;
+}
+
 /*luadoc
 @function getRAS()
 
@@ -1190,6 +1392,9 @@ const luaL_Reg opentxLib[] = {
   { "getValue", luaGetValue },
   { "getRAS", luaGetRAS },
   { "getFieldInfo", luaGetFieldInfo },
+  { "addSensorHistory", luaAddSensorHistory },
+  { "delSensorHistory", luaDelSensorHistory },
+  { "getSensorHistory", luaGetSensorHistory },
   { "getFlightMode", luaGetFlightMode },
   { "playFile", luaPlayFile },
   { "playNumber", luaPlayNumber },
@@ -1328,6 +1533,19 @@ const luaR_value_entry opentxConstants[] = {
 #endif
   { "SOLID", SOLID },
   { "DOTTED", DOTTED },
+  { "DRAW_POINT", DRAW_POINT },
+  { "DRAW_LINE", DRAW_LINE },
+  { "DRAW_TEXT", DRAW_TEXT },
+  { "DRAW_NUMBER", DRAW_NUMBER },
+  { "DRAW_TIMER", DRAW_TIMER },
+  { "DRAW_RECT", DRAW_RECT },
+  { "DRAW_FILLED_RECT", DRAW_FILLED_RECT },
+#if defined(COLORLCD)
+  { "DRAW_SET_COLOR", DRAW_SET_COLOR },
+#endif
+  { "HISTORY_1S", TELEMETRY_HISTORY_1S },
+  { "HISTORY_10S", TELEMETRY_HISTORY_10S },
+  { "HISTORY_1MIN", TELEMETRY_HISTORY_1MIN },
   { "LCD_W", LCD_W },
   { "LCD_H", LCD_H },
   { "PLAY_NOW", PLAY_NOW },
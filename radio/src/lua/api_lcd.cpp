@@ -96,28 +96,32 @@ whole line will not be drawn (starting from OpenTX 2.1.5)
 
 @status current Introduced in 2.0.0
 */
-static int luaLcdDrawLine(lua_State *L)
+static void luaDrawLine(int x1, int y1, int x2, int y2, int pat, int flags)
 {
-  if (!luaLcdAllowed) return 0;
-  int x1 = luaL_checkinteger(L, 1);
-  int y1 = luaL_checkinteger(L, 2);
-  int x2 = luaL_checkinteger(L, 3);
-  int y2 = luaL_checkinteger(L, 4);
-  int pat = luaL_checkinteger(L, 5);
-  int flags = luaL_checkinteger(L, 6);
-
   if (pat == SOLID) {
     if (x1 == x2) {
       lcdDrawSolidVerticalLine(x1, y2 >= y1 ? y1 : y1+1, y2 >= y1 ? y2-y1+1 : y2-y1-1, flags);
-      return 0;
+      return;
     }
     else if (y1 == y2) {
       lcdDrawSolidHorizontalLine(x2 >= x1 ? x1 : x1+1, y1, x2 >= x1 ? x2-x1+1 : x2-x1-1, flags);
-      return 0;
+      return;
     }
   }
 
   lcdDrawLine(x1, y1, x2, y2, pat, flags);
+}
+
+static int luaLcdDrawLine(lua_State *L)
+{
+  if (!luaLcdAllowed) return 0;
+  int x1 = luaL_checkinteger(L, 1);
+  int y1 = luaL_checkinteger(L, 2);
+  int x2 = luaL_checkinteger(L, 3);
+  int y2 = luaL_checkinteger(L, 4);
+  int pat = luaL_checkinteger(L, 5);
+  int flags = luaL_checkinteger(L, 6);
+  luaDrawLine(x1, y1, x2, y2, pat, flags);
   return 0;
 }
 
@@ -189,6 +193,15 @@ Display a value formatted as time at (x,y)
 
 @status current Introduced in 2.0.0
 */
+static void luaDrawTimer(int x, int y, int seconds, unsigned int att)
+{
+#if defined(COLORLCD)
+  drawTimer(x, y, seconds, att|LEFT);
+#else
+  drawTimer(x, y, seconds, att|LEFT, att);
+#endif
+}
+
 static int luaLcdDrawTimer(lua_State *L)
 {
   if (!luaLcdAllowed) return 0;
@@ -196,11 +209,7 @@ static int luaLcdDrawTimer(lua_State *L)
   int y = luaL_checkinteger(L, 2);
   int seconds = luaL_checkinteger(L, 3);
   unsigned int att = luaL_optunsigned(L, 4, 0);
-#if defined(COLORLCD)
-  drawTimer(x, y, seconds, att|LEFT);
-#else
-  drawTimer(x, y, seconds, att|LEFT, att);
-#endif
+  luaDrawTimer(x, y, seconds, att);
   return 0;
 }
 
@@ -576,6 +585,205 @@ static int luaLcdDrawGauge(lua_State *L)
   return 0;
 }
 
+/*luadoc
+@function lcd.drawHistory(x, y, w, h, slot, resolution [, flags])
+
+Draw the history of a telemetry sensor recorded with addSensorHistory(). The
+curve is scaled to the minimum and maximum recorded values, the last sample is
+on the right side. Nothing is allocated, the samples are read in place
+
+@param x,y (positive numbers) top left corner position
+
+@param w (number) width in pixels
+
+@param h (number) height in pixels
+
+@param slot (number) history slot returned by addSensorHistory()
+
+@param resolution (number) `HISTORY_1S`, `HISTORY_10S` or `HISTORY_1MIN`
+
+@param flags (unsigned number) drawing flags
+
+@status current Introduced in 2.2.0
+*/
+static int luaLcdDrawHistory(lua_State *L)
+{
+  if (!luaLcdAllowed) return 0;
+  int x = luaL_checkinteger(L, 1);
+  int y = luaL_checkinteger(L, 2);
+  int w = luaL_checkinteger(L, 3);
+  int h = luaL_checkinteger(L, 4);
+  unsigned int slot = luaL_checkunsigned(L, 5);
+  unsigned int resolution = luaL_checkunsigned(L, 6);
+  unsigned int flags = luaL_optunsigned(L, 7, 0);
+
+  const TelemetryHistoryRing * ring = getTelemetryHistory(slot, resolution);
+  int32_t min, max;
+  if (!ring || w < 2 || h < 1 || !ring->getRange(min, max)) {
+    return 0;
+  }
+
+  int64_t range = (int64_t)max - min;
+  bool previous = false;
+  int previousX = 0, previousY = 0;
+  for (uint8_t i=0; i<ring->count; i++) {
+    int32_t value = ring->get(i);
+    if (value == TELEMETRY_HISTORY_NO_VALUE) {
+      previous = false;
+      continue;
+    }
+    int pointX = x + w - 1 - (ring->count - 1 - i) * (w - 1) / (TELEMETRY_HISTORY_LENGTH - 1);
+    int pointY = y + h - 1 - (range ? (int)(((int64_t)value - min) * (h - 1) / range) : (h - 1) / 2);
+    if (previous)
+      luaDrawLine(previousX, previousY, pointX, pointY, SOLID, flags);
+    else
+      lcdDrawSolidVerticalLine(pointX, pointY, 1, flags);
+    previous = true;
+    previousX = pointX;
+    previousY = pointY;
+  }
+  return 0;
+}
+
+
+/*luadoc
+@function lcd.drawBatch(commands [, count])
+
+Execute a list of drawing commands in a single call. Widgets and telemetry
+scripts which draw a lot of items on each refresh should use it instead of
+calling the individual lcd functions
+
+@param commands (table) flat array of commands. Each command is a `DRAW_xxx`
+constant immediately followed by its arguments, which have the same meaning
+as in the corresponding lcd function. All arguments are mandatory:
+ * `DRAW_POINT, x, y`
+ * `DRAW_LINE, x1, y1, x2, y2, pattern, flags`
+ * `DRAW_TEXT, x, y, text, flags`
+ * `DRAW_NUMBER, x, y, value, flags`
+ * `DRAW_TIMER, x, y, value, flags`
+ * `DRAW_RECT, x, y, w, h, flags`
+ * `DRAW_FILLED_RECT, x, y, w, h, flags`
+ * `DRAW_SET_COLOR, area, color` (only on Horus)
+
+@param count (number) number of table entries to execute, defaults to the
+length of the table. This allows to keep the same table from one refresh to
+the other, without clearing the entries left from a longer list
+
+@status current Introduced in 2.2.0
+*/
+static const uint8_t luaDrawCommandArgs[] = {
+  0,
+  2, // DRAW_POINT
+  6, // DRAW_LINE
+  4, // DRAW_TEXT
+  4, // DRAW_NUMBER
+  4, // DRAW_TIMER
+  5, // DRAW_RECT
+  5, // DRAW_FILLED_RECT
+#if defined(COLORLCD)
+  2, // DRAW_SET_COLOR
+#endif
+};
+
+#define LUA_DRAW_COMMAND_MAX_ARGS      6
+
+static int luaBatchInteger(lua_State * L, int arg, int index)
+{
+  int isnum;
+  int result = lua_tointegerx(L, arg, &isnum);
+  if (!isnum) luaL_error(L, "drawBatch: number expected at index %d", index);
+  return result;
+}
+
+static unsigned int luaBatchUnsigned(lua_State * L, int arg, int index)
+{
+  int isnum;
+  unsigned int result = lua_tounsignedx(L, arg, &isnum);
+  if (!isnum) luaL_error(L, "drawBatch: number expected at index %d", index);
+  return result;
+}
+
+static int luaLcdDrawBatch(lua_State *L)
+{
+  if (!luaLcdAllowed) return 0;
+  luaL_checktype(L, 1, LUA_TTABLE);
+  int count = luaL_optinteger(L, 2, lua_rawlen(L, 1));
+  lua_settop(L, 2);
+  luaL_checkstack(L, LUA_DRAW_COMMAND_MAX_ARGS + 1, NULL);
+
+  // arguments are fetched on the stack, at indexes 3..3+n-1
+  int index = 1;
+  while (index <= count) {
+    lua_rawgeti(L, 1, index);
+    int command = luaBatchInteger(L, 3, index);
+    if (command <= 0 || command >= (int)DIM(luaDrawCommandArgs)) {
+      return luaL_error(L, "drawBatch: invalid command at index %d", index);
+    }
+    int n = luaDrawCommandArgs[command];
+    if (index + n > count) {
+      return luaL_error(L, "drawBatch: incomplete command at index %d", index);
+    }
+    lua_settop(L, 2);
+    for (int i=1; i<=n; i++) {
+      lua_rawgeti(L, 1, index+i);
+    }
+
+#define ARG_INT(i)       luaBatchInteger(L, 2+(i), index+(i))
+#define ARG_UNSIGNED(i)  luaBatchUnsigned(L, 2+(i), index+(i))
+
+    switch (command) {
+      case DRAW_POINT:
+        lcdDrawPoint(ARG_INT(1), ARG_INT(2));
+        break;
+
+      case DRAW_LINE:
+        luaDrawLine(ARG_INT(1), ARG_INT(2), ARG_INT(3), ARG_INT(4), ARG_INT(5), ARG_INT(6));
+        break;
+
+      case DRAW_TEXT:
+      {
+        const char * text = lua_tostring(L, 2+3);
+        if (!text) return luaL_error(L, "drawBatch: string expected at index %d", index+3);
+        lcdDrawText(ARG_INT(1), ARG_INT(2), text, ARG_UNSIGNED(4));
+        break;
+      }
+
+      case DRAW_NUMBER:
+        lcdDrawNumber(ARG_INT(1), ARG_INT(2), ARG_INT(3), ARG_UNSIGNED(4));
+        break;
+
+      case DRAW_TIMER:
+        luaDrawTimer(ARG_INT(1), ARG_INT(2), ARG_INT(3), ARG_UNSIGNED(4));
+        break;
+
+      case DRAW_RECT:
+#if defined(PCBHORUS)
+        lcdDrawRect(ARG_INT(1), ARG_INT(2), ARG_INT(3), ARG_INT(4), 1, 0xff, ARG_UNSIGNED(5));
+#else
+        lcdDrawRect(ARG_INT(1), ARG_INT(2), ARG_INT(3), ARG_INT(4), 0xff, ARG_UNSIGNED(5));
+#endif
+        break;
+
+      case DRAW_FILLED_RECT:
+        lcdDrawFilledRect(ARG_INT(1), ARG_INT(2), ARG_INT(3), ARG_INT(4), SOLID, ARG_UNSIGNED(5));
+        break;
+
+#if defined(COLORLCD)
+      case DRAW_SET_COLOR:
+        lcdColorTable[ARG_UNSIGNED(1) >> 16] = ARG_UNSIGNED(2);
+        break;
+#endif
+    }
+
+#undef ARG_INT
+#undef ARG_UNSIGNED
+
+    lua_settop(L, 2);
+    index += n + 1;
+  }
+
+  return 0;
+}
 
 #if !defined(COLORLCD)
 /*luadoc
@@ -785,6 +993,8 @@ const luaL_Reg lcdLib[] = {
   { "drawSwitch", luaLcdDrawSwitch },
   { "drawSource", luaLcdDrawSource },
   { "drawGauge", luaLcdDrawGauge },
+  { "drawHistory", luaLcdDrawHistory },
+  { "drawBatch", luaLcdDrawBatch },
 #if defined(COLORLCD)
   { "drawBitmap", luaLcdDrawBitmap },
   { "setColor", luaLcdSetColor },
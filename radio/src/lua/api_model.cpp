@@ -639,6 +639,7 @@ static int luaModelInsertMix(lua_State *L)
         mix->speedDown = luaL_checkinteger(L, -1);
       }
     }
+    storageDirty(EE_MODEL);
   }
 
   return 0;
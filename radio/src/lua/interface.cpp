@@ -45,6 +45,9 @@ uint16_t maxLuaInterval = 0;
 uint16_t maxLuaDuration = 0;
 bool luaLcdAllowed;
 int instructionsPercent = 0;
+int instructionsCount = 0;
+LuaScriptStats * luaScriptStats = NULL;
+const void * luaRunningScript = NULL;  // owns the telemetry history slots added by the script
 char lua_warning_info[LUA_WARNING_INFO_LEN+1];
 struct our_longjmp * global_lj = 0;
 #if defined(COLORLCD)
@@ -76,9 +79,109 @@ void luaHook(lua_State * L, lua_Debug *ar)
 void luaSetInstructionsLimit(lua_State * L, int count)
 {
   instructionsPercent=0;
+  instructionsCount = count;
   lua_sethook(L, luaHook, LUA_MASKCOUNT, count);
 }
 
+static uint16_t luaStatsStartHiprec;
+static tmr10ms_t luaStatsStartLoprec;
+
+// the allocations are accounted to the script until luaStatsStop()
+void luaStatsStart(LuaScriptStats & stats)
+{
+  luaScriptStats = &stats;
+  luaStatsStartHiprec = getTmr2MHz();
+  luaStatsStartLoprec = get_tmr10ms();
+}
+
+void luaStatsStop()
+{
+  LuaScriptStats * stats = luaScriptStats;
+  if (!stats) {
+    return;
+  }
+  luaScriptStats = NULL;
+
+  // same as the debug timers, the 2MHz timer is only 16 bits
+  uint32_t time = (tmr10ms_t)(get_tmr10ms() - luaStatsStartLoprec);
+  if (time < 3)
+    time = (uint16_t)(getTmr2MHz() - luaStatsStartHiprec) / 2;
+  else
+    time *= 10000;
+
+  // the instructions count is known with the hook period precision
+  uint32_t instructions = instructionsPercent * instructionsCount;
+
+  stats->runs++;
+  stats->time += time;
+  if (time > stats->maxTime)
+    stats->maxTime = time;
+  stats->instructions += instructions;
+  if (instructions > stats->maxInstructions)
+    stats->maxInstructions = instructions;
+}
+
+static void luaGetScriptName(const ScriptInternalData & sid, char * name)
+{
+  const char * file;
+  unsigned int len;
+  if (sid.reference >= SCRIPT_FUNC_FIRST && sid.reference <= SCRIPT_FUNC_LAST) {
+    file = g_model.customFn[sid.reference-SCRIPT_FUNC_FIRST].play.name;
+    len = sizeof(g_model.customFn[0].play.name);
+  }
+#if defined(PCBTARANIS)
+  else if (sid.reference >= SCRIPT_TELEMETRY_FIRST && sid.reference <= SCRIPT_TELEMETRY_LAST) {
+    file = g_model.frsky.screens[sid.reference-SCRIPT_TELEMETRY_FIRST].script.file;
+    len = sizeof(g_model.frsky.screens[0].script.file);
+  }
+#endif
+  else {
+    file = g_model.scriptsData[sid.reference-SCRIPT_MIX_FIRST].file;
+    len = sizeof(g_model.scriptsData[0].file);
+  }
+  len = min<unsigned int>(len, LUA_SCRIPT_NAME_LEN);
+  strncpy(name, file, len);
+  name[len] = '\0';
+}
+
+/*
+  The scripts statistics: the permanent scripts, the standalone script and the widgets.
+  Returns NULL after the last one, name must have room for LUA_SCRIPT_NAME_LEN chars.
+*/
+const LuaScriptStats * luaGetScriptStats(int index, char * name)
+{
+  if (index < luaScriptsCount) {
+    luaGetScriptName(scriptInternalData[index], name);
+    return &scriptInternalData[index].stats;
+  }
+  index -= luaScriptsCount;
+
+  if (luaState & INTERPRETER_RUNNING_STANDALONE_SCRIPT) {
+    if (index == 0) {
+      strcpy(name, "standalone");
+      return &standaloneScript.stats;
+    }
+    index--;
+  }
+
+#if defined(COLORLCD)
+  return luaGetWidgetStats(index, name);
+#else
+  return NULL;
+#endif
+}
+
+void luaResetScriptsStats()
+{
+  for (int i=0; i<MAX_SCRIPTS; i++) {
+    memclear(&scriptInternalData[i].stats, sizeof(LuaScriptStats));
+  }
+  memclear(&standaloneScript.stats, sizeof(LuaScriptStats));
+#if defined(COLORLCD)
+  luaResetWidgetsStats();
+#endif
+}
+
 int luaGetInputs(lua_State * L, ScriptInputsOutputs & sid)
 {
   if (!lua_istable(L, -1))
@@ -169,6 +272,10 @@ void luaClose(lua_State ** L)
     }
     UNPROTECT_LUA();
     *L = NULL;
+#if defined(USE_SLAB_ALLOCATOR)
+    // the arena is kept while the other Lua state has blocks in it
+    slabAllocator.release();
+#endif
   }
 }
 
@@ -224,8 +331,76 @@ void luaDoGc(lua_State * L, bool full)
   }
 }
 
+#if defined(PCBHORUS)
+  #define LUA_GC_MEMORY_LOW    (128*1024)
+#else
+  #define LUA_GC_MEMORY_LOW    (4*1024)
+#endif
+#define LUA_GC_FULL_PERIOD     100  // 1s
+#define LUA_GC_MARGIN_TICKS    2    // 4ms
+#define LUA_GC_MAX_STEPS       16   // per menus task period
+
+static bool luaIsMemoryLow()
+{
+#if defined(SIMU)
+  return false;
+#else
+  return availableMemory() < LUA_GC_MEMORY_LOW;
+#endif
+}
+
+// a cycle is in progress, or the allocations have reached the collector threshold
+static bool luaIsGcPending(lua_State * L)
+{
+  return L && (G(L)->gcstate != GCSpause || G(L)->GCdebt > 0);
+}
+
+/*
+  Run the garbage collector in the time which is left in the menus task period (deadline
+  in OS ticks), instead of letting it run inside the scripts allocations. One step is always
+  done when some work is pending, so that the collector keeps up when the frames are full,
+  and at most LUA_GC_MAX_STEPS are done. A full collection is done only when memory is low.
+*/
+void luaDoGcSteps(uint32_t deadline)
+{
+  if (luaState == INTERPRETER_PANIC) {
+    return;
+  }
+
+  static tmr10ms_t lastFullGc = 0;
+  if (luaIsMemoryLow() && (tmr10ms_t)(get_tmr10ms() - lastFullGc) >= LUA_GC_FULL_PERIOD) {
+    lastFullGc = get_tmr10ms();
+    TRACE("luaDoGcSteps(): memory low, full collection");
+    luaDoGc(lsScripts, true);
+#if defined(COLORLCD)
+    luaDoGc(lsWidgets, true);
+#endif
+    return;
+  }
+
+  uint8_t steps = 0;
+  do {
+    bool pending = false;
+    if (luaIsGcPending(lsScripts)) {
+      luaDoGc(lsScripts, false);
+      pending = true;
+    }
+#if defined(COLORLCD)
+    if (luaIsGcPending(lsWidgets)) {
+      luaDoGc(lsWidgets, false);
+      pending = true;
+    }
+#endif
+    if (!pending || ++steps >= LUA_GC_MAX_STEPS) {
+      break;
+    }
+  } while ((int32_t)(deadline - (uint32_t)CoGetOSTime()) > LUA_GC_MARGIN_TICKS);
+}
+
 void luaFree(lua_State * L, ScriptInternalData & sid)
 {
+  telemetryHistoryRemoveOwner(&sid);
+
   PROTECT_LUA() {
     if (sid.run) {
       luaL_unref(L, LUA_REGISTRYINDEX, sid.run);
@@ -281,8 +456,284 @@ static void luaDumpState(lua_State * L, const char * filename, const FILINFO * f
   } else
     TRACE_ERROR("luaDumpState(%s): Error: Could not open output file.", filename);
 }
+
+/*
+  Bytecode cache
+
+  The compiled scripts are appended to a single file, after a table which gives for each script
+  the time and size of its source and where its bytecode is. The table is read once, and each
+  source is checked once per session (the SD card may only be modified by a PC while we are
+  stopped or in USB mass storage mode, or by the SD manager and the Lua io library, which check
+  the sources again), so that a script is then loaded with a single file open.
+  The bytecode of the modified scripts is appended again, the file is restarted when it is full.
+*/
+#define LUA_CACHE_FILE           SCRIPTS_PATH "/luacache.bin"
+#define LUA_CACHE_VERSION        2
+#if defined(PCBHORUS)
+  #define LUA_CACHE_ENTRIES      32
+  #define LUA_CACHE_MAX_SIZE     (512*1024)
+#else
+  #define LUA_CACHE_ENTRIES      16
+  #define LUA_CACHE_MAX_SIZE     (128*1024)
+#endif
+
+PACK(struct LuaCacheHeader {
+  char magic[4];
+  uint8_t version;
+  uint8_t count;
+  uint16_t spare;
+  uint32_t end;
+});
+
+PACK(struct LuaCacheEntry {
+  uint32_t hash;                  // of the source path (FNV-1a)
+  uint32_t hash2;                 // of the source path (djb2)
+  uint16_t pathLength;
+  uint16_t spare;
+  uint32_t time;                  // of the source
+  uint32_t size;                  // of the source
+  uint32_t offset;                // of the bytecode
+  uint32_t length;                // of the bytecode
+  uint8_t stripDebug;
+  uint8_t spare2[3];
+});
+
+static struct {
+  bool loaded;
+  uint32_t checked;               // entries whose source was checked in this session
+  LuaCacheHeader header;
+  LuaCacheEntry entries[LUA_CACHE_ENTRIES];
+} luaCache;
+
+static_assert(LUA_CACHE_ENTRIES <= 32, "luaCache.checked too small");
+
+#define LUA_CACHE_DATA_OFFSET    (sizeof(LuaCacheHeader) + sizeof(luaCache.entries))
+
+struct LuaCacheReader {
+  FIL file;
+  uint32_t remaining;
+  char buffer[256];
+};
+
+void luaCacheReset()
+{
+  luaCache.loaded = false;
+}
+
+void luaCacheSourcesChanged()
+{
+  luaCache.checked = 0;
+}
+
+static void luaCacheClear()
+{
+  memclear(&luaCache.header, sizeof(luaCache.header));
+  memclear(luaCache.entries, sizeof(luaCache.entries));
+  memcpy(luaCache.header.magic, "OTLC", sizeof(luaCache.header.magic));
+  luaCache.header.version = LUA_CACHE_VERSION;
+  luaCache.header.end = LUA_CACHE_DATA_OFFSET;
+  luaCache.checked = 0;
+}
+
+static void luaCacheLoadIndex()
+{
+  FIL file;
+  UINT read;
+
+  luaCache.loaded = true;
+  luaCache.checked = 0;
+
+  if (f_open(&file, LUA_CACHE_FILE, FA_OPEN_EXISTING | FA_READ) == FR_OK) {
+    if (f_read(&file, &luaCache.header, sizeof(luaCache.header), &read) == FR_OK && read == sizeof(luaCache.header) &&
+        !memcmp(luaCache.header.magic, "OTLC", sizeof(luaCache.header.magic)) && luaCache.header.version == LUA_CACHE_VERSION &&
+        luaCache.header.count <= LUA_CACHE_ENTRIES && luaCache.header.end == f_size(&file) &&
+        f_read(&file, luaCache.entries, sizeof(luaCache.entries), &read) == FR_OK && read == sizeof(luaCache.entries)) {
+      f_close(&file);
+      TRACE("luaCacheLoadIndex(): %d scripts", luaCache.header.count);
+      return;
+    }
+    f_close(&file);
+  }
+
+  luaCacheClear();
+}
+
+// the entries are matched by two hashes of the source path and its length
+static void luaCacheSetPath(LuaCacheEntry & entry, const char * filename)
+{
+  uint32_t hash = 2166136261u;
+  uint32_t hash2 = 5381;
+  uint16_t length = 0;
+  for (; filename[length]; length++) {
+    uint8_t c = filename[length];
+    hash = (hash ^ c) * 16777619u;
+    hash2 = hash2 * 33 + c;
+  }
+  entry.hash = hash;
+  entry.hash2 = hash2;
+  entry.pathLength = length;
+}
+
+static int luaCacheFind(const char * filename)
+{
+  LuaCacheEntry key;
+  luaCacheSetPath(key, filename);
+  for (int i=0; i<luaCache.header.count; i++) {
+    LuaCacheEntry & entry = luaCache.entries[i];
+    if (entry.hash == key.hash && entry.hash2 == key.hash2 && entry.pathLength == key.pathLength) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static const char * luaCacheRead(lua_State * L, void * ud, size_t * size)
+{
+  UNUSED(L);
+  LuaCacheReader * reader = (LuaCacheReader *)ud;
+  UINT read = 0;
+  if (reader->remaining > 0) {
+    f_read(&reader->file, reader->buffer, min<uint32_t>(reader->remaining, sizeof(reader->buffer)), &read);
+    reader->remaining -= read;
+    if (read == 0) {
+      reader->remaining = 0;
+    }
+  }
+  *size = read;
+  return reader->buffer;
+}
+
+/*
+  Load the bytecode of a script source from the cache.
+
+  @retval LUA_OK on success
+  @retval LUA_ERRFILE if the source doesn't exist
+  @retval -1 if the script isn't in the cache or was modified, finfo is the source info
+  @retval LUA_ERRMEM or LUA_ERRGCMM for Lua memory errors
+*/
+static int luaCacheLoad(lua_State * L, const char * filename, FILINFO * finfo, uint8_t stripDebug)
+{
+  if (!luaCache.loaded) {
+    luaCacheLoadIndex();
+  }
+
+  int index = luaCacheFind(filename);
+
+  if (index < 0 || !(luaCache.checked & (1u << index))) {
+    if (f_stat(filename, finfo) != FR_OK) {
+      return LUA_ERRFILE;
+    }
+    if (index < 0) {
+      return -1;
+    }
+    LuaCacheEntry & entry = luaCache.entries[index];
+    if (entry.time != (((uint32_t)finfo->fdate << 16) + finfo->ftime) || entry.size != finfo->fsize || entry.stripDebug != stripDebug) {
+      return -1;
+    }
+    luaCache.checked |= (1u << index);
+  }
+
+  LuaCacheEntry & entry = luaCache.entries[index];
+  LuaCacheReader reader;
+  if (f_open(&reader.file, LUA_CACHE_FILE, FA_OPEN_EXISTING | FA_READ) != FR_OK) {
+    luaCacheClear();
+    return -1;
+  }
+  reader.remaining = entry.length;
+  int status = LUA_ERRFILE;
+  if (f_lseek(&reader.file, entry.offset) == FR_OK) {
+    lua_pushfstring(L, "@%s", filename);
+    status = lua_load(L, luaCacheRead, &reader, lua_tostring(L, -1), "b");
+    lua_remove(L, -2);  // the chunk name
+  }
+  f_close(&reader.file);
+
+  if (status == LUA_OK) {
+    TRACE("luaCacheLoad(%s): loaded %d bytes", filename, entry.length);
+    return LUA_OK;
+  }
+  else if (status == LUA_ERRMEM || status == LUA_ERRGCMM) {
+    return status;
+  }
+  else {
+    // the cache is corrupted, the script will be compiled again
+    if (status != LUA_ERRFILE) {
+      TRACE_ERROR("luaCacheLoad(%s): %s", filename, lua_tostring(L, -1));
+      lua_pop(L, 1);
+    }
+    luaCache.checked &= ~(1u << index);
+    entry.time = 0;
+    return -1;
+  }
+}
+
+/*
+  Save the bytecode of a script which was just compiled (on the top of the Lua stack) to the cache.
+*/
+static void luaCacheStore(lua_State * L, const char * filename, const FILINFO * finfo, uint8_t stripDebug)
+{
+  FIL file;
+  UINT written;
+  int index = luaCacheFind(filename);
+
+  if (luaCache.header.end >= LUA_CACHE_MAX_SIZE || (index < 0 && luaCache.header.count == LUA_CACHE_ENTRIES)) {
+    // full, the other scripts will be compiled again
+    TRACE("luaCacheStore(%s): cache full, restarted", filename);
+    luaCacheClear();
+    index = -1;
+  }
+
+  if (f_open(&file, LUA_CACHE_FILE, FA_OPEN_ALWAYS | FA_WRITE) != FR_OK) {
+    TRACE_ERROR("luaCacheStore(%s): Error: Could not open cache file.", filename);
+    return;
+  }
+
+  if (index < 0) {
+    index = luaCache.header.count++;
+  }
+
+  LuaCacheEntry & entry = luaCache.entries[index];
+  luaCacheSetPath(entry, filename);
+  entry.time = ((uint32_t)finfo->fdate << 16) + finfo->ftime;
+  entry.size = finfo->fsize;
+  entry.offset = luaCache.header.end;
+  entry.stripDebug = stripDebug;
+
+  bool ok = (f_lseek(&file, entry.offset) == FR_OK);
+  if (ok) {
+    lua_lock(L);
+    ok = (luaU_dump(L, getproto(L->top - 1), luaDumpWriter, &file, stripDebug) == 0);
+    lua_unlock(L);
+  }
+  if (ok) {
+    entry.length = f_tell(&file) - entry.offset;
+    luaCache.header.end = f_tell(&file);
+    ok = (f_truncate(&file) == FR_OK && f_lseek(&file, 0) == FR_OK &&
+          f_write(&file, &luaCache.header, sizeof(luaCache.header), &written) == FR_OK && written == sizeof(luaCache.header) &&
+          f_write(&file, luaCache.entries, sizeof(luaCache.entries), &written) == FR_OK && written == sizeof(luaCache.entries));
+  }
+  if (f_close(&file) != FR_OK) {
+    ok = false;
+  }
+
+  if (ok) {
+    luaCache.checked |= (1u << index);
+    TRACE("luaCacheStore(%s): saved %d bytes", filename, entry.length);
+  }
+  else {
+    TRACE_ERROR("luaCacheStore(%s): Error: Could not write cache file.", filename);
+    f_unlink(LUA_CACHE_FILE);
+    luaCacheClear();
+  }
+}
 #endif  // LUA_COMPILER
 
+// called by the io library when a script writes to a file, which may be a script source
+void lua__filewritten()
+{
+  LUA_CACHE_SOURCES_CHANGED();
+}
+
 /**
   @fn luaLoadScriptFileToState(lua_State * L, const char * filename, const char * mode)
 
@@ -352,39 +803,64 @@ int luaLoadScriptFileToState(lua_State * L, const char * filename, const char *
   }
   strncat(filenameFull, filename, fnamelen);
 
-  // check if binary version exists
-  strcpy(filenameFull + fnamelen, SCRIPT_BIN_EXT);
-  frLuaC = f_stat(filenameFull, &fnoLuaC);
+  // when compiling is allowed, the compiled scripts are kept in the bytecode cache
+  bool useCache = (strchr(lmode, 'b') && !strpbrk(lmode, "cx"));
+  uint8_t stripDebug = (strchr(lmode, 'd') ? 0 : 1);
+  if (useCache) {
+    strcpy(filenameFull + fnamelen, SCRIPT_EXT);
+    lstatus = luaCacheLoad(L, filenameFull, &fnoLuaS, stripDebug);
+    if (lstatus == LUA_OK) {
+      return SCRIPT_OK;
+    }
+    else if (lstatus == LUA_ERRMEM || lstatus == LUA_ERRGCMM) {
+      return SCRIPT_PANIC;
+    }
+    else if (lstatus == LUA_ERRFILE) {
+      // no source, it may be a binary only script
+      useCache = false;
+    }
+    else {
+      frLuaS = FR_OK;
+      loadFileType = 1;
+      scriptNeedsCompile = true;
+    }
+  }
 
-  // check if text version exists
-  strcpy(filenameFull + fnamelen, SCRIPT_EXT);
-  frLuaS = f_stat(filenameFull, &fnoLuaS);
+  if (!loadFileType) {
+    // check if binary version exists
+    strcpy(filenameFull + fnamelen, SCRIPT_BIN_EXT);
+    frLuaC = f_stat(filenameFull, &fnoLuaC);
 
-  // decide which version to load, text or binary
-  if (frLuaC != FR_OK && frLuaS == FR_OK) {
-    // only text version exists
-    loadFileType = 1;
-    scriptNeedsCompile = true;
-  }
-  else if (frLuaC == FR_OK && frLuaS != FR_OK) {
-    // only binary version exists
-    loadFileType = 2;
-  }
-  else if (frLuaS == FR_OK) {
-    // both versions exist, compare them
-    if (strchr(lmode, 'c') || (uint32_t)((fnoLuaC.fdate << 16) + fnoLuaC.ftime) < (uint32_t)((fnoLuaS.fdate << 16) + fnoLuaS.ftime)) {
-      // text version is newer than binary or forced by "c" mode flag, rebuild it
+    // check if text version exists
+    strcpy(filenameFull + fnamelen, SCRIPT_EXT);
+    frLuaS = f_stat(filenameFull, &fnoLuaS);
+
+    // decide which version to load, text or binary
+    if (frLuaC != FR_OK && frLuaS == FR_OK) {
+      // only text version exists
+      loadFileType = 1;
       scriptNeedsCompile = true;
     }
-    if (scriptNeedsCompile || !strchr(lmode, 'b')) {
-      // text version needs compilation or forced by mode
-      loadFileType = 1;
-    } else {
-      // use binary file
+    else if (frLuaC == FR_OK && frLuaS != FR_OK) {
+      // only binary version exists
       loadFileType = 2;
     }
+    else if (frLuaS == FR_OK) {
+      // both versions exist, compare them
+      if (strchr(lmode, 'c') || (uint32_t)((fnoLuaC.fdate << 16) + fnoLuaC.ftime) < (uint32_t)((fnoLuaS.fdate << 16) + fnoLuaS.ftime)) {
+        // text version is newer than binary or forced by "c" mode flag, rebuild it
+        scriptNeedsCompile = true;
+      }
+      if (scriptNeedsCompile || !strchr(lmode, 'b')) {
+        // text version needs compilation or forced by mode
+        loadFileType = 1;
+      } else {
+        // use binary file
+        loadFileType = 2;
+      }
+    }
+    // else both versions are missing
   }
-  // else both versions are missing
 
   // skip compilation based on mode flags? ("c" overrides "x")
   if (scriptNeedsCompile && strchr(lmode, 'x') && !strchr(lmode, 'c')) {
@@ -431,8 +907,13 @@ int luaLoadScriptFileToState(lua_State * L, const char * filename, const char *
   }
   if (lstatus == LUA_OK) {
     if (scriptNeedsCompile && loadFileType == 1) {
-      strcpy(filenameFull + fnamelen, SCRIPT_BIN_EXT);
-      luaDumpState(L, filenameFull, &fnoLuaS, (strchr(lmode, 'd') ? 0 : 1));
+      if (useCache) {
+        luaCacheStore(L, filenameFull, &fnoLuaS, stripDebug);
+      }
+      else {
+        strcpy(filenameFull + fnamelen, SCRIPT_BIN_EXT);
+        luaDumpState(L, filenameFull, &fnoLuaS, stripDebug);
+      }
     }
     ret = SCRIPT_OK;
   }
@@ -469,6 +950,7 @@ static int luaLoad(lua_State * L, const char * filename, ScriptInternalData & si
 
   luaSetInstructionsLimit(L, MANUAL_SCRIPTS_MAX_INSTRUCTIONS);
 
+  luaRunningScript = &sid;
   PROTECT_LUA() {
     sid.state = luaLoadScriptFileToState(L, filename, LUA_SCRIPT_LOAD_MODE);
     if (sid.state == SCRIPT_OK && (lstatus = lua_pcall(L, 0, 1, 0)) == LUA_OK && lua_istable(L, -1)) {
@@ -510,10 +992,12 @@ static int luaLoad(lua_State * L, const char * filename, ScriptInternalData & si
     }
   }
   else {
+    luaRunningScript = NULL;
     luaDisable();
     return SCRIPT_PANIC;
   }
   UNPROTECT_LUA();
+  luaRunningScript = NULL;
 
   if (sid.state != SCRIPT_OK) {
     luaFree(L, sid);
@@ -713,6 +1197,7 @@ void luaExec(const char * filename)
 
   if (luaState != INTERPRETER_PANIC) {
     standaloneScript.state = SCRIPT_NOFILE;
+    memclear(&standaloneScript.stats, sizeof(standaloneScript.stats));
     int result = luaLoad(lsScripts, filename, standaloneScript);
     // TODO the same with run ...
     if (result == SCRIPT_OK) {
@@ -733,7 +1218,12 @@ void luaDoOneRunStandalone(event_t evt)
     luaSetInstructionsLimit(lsScripts, MANUAL_SCRIPTS_MAX_INSTRUCTIONS);
     lua_rawgeti(lsScripts, LUA_REGISTRYINDEX, standaloneScript.run);
     lua_pushunsigned(lsScripts, evt);
-    if (lua_pcall(lsScripts, 1, 1, 0) == 0) {
+    luaStatsStart(standaloneScript.stats);
+    luaRunningScript = &standaloneScript;
+    int result = lua_pcall(lsScripts, 1, 1, 0);
+    luaRunningScript = NULL;
+    luaStatsStop();
+    if (result == 0) {
       if (!lua_isnumber(lsScripts, -1)) {
         if (instructionsPercent > 100) {
           TRACE("Script killed");
@@ -870,7 +1360,12 @@ bool luaDoOneRunPermanentScript(event_t evt, int i, uint32_t scriptType)
 #endif
   }
 
-  if (lua_pcall(lsScripts, inputsCount, sio ? sio->outputsCount : 0, 0) == 0) {
+  luaStatsStart(sid.stats);
+  luaRunningScript = &sid;
+  int result = lua_pcall(lsScripts, inputsCount, sio ? sio->outputsCount : 0, 0);
+  luaRunningScript = NULL;
+  luaStatsStop();
+  if (result == 0) {
     if (sio) {
       for (int j=sio->outputsCount-1; j>=0; j--) {
         if (!lua_isnumber(lsScripts, -1)) {
@@ -944,13 +1439,9 @@ bool luaTask(event_t evt, uint8_t scriptType, bool allowLcdUsage)
         break;
       }
       UNPROTECT_LUA();
-      //todo gc step between scripts
     }
   }
-  luaDoGc(lsScripts, false);
-#if defined(COLORLCD)
-  luaDoGc(lsWidgets, false);
-#endif
+  // the garbage collector is run by luaDoGcSteps() at the end of the menus task period
   return scriptWasRun;
 }
 
@@ -959,6 +1450,16 @@ uint32_t luaGetMemUsed(lua_State * L)
   return L ? (lua_gc(L, LUA_GCCOUNT, 0) << 10) + lua_gc(L, LUA_GCCOUNTB, 0) : 0;
 }
 
+// percentage of the Lua small blocks pages which is lost in fragmentation
+uint8_t luaGetMemFragmentation()
+{
+#if defined(USE_SLAB_ALLOCATOR)
+  return slabAllocator.fragmentation();
+#else
+  return 0;
+#endif
+}
+
 
 void luaInit()
 {
@@ -966,6 +1467,12 @@ void luaInit()
 
   luaClose(&lsScripts);
 
+  // all the scripts are unloaded with their state
+  for (int i=0; i<MAX_SCRIPTS; i++) {
+    telemetryHistoryRemoveOwner(&scriptInternalData[i]);
+  }
+  telemetryHistoryRemoveOwner(&standaloneScript);
+
   if (luaState != INTERPRETER_PANIC) {
 #if defined(USE_BIN_ALLOCATOR)
     lsScripts = lua_newstate(bin_l_alloc, NULL);   //we use our own allocator!
@@ -95,12 +95,33 @@ enum ScriptReference {
   SCRIPT_TELEMETRY_FIRST,
   SCRIPT_TELEMETRY_LAST=SCRIPT_TELEMETRY_FIRST+MAX_SCRIPTS, // telem0 and telem1 .. telem7
 };
+enum LuaDrawCommand {
+  DRAW_POINT = 1,                 // x, y
+  DRAW_LINE,                      // x1, y1, x2, y2, pattern, flags
+  DRAW_TEXT,                      // x, y, text, flags
+  DRAW_NUMBER,                    // x, y, value, flags
+  DRAW_TIMER,                     // x, y, value, flags
+  DRAW_RECT,                      // x, y, w, h, flags
+  DRAW_FILLED_RECT,               // x, y, w, h, flags
+#if defined(COLORLCD)
+  DRAW_SET_COLOR,                 // area, color
+#endif
+};
+struct LuaScriptStats {
+  uint32_t runs;
+  uint32_t time;                  // us
+  uint32_t maxTime;               // us
+  uint32_t instructions;
+  uint32_t maxInstructions;
+  uint32_t allocated;             // bytes
+};
 struct ScriptInternalData {
   uint8_t reference;
   uint8_t state;
   int run;
   int background;
   uint8_t instructions;
+  LuaScriptStats stats;
 };
 struct ScriptInputsOutputs {
   uint8_t inputsCount;
@@ -120,10 +141,30 @@ void luaClose(lua_State ** L);
 bool luaTask(event_t evt, uint8_t scriptType, bool allowLcdUsage);
 void luaExec(const char * filename);
 void luaDoGc(lua_State * L, bool full);
+void luaDoGcSteps(uint32_t deadline);
 void luaError(lua_State * L, uint8_t error, bool acknowledge=true);
 uint32_t luaGetMemUsed(lua_State * L);
+uint8_t luaGetMemFragmentation();
+#if defined(LUA_COMPILER)
+void luaCacheReset();
+void luaCacheSourcesChanged();
+#define LUA_CACHE_SOURCES_CHANGED()    luaCacheSourcesChanged()
+#else
+#define LUA_CACHE_SOURCES_CHANGED()
+#endif
 void luaGetValueAndPush(lua_State * L, int src);
 #define luaGetCpuUsed(idx) scriptInternalData[idx].instructions
+#define LUA_SCRIPT_NAME_LEN   16
+extern LuaScriptStats * luaScriptStats;
+extern const void * luaRunningScript;
+void luaStatsStart(LuaScriptStats & stats);
+void luaStatsStop();
+const LuaScriptStats * luaGetScriptStats(int index, char * name);
+void luaResetScriptsStats();
+#if defined(COLORLCD)
+const LuaScriptStats * luaGetWidgetStats(int index, char * name);
+void luaResetWidgetsStats();
+#endif
 uint8_t isTelemetryScriptAvailable(uint8_t index);
 #define LUA_LOAD_MODEL_SCRIPTS()   luaState |= INTERPRETER_RELOAD_PERMANENT_SCRIPTS
 #define LUA_LOAD_MODEL_SCRIPT(idx) luaState |= INTERPRETER_RELOAD_PERMANENT_SCRIPTS
@@ -163,6 +204,7 @@ int luaLoadScriptFileToState(lua_State * L, const char * filename, const char *
 #define luaInit()
 #define LUA_INIT_THEMES_AND_WIDGETS()
 #define LUA_LOAD_MODEL_SCRIPTS()
+#define LUA_CACHE_SOURCES_CHANGED()
 #endif // defined(LUA)
 
 #endif // _LUA_API_H_
@@ -242,6 +242,7 @@ class LuaWidget: public Widget
 
     virtual ~LuaWidget()
     {
+      telemetryHistoryRemoveOwner(persistentData);
       luaL_unref(lsWidgets, LUA_REGISTRYINDEX, widgetData);
       if (errorMessage) free(errorMessage);
     }
@@ -259,6 +260,7 @@ class LuaWidget: public Widget
     char * errorMessage;
 
     void setErrorMessage(const char * funcName);
+    bool call(int nargs);
 };
 
 void l_pushtableint(const char * key, int value)
@@ -281,6 +283,7 @@ class LuaWidgetFactory: public WidgetFactory
       refreshFunction(0),
       backgroundFunction(0)
     {
+      memclear(&stats, sizeof(stats));
     }
 
     virtual Widget * create(const Zone & zone, Widget::PersistentData * persistentData, bool init=true) const
@@ -305,14 +308,19 @@ class LuaWidgetFactory: public WidgetFactory
         l_pushtableint(option->name, persistentData->options[i].signedValue);
       }
 
+      // the widget is identified by its persistent data, the instance doesn't exist yet
+      luaRunningScript = persistentData;
       if (lua_pcall(lsWidgets, 2, 1, 0) != 0) {
         TRACE("Error in widget %s create() function: %s", getName(), lua_tostring(lsWidgets, -1));
       }
+      luaRunningScript = NULL;
       int widgetData = luaL_ref(lsWidgets, LUA_REGISTRYINDEX);
       Widget * widget = new LuaWidget(this, zone, persistentData, widgetData);
       return widget;
     }
 
+    LuaScriptStats stats;
+
   protected:
     int createFunction;
     int updateFunction;
@@ -320,6 +328,38 @@ class LuaWidgetFactory: public WidgetFactory
     int backgroundFunction;
 };
 
+// the Lua widgets, for their statistics
+std::list<LuaWidgetFactory *> luaWidgetFactories;
+
+const LuaScriptStats * luaGetWidgetStats(int index, char * name)
+{
+  for (std::list<LuaWidgetFactory *>::iterator it = luaWidgetFactories.begin(); it != luaWidgetFactories.end(); ++it) {
+    if (index-- == 0) {
+      strncpy(name, (*it)->getName(), LUA_SCRIPT_NAME_LEN);
+      name[LUA_SCRIPT_NAME_LEN] = '\0';
+      return &(*it)->stats;
+    }
+  }
+  return NULL;
+}
+
+void luaResetWidgetsStats()
+{
+  for (std::list<LuaWidgetFactory *>::iterator it = luaWidgetFactories.begin(); it != luaWidgetFactories.end(); ++it) {
+    memclear(&(*it)->stats, sizeof(LuaScriptStats));
+  }
+}
+
+bool LuaWidget::call(int nargs)
+{
+  luaStatsStart(((LuaWidgetFactory *)factory)->stats);
+  luaRunningScript = persistentData;
+  int result = lua_pcall(lsWidgets, nargs, 0, 0);
+  luaRunningScript = NULL;
+  luaStatsStop();
+  return result == 0;
+}
+
 void LuaWidget::update()
 {
   if (lsWidgets == 0 || errorMessage) return;
@@ -335,7 +375,7 @@ void LuaWidget::update()
     l_pushtableint(option->name, persistentData->options[i].signedValue);
   }
 
-  if (lua_pcall(lsWidgets, 2, 0, 0) != 0) {
+  if (!call(2)) {
     setErrorMessage("update()");
   }
 }
@@ -370,7 +410,7 @@ void LuaWidget::refresh()
   LuaWidgetFactory * factory = (LuaWidgetFactory *)this->factory;
   lua_rawgeti(lsWidgets, LUA_REGISTRYINDEX, factory->refreshFunction);
   lua_rawgeti(lsWidgets, LUA_REGISTRYINDEX, widgetData);
-  if (lua_pcall(lsWidgets, 1, 0, 0) != 0) {
+  if (!call(1)) {
     setErrorMessage("refresh()");
   }
 }
@@ -384,7 +424,7 @@ void LuaWidget::background()
   if (factory->backgroundFunction) {
     lua_rawgeti(lsWidgets, LUA_REGISTRYINDEX, factory->backgroundFunction);
     lua_rawgeti(lsWidgets, LUA_REGISTRYINDEX, widgetData);
-    if (lua_pcall(lsWidgets, 1, 0, 0) != 0) {
+    if (!call(1)) {
       setErrorMessage("background()");
     }
   }
@@ -432,6 +472,7 @@ void luaLoadWidgetCallback()
       factory->updateFunction = updateFunction;
       factory->refreshFunction = refreshFunction;
       factory->backgroundFunction = backgroundFunction;
+      luaWidgetFactories.push_back(factory);
       TRACE("Loaded Lua widget %s", name);
     }
   }
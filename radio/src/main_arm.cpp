@@ -83,7 +83,7 @@ void checkEeprom()
     rambackupDirtyMsk = 0;
   }
 #endif
-  if (TIME_TO_WRITE()) {
+  if (TIME_TO_WRITE() || isSdWriteQueueFileError()) {
     storageCheck(false);
   }
 }
@@ -21,32 +21,84 @@
 #include "opentx.h"
 #include "timers.h"
 
+#if defined(SIMU) && defined(MIXER_THREADS)
+  #include <thread>
+  #include <mutex>
+  #include <condition_variable>
+  #include <vector>
+#endif
+
 #if defined(VIRTUAL_INPUTS)
-  int8_t  virtualInputsTrims[NUM_INPUTS];
+  MIXER_THREAD_LOCAL int8_t virtualInputsTrims[NUM_INPUTS];
 #else
   int16_t rawAnas[NUM_INPUTS] = {0};
 #endif
 
-int16_t  anas [NUM_INPUTS] = {0};
-int16_t  trims[NUM_STICKS+NUM_AUX_TRIMS] = {0};
-int32_t  chans[MAX_OUTPUT_CHANNELS] = {0};
+MIXER_THREAD_LOCAL int16_t anas [NUM_INPUTS] = {0};
+MIXER_THREAD_LOCAL int16_t trims[NUM_STICKS+NUM_AUX_TRIMS] = {0};
+MIXER_THREAD_LOCAL int32_t chans[MAX_OUTPUT_CHANNELS] = {0};
 BeepANACenter bpanaCenter = 0;
 
 int24_t act   [MAX_MIXERS] = {0};
 SwOn    swOn  [MAX_MIXERS]; // TODO better name later...
 
-uint8_t mixWarning;
+MIXER_THREAD_LOCAL uint8_t mixWarning;
 
 #if defined(MODULE_ALWAYS_SEND_PULSES)
   uint8_t startupWarningState;
 #endif
 
-int16_t calibratedAnalogs[NUM_CALIBRATED_ANALOGS];
+MIXER_THREAD_LOCAL int16_t calibratedAnalogs[NUM_CALIBRATED_ANALOGS];
 int16_t channelOutputs[MAX_OUTPUT_CHANNELS] = {0};
 int16_t ex_chans[MAX_OUTPUT_CHANNELS] = {0}; // Outputs (before LIMITS) of the last perMain;
 
 #if defined(HELI)
-  int16_t cyc_anas[3] = {0};
+  MIXER_THREAD_LOCAL int16_t cyc_anas[3] = {0};
+#endif
+
+#if defined(SIMU) && defined(MIXER_THREADS)
+  MIXER_THREAD_LOCAL uint32_t mixerInputsWritten; // the inputs written by applyExpos() since the last reset
+#endif
+
+#if defined(VIRTUAL_INPUTS)
+/*
+ * Input lines cache
+ *
+ * The result of each input line (curve, weight and offset) is kept with the
+ * source value and the GVAR values it was computed from, the line is only
+ * recomputed when one of them changes. The cache is only used by the mixer for
+ * the current flight mode (e_perout_mode_normal), and dropped each time the
+ * model is edited.
+ */
+struct ExpoLineCache {
+  uint8_t valid;
+  int16_t source;
+  int16_t curveParam;
+  int16_t weight;
+  int16_t offset;
+  int16_t result;
+};
+
+ExpoLineCache expoLinesCache[MAX_EXPOS];
+uint32_t expoLinesCacheVersion;
+
+#define IS_EXPO_LINES_CACHE_VALID() (expoLinesCacheVersion == mixerProgramVersion)
+
+int32_t computeExpoLine(ExpoData * ed, int32_t v, int32_t weight, int32_t offset)
+{
+  //========== CURVE=================
+  if (ed->curve.value) {
+    v = applyCurve(v, ed->curve);
+  }
+
+  //========== WEIGHT ===============
+  v = div_and_round((int32_t)v * weight, 1000);
+
+  //========== OFFSET ===============
+  if (offset) v += div_and_round(calc100toRESX(offset), 10);
+
+  return v;
+}
 #endif
 
 void applyExpos(int16_t * anas, uint8_t mode APPLY_EXPOS_EXTRA_PARAMS)
@@ -54,6 +106,15 @@ void applyExpos(int16_t * anas, uint8_t mode APPLY_EXPOS_EXTRA_PARAMS)
 #if !defined(VIRTUAL_INPUTS)
   int16_t anas2[NUM_INPUTS]; // values before expo, to ensure same expo base when multiple expo lines are used
   memcpy(anas2, anas, sizeof(anas2));
+#else
+  bool useCache = (mode == e_perout_mode_normal);
+  if (useCache && !IS_EXPO_LINES_CACHE_VALID()) {
+    // the version is taken first, an edit during the evaluation will drop the cache again
+    expoLinesCacheVersion = mixerProgramVersion;
+    for (uint8_t i=0; i<MAX_EXPOS; i++) {
+      expoLinesCache[i].valid = false;
+    }
+  }
 #endif
 
   int8_t cur_chn = -1;
@@ -90,12 +151,38 @@ void applyExpos(int16_t * anas, uint8_t mode APPLY_EXPOS_EXTRA_PARAMS)
 #endif
         cur_chn = ed->chn;
 
-        //========== CURVE=================
-#if defined(CPUARM)
-        if (ed->curve.value) {
-          v = applyCurve(v, ed->curve);
+#if defined(VIRTUAL_INPUTS)
+        int32_t weight = GET_GVAR_PREC1(ed->weight, MIN_EXPO_WEIGHT, 100, mixerCurrentFlightMode);
+        int32_t offset = GET_GVAR_PREC1(ed->offset, -100, 100, mixerCurrentFlightMode);
+        if (useCache) {
+          int16_t curveParam = 0;
+          if (ed->curve.type == CURVE_REF_DIFF || ed->curve.type == CURVE_REF_EXPO) {
+            curveParam = GET_GVAR_PREC1(ed->curve.value, -100, 100, mixerCurrentFlightMode);
+          }
+          ExpoLineCache & cache = expoLinesCache[i];
+          if (!cache.valid || cache.source != v || cache.curveParam != curveParam || cache.weight != weight || cache.offset != offset) {
+            cache.source = v;
+            cache.curveParam = curveParam;
+            cache.weight = weight;
+            cache.offset = offset;
+            cache.result = computeExpoLine(ed, v, weight, offset);
+            cache.valid = true;
+          }
+          v = cache.result;
+        }
+        else {
+          v = computeExpoLine(ed, v, weight, offset);
         }
+
+        //========== TRIMS ================
+        if (ed->carryTrim < TRIM_ON)
+          virtualInputsTrims[cur_chn] = -ed->carryTrim - 1;
+        else if (ed->carryTrim == TRIM_ON && ed->srcRaw >= MIXSRC_Rud && ed->srcRaw <= MIXSRC_Ail)
+          virtualInputsTrims[cur_chn] = ed->srcRaw - MIXSRC_Rud;
+        else
+          virtualInputsTrims[cur_chn] = -1;
 #else
+        //========== CURVE=================
         int8_t curveParam = ed->curveParam;
         if (curveParam) {
           if (ed->curveMode == MODE_CURVE)
@@ -103,33 +190,17 @@ void applyExpos(int16_t * anas, uint8_t mode APPLY_EXPOS_EXTRA_PARAMS)
           else
             v = expo(v, GET_GVAR(curveParam, -100, 100, mixerCurrentFlightMode));
         }
-#endif
 
         //========== WEIGHT ===============
-#if defined(CPUARM)
-        int32_t weight = GET_GVAR_PREC1(ed->weight, MIN_EXPO_WEIGHT, 100, mixerCurrentFlightMode);
-        v = div_and_round((int32_t)v * weight, 1000);
-#else
         int16_t weight = GET_GVAR(ed->weight, MIN_EXPO_WEIGHT, 100, mixerCurrentFlightMode);
         weight = calc100to256(weight);
         v = ((int32_t)v * weight) >> 8;
 #endif
 
-#if defined(VIRTUAL_INPUTS)
-        //========== OFFSET ===============
-        int32_t offset = GET_GVAR_PREC1(ed->offset, -100, 100, mixerCurrentFlightMode);
-        if (offset) v += div_and_round(calc100toRESX(offset), 10);
-
-        //========== TRIMS ================
-        if (ed->carryTrim < TRIM_ON)
-          virtualInputsTrims[cur_chn] = -ed->carryTrim - 1;
-        else if (ed->carryTrim == TRIM_ON && ed->srcRaw >= MIXSRC_Rud && ed->srcRaw <= MIXSRC_Ail)
-          virtualInputsTrims[cur_chn] = ed->srcRaw - MIXSRC_Rud;
-        else
-          virtualInputsTrims[cur_chn] = -1;
-#endif
-
         anas[cur_chn] = v;
+#if defined(SIMU) && defined(MIXER_THREADS)
+        mixerInputsWritten |= (uint32_t)1 << cur_chn;
+#endif
       }
     }
   }
@@ -229,38 +300,307 @@ int16_t applyLimits(uint8_t channel, int32_t value)
 
 // TODO same naming convention than the drawSource
 
-getvalue_t getValue(mixsrc_t i)
+#if defined(CPUARM)
+// getValue() dispatch: each source index is classified once at boot into the
+// range it belongs to, then getValue() jumps straight to the range accessor
+// instead of walking the whole chain of comparisons
+
+enum SourceRange {
+  SOURCE_RANGE_NONE,
+  SOURCE_RANGE_INPUT,
+#if defined(LUA_INPUTS)
+  SOURCE_RANGE_LUA,
+#endif
+  SOURCE_RANGE_ANALOG,
+#if defined(ROTARY_ENCODERS)
+  SOURCE_RANGE_ROTARY_ENCODER,
+#endif
+  SOURCE_RANGE_MAX,
+  SOURCE_RANGE_HELI,
+  SOURCE_RANGE_TRIM,
+#if !defined(PCBFLAMENCO) && !defined(PCBTARANIS) && !defined(PCBHORUS)
+  SOURCE_RANGE_3POS,
+#endif
+  SOURCE_RANGE_SWITCH,
+  SOURCE_RANGE_LOGICAL_SWITCH,
+  SOURCE_RANGE_TRAINER,
+  SOURCE_RANGE_CHANNEL,
+#if defined(GVARS)
+  SOURCE_RANGE_GVAR,
+#endif
+  SOURCE_RANGE_TX_VOLTAGE,
+  SOURCE_RANGE_TX_TIME,
+  SOURCE_RANGE_TIMER,
+  SOURCE_RANGE_TELEMETRY,
+  SOURCE_RANGE_COUNT
+};
+
+typedef getvalue_t (*SourceGetter)(mixsrc_t i);
+
+static getvalue_t getNoneValue(mixsrc_t i)
 {
-  if (i == MIXSRC_NONE) {
+  return 0;
+}
+
+static getvalue_t getInputValue(mixsrc_t i)
+{
+  return anas[i-MIXSRC_FIRST_INPUT];
+}
+
+#if defined(LUA_INPUTS)
+static getvalue_t getLuaOutputValue(mixsrc_t i)
+{
+#if defined(LUA_MODEL_SCRIPTS)
+  div_t qr = div(i-MIXSRC_FIRST_LUA, MAX_SCRIPT_OUTPUTS);
+  return scriptInputsOutputs[qr.quot].outputs[qr.rem].value;
+#else
+  return 0;
+#endif
+}
+#endif
+
+static getvalue_t getStickPotValue(mixsrc_t i)
+{
+  return calibratedAnalogs[i-MIXSRC_Rud];
+}
+
+#if defined(ROTARY_ENCODERS)
+static getvalue_t getRotaryEncoderValue(mixsrc_t i)
+{
+  return getRotaryEncoder(i-MIXSRC_REa);
+}
+#endif
+
+static getvalue_t getMaxValue(mixsrc_t i)
+{
+  return 1024;
+}
+
+static getvalue_t getHeliValue(mixsrc_t i)
+{
+#if defined(HELI)
+  return cyc_anas[i - MIXSRC_CYC1];
+#else
+  return 0;
+#endif
+}
+
+static getvalue_t getTrimSourceValue(mixsrc_t i)
+{
+  return calc1000toRESX((int16_t)8 * getTrimValue(mixerCurrentFlightMode, i-MIXSRC_FIRST_TRIM));
+}
+
+#if defined(PCBFLAMENCO)
+static getvalue_t getSwitchValue(mixsrc_t i)
+{
+  switch (i) {
+    case MIXSRC_SA:
+      return (switchState(SW_SA0) ? -1024 : (switchState(SW_SA1) ? 0 : 1024));
+    case MIXSRC_SB:
+      return (switchState(SW_SB0) ? -1024 : 1024);
+    case MIXSRC_SC:
+      return (switchState(SW_SC0) ? -1024 : (switchState(SW_SC1) ? 0 : 1024));
+    case MIXSRC_SE:
+      return (switchState(SW_SE0) ? -1024 : 1024);
+    default:
+      return (switchState(SW_SF0) ? -1024 : (switchState(SW_SF1) ? 0 : 1024));
+  }
+}
+#elif defined(PCBTARANIS) || defined(PCBHORUS)
+static getvalue_t getSwitchValue(mixsrc_t i)
+{
+  mixsrc_t sw = i-MIXSRC_FIRST_SWITCH;
+  if (SWITCH_EXISTS(sw)) {
+    return (switchState(3*sw) ? -1024 : (switchState(3*sw+1) ? 0 : 1024));
+  }
+  else {
     return 0;
   }
+}
+#else
+static getvalue_t get3PosValue(mixsrc_t i)
+{
+  return (getSwitch(SW_ID0+1) ? -1024 : (getSwitch(SW_ID1+1) ? 0 : 1024));
+}
 
-#if defined(VIRTUAL_INPUTS)
-  else if (i <= MIXSRC_LAST_INPUT) {
-    return anas[i-MIXSRC_FIRST_INPUT];
+// don't use switchState directly to give getSwitch possibility to hack values if needed for switch warning
+static getvalue_t getSwitchValue(mixsrc_t i)
+{
+  return getSwitch(SWSRC_THR+i-MIXSRC_THR) ? 1024 : -1024;
+}
+#endif
+
+static getvalue_t getLogicalSwitchValue(mixsrc_t i)
+{
+  return getSwitch(SWSRC_FIRST_LOGICAL_SWITCH+i-MIXSRC_FIRST_LOGICAL_SWITCH) ? 1024 : -1024;
+}
+
+static getvalue_t getTrainerValue(mixsrc_t i)
+{
+  int16_t x = ppmInput[i-MIXSRC_FIRST_TRAINER];
+  if (i<MIXSRC_FIRST_TRAINER+NUM_CAL_PPM) {
+    x -= g_eeGeneral.trainer.calib[i-MIXSRC_FIRST_TRAINER];
   }
+  return x*2;
+}
+
+static getvalue_t getChannelValue(mixsrc_t i)
+{
+  return ex_chans[i-MIXSRC_CH1];
+}
+
+#if defined(GVARS)
+static getvalue_t getGVarSourceValue(mixsrc_t i)
+{
+  return GVAR_VALUE(i-MIXSRC_GVAR1, getGVarFlightMode(mixerCurrentFlightMode, i - MIXSRC_GVAR1));
+}
 #endif
 
-#if defined(LUA_INPUTS)
-  else if (i < MIXSRC_LAST_LUA) {
-#if defined(LUA_MODEL_SCRIPTS)
-    div_t qr = div(i-MIXSRC_FIRST_LUA, MAX_SCRIPT_OUTPUTS);
-    return scriptInputsOutputs[qr.quot].outputs[qr.rem].value;
+static getvalue_t getTxVoltageValue(mixsrc_t i)
+{
+  return g_vbat100mV;
+}
+
+static getvalue_t getTxTimeValue(mixsrc_t i)
+{
+  // TX_TIME + SPARES
+#if defined(RTCLOCK)
+  return (g_rtcTime % SECS_PER_DAY) / 60; // number of minutes from midnight
 #else
-    return 0;
+  return 0;
 #endif
+}
+
+static getvalue_t getTimerValue(mixsrc_t i)
+{
+  return timersStates[i-MIXSRC_FIRST_TIMER].val;
+}
+
+static getvalue_t getTelemetrySourceValue(mixsrc_t i)
+{
+  div_t qr = div(i-MIXSRC_FIRST_TELEM, 3);
+  TelemetryItem & telemetryItem = telemetryItems[qr.quot];
+  switch (qr.rem) {
+    case 1:
+      return telemetryItem.valueMin;
+    case 2:
+      return telemetryItem.valueMax;
+    default:
+      return telemetryItem.value;
   }
+}
+
+// indexed by SourceRange
+const SourceGetter sourceGetters[SOURCE_RANGE_COUNT] = {
+  getNoneValue,
+  getInputValue,
+#if defined(LUA_INPUTS)
+  getLuaOutputValue,
 #endif
+  getStickPotValue,
+#if defined(ROTARY_ENCODERS)
+  getRotaryEncoderValue,
+#endif
+  getMaxValue,
+  getHeliValue,
+  getTrimSourceValue,
+#if !defined(PCBFLAMENCO) && !defined(PCBTARANIS) && !defined(PCBHORUS)
+  get3PosValue,
+#endif
+  getSwitchValue,
+  getLogicalSwitchValue,
+  getTrainerValue,
+  getChannelValue,
+#if defined(GVARS)
+  getGVarSourceValue,
+#endif
+  getTxVoltageValue,
+  getTxTimeValue,
+  getTimerValue,
+  getTelemetrySourceValue,
+};
+
+uint8_t sourceRanges[MIXSRC_LAST_TELEM+1];
 
+// same order and bounds than the original getValue() chain
+static uint8_t getSourceRange(mixsrc_t i)
+{
+  if (i == MIXSRC_NONE)
+    return SOURCE_RANGE_NONE;
+  else if (i <= MIXSRC_LAST_INPUT)
+    return SOURCE_RANGE_INPUT;
 #if defined(LUA_INPUTS)
-  else if (i <= MIXSRC_LAST_POT+NUM_MOUSE_ANALOGS) {
-    return calibratedAnalogs[i-MIXSRC_Rud];
+  else if (i <= MIXSRC_LAST_LUA)
+    return SOURCE_RANGE_LUA;
+#endif
+  else if (i >= MIXSRC_FIRST_STICK && i <= MIXSRC_LAST_POT+NUM_MOUSE_ANALOGS)
+    return SOURCE_RANGE_ANALOG;
+#if defined(ROTARY_ENCODERS)
+  else if (i <= MIXSRC_LAST_ROTARY_ENCODER)
+    return SOURCE_RANGE_ROTARY_ENCODER;
+#endif
+  else if (i == MIXSRC_MAX)
+    return SOURCE_RANGE_MAX;
+  else if (i <= MIXSRC_CYC3)
+    return SOURCE_RANGE_HELI;
+  else if (i <= MIXSRC_LAST_TRIM)
+    return SOURCE_RANGE_TRIM;
+#if defined(PCBFLAMENCO)
+  else if (i == MIXSRC_SA || i == MIXSRC_SB || i == MIXSRC_SC || i == MIXSRC_SE || i == MIXSRC_SF)
+    return SOURCE_RANGE_SWITCH;
+#elif defined(PCBTARANIS) || defined(PCBHORUS)
+  else if (i >= MIXSRC_FIRST_SWITCH && i <= MIXSRC_LAST_SWITCH)
+    return SOURCE_RANGE_SWITCH;
+#else
+  else if (i == MIXSRC_3POS)
+    return SOURCE_RANGE_3POS;
+  else if (i < MIXSRC_SW1)
+    return SOURCE_RANGE_SWITCH;
+#endif
+  else if (i <= MIXSRC_LAST_LOGICAL_SWITCH)
+    return SOURCE_RANGE_LOGICAL_SWITCH;
+  else if (i <= MIXSRC_LAST_TRAINER)
+    return SOURCE_RANGE_TRAINER;
+  else if (i <= MIXSRC_LAST_CH)
+    return SOURCE_RANGE_CHANNEL;
+#if defined(GVARS)
+  else if (i <= MIXSRC_LAST_GVAR)
+    return SOURCE_RANGE_GVAR;
+#endif
+  else if (i == MIXSRC_TX_VOLTAGE)
+    return SOURCE_RANGE_TX_VOLTAGE;
+  else if (i < MIXSRC_FIRST_TIMER)
+    return SOURCE_RANGE_TX_TIME;
+  else if (i <= MIXSRC_LAST_TIMER)
+    return SOURCE_RANGE_TIMER;
+  else
+    return SOURCE_RANGE_TELEMETRY;
+}
+
+void sourceRangesInit()
+{
+  for (unsigned int i=0; i<DIM(sourceRanges); i++) {
+    sourceRanges[i] = getSourceRange(i);
   }
+}
+
+getvalue_t getValue(mixsrc_t i)
+{
+  if (i > MIXSRC_LAST_TELEM)
+    return 0;
+  else
+    return sourceGetters[sourceRanges[i]](i);
+}
 #else
+getvalue_t getValue(mixsrc_t i)
+{
+  if (i == MIXSRC_NONE) {
+    return 0;
+  }
+
   else if (i>=MIXSRC_FIRST_STICK && i<=MIXSRC_LAST_POT+NUM_MOUSE_ANALOGS) {
     return calibratedAnalogs[i-MIXSRC_Rud];
   }
-#endif
 
 #if defined(PCBGRUVIN9X) || defined(PCBMEGA2560) || defined(ROTARY_ENCODERS)
   else if (i <= MIXSRC_LAST_ROTARY_ENCODER) {
@@ -284,23 +624,6 @@ getvalue_t getValue(mixsrc_t i)
     return calc1000toRESX((int16_t)8 * getTrimValue(mixerCurrentFlightMode, i-MIXSRC_FIRST_TRIM));
   }
 
-#if defined(PCBFLAMENCO)
-  else if (i==MIXSRC_SA) return (switchState(SW_SA0) ? -1024 : (switchState(SW_SA1) ? 0 : 1024));
-  else if (i==MIXSRC_SB) return (switchState(SW_SB0) ? -1024 : 1024);
-  else if (i==MIXSRC_SC) return (switchState(SW_SC0) ? -1024 : (switchState(SW_SC1) ? 0 : 1024));
-  else if (i==MIXSRC_SE) return (switchState(SW_SE0) ? -1024 : 1024);
-  else if (i==MIXSRC_SF) return (switchState(SW_SF0) ? -1024 : (switchState(SW_SF1) ? 0 : 1024));
-#elif defined(PCBTARANIS) || defined(PCBHORUS)
-  else if ((i >= MIXSRC_FIRST_SWITCH) && (i <= MIXSRC_LAST_SWITCH)) {
-    mixsrc_t sw = i-MIXSRC_FIRST_SWITCH;
-    if (SWITCH_EXISTS(sw)) {
-      return (switchState(3*sw) ? -1024 : (switchState(3*sw+1) ? 0 : 1024));
-    }
-    else {
-      return 0;
-    }
-  }
-#else
   else if (i == MIXSRC_3POS) {
     return (getSwitch(SW_ID0+1) ? -1024 : (getSwitch(SW_ID1+1) ? 0 : 1024));
   }
@@ -308,7 +631,6 @@ getvalue_t getValue(mixsrc_t i)
   else if (i < MIXSRC_SW1) {
     return getSwitch(SWSRC_THR+i-MIXSRC_THR) ? 1024 : -1024;
   }
-#endif
 
   else if (i <= MIXSRC_LAST_LOGICAL_SWITCH) {
     return getSwitch(SWSRC_FIRST_LOGICAL_SWITCH+i-MIXSRC_FIRST_LOGICAL_SWITCH) ? 1024 : -1024;
@@ -330,45 +652,14 @@ getvalue_t getValue(mixsrc_t i)
   }
 #endif
 
-#if defined(CPUARM)
-  else if (i == MIXSRC_TX_VOLTAGE) {
-    return g_vbat100mV;
-  }
-  else if (i < MIXSRC_FIRST_TIMER) {
-    // TX_TIME + SPARES
-#if defined(RTCLOCK)
-    return (g_rtcTime % SECS_PER_DAY) / 60; // number of minutes from midnight
-#else
-    return 0;
-#endif
-  }
-  else if (i <= MIXSRC_LAST_TIMER) {
-    return timersStates[i-MIXSRC_FIRST_TIMER].val;
-  }
-#else
   else if (i == MIXSRC_FIRST_TELEM-1+TELEM_TX_VOLTAGE) {
     return g_vbat100mV;
   }
   else if (i <= MIXSRC_FIRST_TELEM-1+TELEM_TIMER2) {
     return timersStates[i-MIXSRC_FIRST_TELEM+1-TELEM_TIMER1].val;
   }
-#endif
 
-#if defined(CPUARM)
-  else if (i <= MIXSRC_LAST_TELEM) {
-    i -= MIXSRC_FIRST_TELEM;
-    div_t qr = div(i, 3);
-    TelemetryItem & telemetryItem = telemetryItems[qr.quot];
-    switch (qr.rem) {
-      case 1:
-        return telemetryItem.valueMin;
-      case 2:
-        return telemetryItem.valueMax;
-      default:
-        return telemetryItem.value;
-    }
-  }
-#elif defined(TELEMETRY_FRSKY)
+#if defined(TELEMETRY_FRSKY)
   else if (i==MIXSRC_FIRST_TELEM-1+TELEM_RSSI_TX) return telemetryData.rssi[1].value;
   else if (i==MIXSRC_FIRST_TELEM-1+TELEM_RSSI_RX) return telemetryData.rssi[0].value;
   else if (i==MIXSRC_FIRST_TELEM-1+TELEM_A1) return telemetryData.analog[TELEM_ANA_A1].value;
@@ -406,6 +697,7 @@ getvalue_t getValue(mixsrc_t i)
 #endif
   else return 0;
 }
+#endif
 
 void evalInputs(uint8_t mode)
 {
@@ -582,7 +874,105 @@ int getSourceTrimValue(int source, int stickValue=0)
 }
 #endif
 
-uint8_t mixerCurrentFlightMode;
+#if defined(CPUARM)
+/*
+ * Compiled mixer program
+ *
+ * For each flight mode the mixer lines are reduced to a flat list of the lines which may
+ * contribute to the outputs. Lines disabled in the flight mode are dropped (unless they
+ * have delays or speeds, which keep a state), the first line of each destination channel is
+ * flagged, and weights / offsets which are not GVARs are resolved once.
+ *
+ * The programs are compiled lazily, and invalidated each time the model is edited
+ * (storageDirty(EE_MODEL)) or the mixer is resumed after a model change.
+ */
+#define MIXER_LINE_FIRST               0x01   // first line of its destination channel
+#define MIXER_LINE_GVAR_WEIGHT         0x02   // weight is a GVAR, resolved at each evaluation
+#define MIXER_LINE_GVAR_OFFSET         0x04   // offset is a GVAR, resolved at each evaluation
+
+struct MixerProgramLine {
+  uint8_t index;
+  uint8_t flags;
+};
+
+struct MixerProgram {
+  uint32_t version;
+  uint8_t count;
+  MixerProgramLine lines[MAX_MIXERS];
+};
+
+struct MixerLineConstants {
+  int32_t offset;   // 256 based, added to the weighted value
+  int16_t weight;   // 256 based
+};
+
+MixerProgram mixerPrograms[MAX_FLIGHT_MODES];
+MixerLineConstants mixerLineConstants[MAX_MIXERS];
+volatile uint32_t mixerProgramVersion = 1;
+
+#define IS_MIXER_PROGRAM_VALID(program) ((program).version == mixerProgramVersion)
+
+void mixerProgramInvalidate()
+{
+  mixerProgramVersion++;
+}
+
+inline bool isMixerFieldGVar(int16_t value)
+{
+#if defined(GVARS)
+  return GV_IS_GV_VALUE(value, GV_RANGELARGE_NEG, GV_RANGELARGE);
+#else
+  return false;
+#endif
+}
+
+void mixerProgramCompile(MixerProgram & program, uint8_t flightMode)
+{
+  // the version is taken first, an edit during the compilation will trigger a new one
+  program.version = mixerProgramVersion;
+
+  uint8_t count = 0;
+  uint8_t lastDestCh = 0xff;
+
+  for (uint8_t i=0; i<MAX_MIXERS; i++) {
+    MixData * md = mixAddress(i);
+    if (md->srcRaw == 0) break;
+
+    if ((md->flightModes & (1 << flightMode)) && !md->delayUp && !md->delayDown && !md->speedUp && !md->speedDown)
+      continue;
+
+    MixerProgramLine & line = program.lines[count++];
+    line.index = i;
+    line.flags = 0;
+
+    if (md->destCh != lastDestCh) {
+      line.flags |= MIXER_LINE_FIRST;
+      lastDestCh = md->destCh;
+    }
+
+    MixerLineConstants & constants = mixerLineConstants[i];
+
+    if (isMixerFieldGVar(MD_WEIGHT(md))) {
+      line.flags |= MIXER_LINE_GVAR_WEIGHT;
+    }
+    else {
+      constants.weight = calc100to256_16Bits(GET_GVAR_PREC1(MD_WEIGHT(md), GV_RANGELARGE_NEG, GV_RANGELARGE, flightMode));
+    }
+
+    if (isMixerFieldGVar(MD_OFFSET(md))) {
+      line.flags |= MIXER_LINE_GVAR_OFFSET;
+    }
+    else {
+      int32_t offset = GET_GVAR_PREC1(MD_OFFSET(md), GV_RANGELARGE_NEG, GV_RANGELARGE, flightMode);
+      constants.offset = (offset ? div_and_round(calc100toRESX_16Bits(offset), 10) << 8 : 0);
+    }
+  }
+
+  program.count = count;
+}
+#endif
+
+MIXER_THREAD_LOCAL uint8_t mixerCurrentFlightMode;
 void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
 {
   evalInputs(mode);
@@ -682,10 +1072,32 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
 
   bitfield_channels_t dirtyChannels = (bitfield_channels_t)-1; // all dirty when mixer starts
 
+#if defined(CPUARM)
+  MixerProgram & program = mixerPrograms[mixerCurrentFlightMode];
+  if (!IS_MIXER_PROGRAM_VALID(program)) {
+    mixerProgramCompile(program, mixerCurrentFlightMode);
+  }
+
+#if defined(BOLD_FONT)
+  if (mode == e_perout_mode_normal) {
+    for (uint8_t i=0; i<MAX_MIXERS; i++) {
+      swOn[i].activeMix = 0;
+    }
+  }
+#endif
+#endif
+
   do {
 
     bitfield_channels_t passDirtyChannels = 0;
 
+#if defined(CPUARM)
+    for (uint8_t l=0; l<program.count; l++) {
+
+      const MixerProgramLine & line = program.lines[l];
+      uint8_t i = line.index;
+      MixData * md = mixAddress(i);
+#else
     for (uint8_t i=0; i<MAX_MIXERS; i++) {
 
 #if defined(BOLD_FONT)
@@ -695,13 +1107,18 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
       MixData *md = mixAddress(i);
 
       if (md->srcRaw == 0) break;
+#endif
 
       mixsrc_t stickIndex = md->srcRaw - MIXSRC_Rud;
 
       if (!(dirtyChannels & ((bitfield_channels_t)1 << md->destCh))) continue;
 
       // if this is the first calculation for the destination channel, initialize it with 0 (otherwise would be random)
+#if defined(CPUARM)
+      if (line.flags & MIXER_LINE_FIRST) {
+#else
       if (i == 0 || md->destCh != (md-1)->destCh) {
+#endif
         chans[md->destCh] = 0;
       }
 
@@ -838,8 +1255,14 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
       }
 
 #if defined(CPUARM)
-      int32_t weight = GET_GVAR_PREC1(MD_WEIGHT(md), GV_RANGELARGE_NEG, GV_RANGELARGE, mixerCurrentFlightMode);
-      weight = calc100to256_16Bits(weight);
+      int32_t weight;
+      if (line.flags & MIXER_LINE_GVAR_WEIGHT) {
+        weight = GET_GVAR_PREC1(MD_WEIGHT(md), GV_RANGELARGE_NEG, GV_RANGELARGE, mixerCurrentFlightMode);
+        weight = calc100to256_16Bits(weight);
+      }
+      else {
+        weight = mixerLineConstants[i].weight;
+      }
 #else
       // saves 12 bytes code if done here and not together with weight; unknown reason
       int16_t weight = GET_GVAR(MD_WEIGHT(md), GV_RANGELARGE_NEG, GV_RANGELARGE, mixerCurrentFlightMode);
@@ -906,8 +1329,13 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
       //========== OFFSET / AFTER ===============
       if (apply_offset_and_curve) {
 #if defined(CPUARM)
-        int32_t offset = GET_GVAR_PREC1(MD_OFFSET(md), GV_RANGELARGE_NEG, GV_RANGELARGE, mixerCurrentFlightMode);
-        if (offset) dv += div_and_round(calc100toRESX_16Bits(offset), 10) << 8;
+        if (line.flags & MIXER_LINE_GVAR_OFFSET) {
+          int32_t offset = GET_GVAR_PREC1(MD_OFFSET(md), GV_RANGELARGE_NEG, GV_RANGELARGE, mixerCurrentFlightMode);
+          if (offset) dv += div_and_round(calc100toRESX_16Bits(offset), 10) << 8;
+        }
+        else {
+          dv += mixerLineConstants[i].offset;
+        }
 #else
         int16_t offset = GET_GVAR(MD_OFFSET(md), GV_RANGELARGE_NEG, GV_RANGELARGE, mixerCurrentFlightMode);
         if (offset) dv += int32_t(calc100toRESX_16Bits(offset)) << 8;
@@ -1006,6 +1434,239 @@ void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms)
 
 int32_t sum_chans512[MAX_OUTPUT_CHANNELS] = {0};
 
+#if defined(SIMU) && defined(MIXER_THREADS)
+/*
+ * Parallel evaluation of the fading flight modes (simulator and host tools)
+ *
+ * The inactive fading flight modes are evaluated by a pool of threads, each one with its
+ * own (thread local) mixer working state, seeded with the state left by the previous mixer
+ * run. The main thread then walks the flight modes in the same order than the sequential
+ * loop: it evaluates the current flight mode itself (logical switches, delays, audio and
+ * the other side effects stay on the main thread), and takes the result of an inactive
+ * flight mode only when it is the one the sequential loop would have computed, i.e. when
+ * the inputs not written by this flight mode have the same values in the seed and in the
+ * state left by the previous flight mode. Otherwise the flight mode is evaluated again on
+ * the main thread. The outputs are always blended in flight mode order, the results don't
+ * depend on the number of threads.
+ *
+ * Models where a flight mode may see the state of another one in some other way (slow
+ * mixer lines, inputs using an input, a trim or a cyclic value as source) are evaluated
+ * sequentially.
+ */
+static_assert(NUM_INPUTS <= 32, "mixerInputsWritten is too small");
+
+struct MixerThreadState {
+  int16_t anas[NUM_INPUTS];
+  int8_t virtualInputsTrims[NUM_INPUTS];
+  int16_t trims[NUM_STICKS+NUM_AUX_TRIMS];
+  int16_t calibratedAnalogs[NUM_CALIBRATED_ANALOGS];
+#if defined(HELI)
+  int16_t cyc_anas[3];
+#endif
+  int32_t chans[MAX_OUTPUT_CHANNELS];
+  uint8_t mixWarning;
+  uint32_t inputsWritten;
+};
+
+void mixerThreadStateSave(MixerThreadState & state)
+{
+  memcpy(state.anas, anas, sizeof(state.anas));
+  memcpy(state.virtualInputsTrims, virtualInputsTrims, sizeof(state.virtualInputsTrims));
+  memcpy(state.trims, trims, sizeof(state.trims));
+  memcpy(state.calibratedAnalogs, calibratedAnalogs, sizeof(state.calibratedAnalogs));
+#if defined(HELI)
+  memcpy(state.cyc_anas, cyc_anas, sizeof(state.cyc_anas));
+#endif
+  memcpy(state.chans, chans, sizeof(state.chans));
+  state.mixWarning = mixWarning;
+  state.inputsWritten = mixerInputsWritten;
+}
+
+void mixerThreadStateRestore(const MixerThreadState & state)
+{
+  memcpy(anas, state.anas, sizeof(state.anas));
+  memcpy(virtualInputsTrims, state.virtualInputsTrims, sizeof(state.virtualInputsTrims));
+  memcpy(trims, state.trims, sizeof(state.trims));
+  memcpy(calibratedAnalogs, state.calibratedAnalogs, sizeof(state.calibratedAnalogs));
+#if defined(HELI)
+  memcpy(cyc_anas, state.cyc_anas, sizeof(state.cyc_anas));
+#endif
+  memcpy(chans, state.chans, sizeof(state.chans));
+  mixWarning = state.mixWarning;
+  mixerInputsWritten = state.inputsWritten;
+}
+
+class MixerThreads
+{
+  public:
+    MixerThreads():
+      pending(0),
+      busy(0),
+      exiting(false)
+    {
+    }
+
+    // count is the total number of threads, the main thread included
+    void start(unsigned int count)
+    {
+      stop();
+      exiting = false;
+      for (unsigned int i=1; i<count; i++) {
+        threads.push_back(std::thread(&MixerThreads::run, this));
+      }
+    }
+
+    void stop()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        exiting = true;
+      }
+      wakeup.notify_all();
+      for (auto & thread: threads) {
+        thread.join();
+      }
+      threads.clear();
+    }
+
+    bool isRunning() const
+    {
+      return !threads.empty();
+    }
+
+    // evaluates the flight modes into results[], from the current state of the main thread
+    void evaluate(ACTIVE_PHASES_TYPE flightModes)
+    {
+      mixerThreadStateSave(seed);
+
+      std::unique_lock<std::mutex> lock(mutex);
+      pending = flightModes;
+      wakeup.notify_all();
+      while (pending) {
+        evaluateNext(lock); // the main thread takes its share of the work
+      }
+      finished.wait(lock, [this] { return busy == 0; });
+      lock.unlock();
+
+      mixerThreadStateRestore(seed);
+    }
+
+    MixerThreadState seed;
+    MixerThreadState results[MAX_FLIGHT_MODES];
+
+  protected:
+    void evaluateNext(std::unique_lock<std::mutex> & lock)
+    {
+      uint8_t p = 0;
+      while (!(pending & ((ACTIVE_PHASES_TYPE)1 << p))) p++;
+      pending &= ~((ACTIVE_PHASES_TYPE)1 << p);
+      busy++;
+      lock.unlock();
+
+      mixerThreadStateRestore(seed);
+      mixerInputsWritten = 0;
+      mixerCurrentFlightMode = p;
+      evalFlightModeMixes(e_perout_mode_inactive_flight_mode, 0);
+      mixerThreadStateSave(results[p]);
+
+      lock.lock();
+      if (--busy == 0 && !pending) {
+        finished.notify_all();
+      }
+    }
+
+    void run()
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (true) {
+        wakeup.wait(lock, [this] { return exiting || pending; });
+        if (exiting)
+          return;
+        evaluateNext(lock);
+      }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::condition_variable finished;
+    ACTIVE_PHASES_TYPE pending;
+    uint8_t busy;
+    bool exiting;
+};
+
+MixerThreads mixerThreads;
+
+void mixerThreadsStart(unsigned int count)
+{
+  mixerThreads.start(count);
+}
+
+void mixerThreadsStop()
+{
+  mixerThreads.stop();
+}
+
+bool isFadeParallelizable(ACTIVE_PHASES_TYPE flightModes)
+{
+  for (uint8_t i=0; i<MAX_EXPOS; i++) {
+    ExpoData * ed = expoAddress(i);
+    if (!EXPO_VALID(ed)) break;
+    // these sources are read before the flight mode has written them
+    if ((ed->srcRaw >= MIXSRC_FIRST_INPUT && ed->srcRaw <= MIXSRC_LAST_INPUT) ||
+        (ed->srcRaw >= MIXSRC_FIRST_TRIM && ed->srcRaw <= MIXSRC_LAST_TRIM) ||
+        (ed->srcRaw >= MIXSRC_CYC1 && ed->srcRaw <= MIXSRC_CYC3)) {
+      return false;
+    }
+  }
+
+  for (uint8_t p=0; p<MAX_FLIGHT_MODES; p++) {
+    if (flightModes & ((ACTIVE_PHASES_TYPE)1 << p)) {
+      MixerProgram & program = mixerPrograms[p];
+      if (!IS_MIXER_PROGRAM_VALID(program)) {
+        mixerProgramCompile(program, p);
+      }
+      for (uint8_t i=0; i<program.count; i++) {
+        MixData * md = mixAddress(program.lines[i].index);
+        if (md->speedUp || md->speedDown) {
+          return false; // act[] is shared by all flight modes
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+// returns false when the fading flight modes have to be evaluated sequentially
+bool evalFadingFlightModesStart(ACTIVE_PHASES_TYPE flightModes, uint8_t currentFlightMode)
+{
+  if (!mixerThreads.isRunning() || !isFadeParallelizable(flightModes)) {
+    return false;
+  }
+
+  mixerThreads.evaluate(flightModes & ~((ACTIVE_PHASES_TYPE)1 << currentFlightMode));
+  return true;
+}
+
+// takes the result of an inactive flight mode evaluated by the threads, if it is the one
+// the sequential evaluation from the current state would give
+bool evalFadingFlightModeResult(uint8_t flightMode)
+{
+  const MixerThreadState & seed = mixerThreads.seed;
+  const MixerThreadState & result = mixerThreads.results[flightMode];
+
+  for (uint8_t i=0; i<NUM_INPUTS; i++) {
+    if (!(result.inputsWritten & ((uint32_t)1 << i)) && (anas[i] != seed.anas[i] || virtualInputsTrims[i] != seed.virtualInputsTrims[i])) {
+      return false;
+    }
+  }
+
+  mixerThreadStateRestore(result);
+  return true;
+}
+#endif
+
 
 #define MAX_ACT 0xffff
 uint8_t lastFlightMode = 255; // TODO reinit everything here when the model changes, no???
@@ -1027,6 +1688,11 @@ void evalMixes(uint8_t tick10ms)
 
   LS_RECURSIVE_EVALUATION_RESET();
 
+#if defined(CPUARM)
+  // the smooth curves tangents are only computed here, the other tasks and the threads read them
+  prepareCurveTangents();
+#endif
+
   uint8_t fm = getFlightMode();
 
   if (lastFlightMode != fm) {
@@ -1067,13 +1733,20 @@ void evalMixes(uint8_t tick10ms)
   }
 #endif
 
+  DEBUG_TIMER_START(debugTimerFlightModeMixes);
   int32_t weight = 0;
   if (flightModesFade) {
     memclear(sum_chans512, sizeof(sum_chans512));
+#if defined(SIMU) && defined(MIXER_THREADS)
+    bool parallel = evalFadingFlightModesStart(flightModesFade, fm);
+#endif
     for (uint8_t p=0; p<MAX_FLIGHT_MODES; p++) {
       LS_RECURSIVE_EVALUATION_RESET();
       if (flightModesFade & ((ACTIVE_PHASES_TYPE)1 << p)) {
         mixerCurrentFlightMode = p;
+#if defined(SIMU) && defined(MIXER_THREADS)
+        if (!parallel || p == fm || !evalFadingFlightModeResult(p))
+#endif
         evalFlightModeMixes(p==fm ? e_perout_mode_normal : e_perout_mode_inactive_flight_mode, p==fm ? tick10ms : 0);
         for (uint8_t i=0; i<MAX_OUTPUT_CHANNELS; i++)
           sum_chans512[i] += (chans[i] >> 4) * fp_act[p];
@@ -1088,11 +1761,13 @@ void evalMixes(uint8_t tick10ms)
     mixerCurrentFlightMode = fm;
     evalFlightModeMixes(e_perout_mode_normal, tick10ms);
   }
+  DEBUG_TIMER_STOP(debugTimerFlightModeMixes);
 
   //========== FUNCTIONS ===============
   // must be done after mixing because some functions use the inputs/channels values
   // must be done before limits because of the applyLimit function: it checks for safety switches which would be not initialized otherwise
   if (tick10ms) {
+    DEBUG_TIMER_START(debugTimerFunctions);
 #if defined(MASTER_VOLUME)
     requiredSpeakerVolume = g_eeGeneral.speakerVolume + VOLUME_LEVEL_DEF;
 #endif
@@ -1105,9 +1780,11 @@ void evalMixes(uint8_t tick10ms)
 #else
     evalFunctions();
 #endif
+    DEBUG_TIMER_STOP(debugTimerFunctions);
   }
 
   //========== LIMITS ===============
+  DEBUG_TIMER_START(debugTimerLimits);
   for (uint8_t i=0; i<MAX_OUTPUT_CHANNELS; i++) {
     // chans[i] holds data from mixer.   chans[i] = v*weight => 1024*256
     // later we multiply by the limit (up to 100) and then we need to normalize
@@ -1128,6 +1805,7 @@ void evalMixes(uint8_t tick10ms)
     channelOutputs[i] = value;  // copy consistent word to int-level
     sei();
   }
+  DEBUG_TIMER_STOP(debugTimerLimits);
 
   if (tick10ms && flightModesFade) {
     uint16_t tick_delta = delta * tick10ms;
@@ -1931,6 +1931,11 @@ void opentxClose(uint8_t shutdown)
   storageDirty(EE_GENERAL);
   storageCheck(true);
 
+#if defined(SDCARD)
+  // everything must be on the card before it gets unmounted
+  sdWriteQueueFlush();
+#endif
+
 #if defined(CPUARM)
   while (IS_PLAYING(ID_PLAY_BYE)) {
     CoTickDelay(10);
@@ -1953,6 +1958,11 @@ void opentxResume()
 
   sdMount();
 
+#if defined(LUA_COMPILER)
+  // the scripts may have been modified
+  luaCacheReset();
+#endif
+
   storageReadAll();
 
 #if defined(PCBHORUS)
@@ -2653,6 +2663,7 @@ int main()
 #endif
 
 #if defined(CPUARM)
+  sourceRangesInit();
   tasksStart();
 #else
   opentxInit(mcusr);
@@ -640,7 +640,14 @@ enum StartupWarningStates {
   #define FORCE_INDIRECT(ptr) __asm__ __volatile__ ("" : "=e" (ptr) : "0" (ptr))
 #endif
 
-extern uint8_t mixerCurrentFlightMode;
+#if defined(SIMU) && defined(MIXER_THREADS)
+  // the mixer working state is per thread, see MixerThreads in mixer.cpp
+  #define MIXER_THREAD_LOCAL thread_local
+#else
+  #define MIXER_THREAD_LOCAL
+#endif
+
+extern MIXER_THREAD_LOCAL uint8_t mixerCurrentFlightMode;
 extern uint8_t lastFlightMode;
 extern uint8_t flightModeTransitionLast;
 
@@ -663,6 +670,14 @@ extern uint8_t flightModeTransitionLast;
 
 void evalFlightModeMixes(uint8_t mode, uint8_t tick10ms);
 void evalMixes(uint8_t tick10ms);
+#if defined(CPUARM)
+extern volatile uint32_t mixerProgramVersion;
+void mixerProgramInvalidate();
+#endif
+#if defined(SIMU) && defined(MIXER_THREADS)
+void mixerThreadsStart(unsigned int count);
+void mixerThreadsStop();
+#endif
 void doMixerCalculations();
 void scheduleNextMixerCalculation(uint8_t module, uint16_t delay);
 
@@ -673,6 +688,9 @@ void perMain();
 NOINLINE void per10ms();
 
 getvalue_t getValue(mixsrc_t i);
+#if defined(CPUARM)
+void sourceRangesInit();
+#endif
 
 #if defined(CPUARM)
 #define GETSWITCH_MIDPOS_DELAY   1
@@ -887,6 +905,7 @@ inline void pauseMixerCalculations()
 
 inline void resumeMixerCalculations()
 {
+  mixerProgramInvalidate();
   CoLeaveMutexSection(mixerMutex);
 }
 #else
@@ -973,7 +992,7 @@ extern uint8_t            g_beepVal[5];
 
 #include "trainer_input.h"
 
-extern int32_t            chans[MAX_OUTPUT_CHANNELS];
+extern MIXER_THREAD_LOCAL int32_t chans[MAX_OUTPUT_CHANNELS];
 extern int16_t            ex_chans[MAX_OUTPUT_CHANNELS]; // Outputs (before LIMITS) of the last perMain
 extern int16_t            channelOutputs[MAX_OUTPUT_CHANNELS];
 extern uint16_t           BandGap;
@@ -1030,6 +1049,7 @@ int applyCurve(int x, CurveRef & curve);
 int applyCustomCurve(int x, uint8_t idx);
 int applyCurrentCurve(int x);
 int8_t getCurveX(int noPoints, int point);
+void prepareCurveTangents();
 void resetCustomCurveX(int8_t * points, int noPoints);
 bool moveCurve(uint8_t index, int8_t shift); // TODO bool?
 #else
@@ -1066,14 +1086,14 @@ int16_t applyLimits(uint8_t channel, int32_t value);
 void evalInputs(uint8_t mode);
 uint16_t anaIn(uint8_t chan);
 
-extern int16_t calibratedAnalogs[NUM_CALIBRATED_ANALOGS];
+extern MIXER_THREAD_LOCAL int16_t calibratedAnalogs[NUM_CALIBRATED_ANALOGS];
 
 #define FLASH_DURATION 20 /*200ms*/
 
 extern uint8_t beepAgain;
 extern uint16_t lightOffCounter;
 extern uint8_t flashCounter;
-extern uint8_t mixWarning;
+extern MIXER_THREAD_LOCAL uint8_t mixWarning;
 
 FlightModeData * flightModeAddress(uint8_t idx);
 ExpoData * expoAddress(uint8_t idx);
@@ -1084,13 +1104,13 @@ LogicalSwitchData * lswAddress(uint8_t idx);
 // static variables used in evalFlightModeMixes - moved here so they don't interfere with the stack
 // It's also easier to initialize them here.
 #if defined(CPUARM)
-  extern int8_t  virtualInputsTrims[NUM_INPUTS];
+  extern MIXER_THREAD_LOCAL int8_t virtualInputsTrims[NUM_INPUTS];
 #else
   extern int16_t rawAnas[NUM_INPUTS];
 #endif
 
-extern int16_t anas [NUM_INPUTS];
-extern int16_t trims[NUM_STICKS+NUM_AUX_TRIMS];
+extern MIXER_THREAD_LOCAL int16_t anas [NUM_INPUTS];
+extern MIXER_THREAD_LOCAL int16_t trims[NUM_STICKS+NUM_AUX_TRIMS];
 extern BeepANACenter bpanaCenter;
 
 extern uint8_t s_mixer_first_run_done;
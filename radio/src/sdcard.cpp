@@ -413,6 +413,9 @@ const char * sdCopyFile(const char * srcPath, const char * destPath)
   UINT read = sizeof(buf);
   UINT written = sizeof(buf);
 
+  // the source may still be in the SD write queue
+  sdWriteQueueFlush();
+
   FRESULT result = f_open(&srcFile, srcPath, FA_OPEN_EXISTING | FA_READ);
   if (result != FR_OK) {
     return SDCARD_ERROR(result);
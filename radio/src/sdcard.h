@@ -53,7 +53,11 @@ const char RADIO_SETTINGS_PATH[] = RADIO_PATH "/radio.bin";
 #endif
 
 #define MODELS_EXT          ".bin"
+#if defined(LOGS_BINARY)
+#define LOGS_EXT            ".otl"
+#else
 #define LOGS_EXT            ".csv"
+#endif
 #define SOUNDS_EXT          ".wav"
 #define BMP_EXT             ".bmp"
 #define PNG_EXT             ".png"
@@ -95,6 +99,32 @@ void logsInit();
 void logsClose();
 void logsWrite();
 
+#if defined(CPUARM) && !defined(BOOT)
+  #define SD_WRITE_QUEUE
+#endif
+
+#if defined(SD_WRITE_QUEUE)
+#define SD_WRITE_STACK_SIZE            500
+extern OS_TID sdWriteTaskId;
+extern TaskStack<SD_WRITE_STACK_SIZE> sdWriteStack;
+void sdWriteQueueStart();
+void sdWriteQueueFlush();
+#else
+#define sdWriteQueueFlush()
+#endif
+
+// without SD_WRITE_QUEUE these write immediately
+bool sdWriteQueueAppend(FIL * file, const void * data, uint32_t size);
+void sdWriteQueueClose(FIL * file);
+// true when a write or the close of the file failed, the error of a closed file is forgotten then
+bool sdWriteQueueError(FIL * file);
+#if !defined(EEPROM)
+const char * sdWriteQueueFile(const char * path, const uint8_t * header, uint8_t headerSize, const uint8_t * data, uint16_t size);
+// the errors of the whole file writes done by the SD write task, sdWriteQueueFile() returns them directly otherwise
+bool isSdWriteQueueFileError();
+const char * sdWriteQueueFileError(const char * path); // any file when path is NULL
+#endif
+
 uint32_t sdGetNoSectors();
 uint32_t sdGetSize();
 uint32_t sdGetFreeSectors();
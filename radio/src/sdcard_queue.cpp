@@ -0,0 +1,536 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "opentx.h"
+
+#if defined(SD_WRITE_QUEUE)
+/*
+ * SD write-behind queue
+ *
+ * FatFS calls block as long as the card is busy (100ms and more on some cards). The writes
+ * requested by the menus task are only copied here, the low priority sdWriteTask does them:
+ *  - appends to an open file (logs, screenshots) go through a FIFO of sector sized chunks.
+ *    A chunk is written when it is full, or when nothing was appended to it for
+ *    SD_WRITE_QUEUE_DELAY. Consecutive appends to the same file share the same chunk
+ *  - whole files (radio settings, models) are snapshots. A new snapshot of a file which
+ *    is still waiting to be written replaces the previous one
+ * sdWriteQueueFlush() waits until everything has been written. When the task isn't running
+ * (simulator stopped, gtests), the callers which wait for the queue write it themselves. The error of a whole file
+ * write is kept until sdWriteQueueFileError() is called for this file, the error of an
+ * appended file until sdWriteQueueError() is called once it is closed.
+ */
+
+#define SD_WRITE_CHUNK_SIZE            512
+#define SD_WRITE_CHUNKS                8
+#define SD_WRITE_QUEUE_DELAY           50 // 100ms
+#define SD_WRITE_ERROR_FILES           4
+
+struct SdWriteChunk {
+  FIL * file;
+  uint16_t size;
+  bool close;                          // close the file once the chunk is written
+  uint8_t data[SD_WRITE_CHUNK_SIZE];
+};
+
+SdWriteChunk sdWriteChunks[SD_WRITE_CHUNKS] __DMA;
+uint8_t sdWriteChunksHead;             // next chunk to be written
+uint8_t sdWriteChunksCount;
+bool sdWriteChunkOpen;                 // the last chunk may still be appended to
+uint32_t sdWriteChunkTime;             // time of the last append to the open chunk
+uint8_t sdWriteFlushRequests;
+bool sdWriteTaskRunning;
+
+struct SdWriteError {
+  FIL * file;                          // a write to this file failed, appends to it return false. NULL when the entry is free
+  bool closed;                         // the file is closed, the error is kept for sdWriteQueueError()
+};
+
+SdWriteError sdWriteErrors[SD_WRITE_ERROR_FILES];
+
+#if !defined(EEPROM)
+#define SD_WRITE_FILES                 2
+#define SD_WRITE_FILE_SIZE             (8 + (sizeof(ModelData) > sizeof(RadioData) ? sizeof(ModelData) : sizeof(RadioData)))
+
+enum SdWriteFileState {
+  SD_WRITE_FILE_FREE,
+  SD_WRITE_FILE_PENDING,
+  SD_WRITE_FILE_WRITING
+};
+
+struct SdWriteFile {
+  uint8_t state;
+  char path[sizeof(MODELS_PATH) + LEN_MODEL_FILENAME + 1];
+  uint16_t size;
+  uint8_t data[SD_WRITE_FILE_SIZE];
+};
+
+SdWriteFile sdWriteFiles[SD_WRITE_FILES] __SDRAM;
+FIL sdWriteFileHandle __DMA;
+
+struct SdWriteFileError {
+  char path[sizeof(MODELS_PATH) + LEN_MODEL_FILENAME + 1];
+  const char * error;                  // NULL when the entry is free
+};
+
+SdWriteFileError sdWriteFileErrors[SD_WRITE_FILES];
+volatile uint8_t sdWriteFileErrorsCount;
+#endif
+
+OS_TID sdWriteTaskId;
+TaskStack<SD_WRITE_STACK_SIZE> sdWriteStack;
+OS_MutexID sdWriteMutex;
+OS_FlagID sdWriteFlag;
+
+void sdWriteQueueProcess();
+
+// releases the mutex for a while, so that the queue gets emptied
+void sdWriteQueueWait()
+{
+  bool running = sdWriteTaskRunning;
+  CoLeaveMutexSection(sdWriteMutex);
+  if (running) {
+    CoSetFlag(sdWriteFlag);
+    CoTickDelay(1);
+  }
+  else {
+    sdWriteQueueProcess();
+  }
+  CoEnterMutexSection(sdWriteMutex);
+}
+
+// called with the mutex taken, returns NULL when no write to this file failed
+SdWriteError * sdWriteQueueGetError(FIL * file)
+{
+  for (uint8_t i=0; i<SD_WRITE_ERROR_FILES; i++) {
+    if (sdWriteErrors[i].file == file) {
+      return &sdWriteErrors[i];
+    }
+  }
+  return NULL;
+}
+
+// called with the mutex taken, the first entry is replaced when the table is full
+void sdWriteQueueSetError(FIL * file, bool closed)
+{
+  SdWriteError * entry = sdWriteQueueGetError(file);
+  if (!entry) {
+    entry = sdWriteQueueGetError(NULL);
+  }
+  if (!entry) {
+    entry = &sdWriteErrors[0];
+  }
+  entry->file = file;
+  entry->closed = closed;
+}
+
+// returns the chunk the next bytes of the file go to, NULL when the queue is full
+SdWriteChunk * sdWriteQueueGetChunk(FIL * file)
+{
+  if (sdWriteChunkOpen) {
+    SdWriteChunk * chunk = &sdWriteChunks[(sdWriteChunksHead + sdWriteChunksCount - 1) % SD_WRITE_CHUNKS];
+    if (chunk->file == file) {
+      return chunk;
+    }
+  }
+
+  if (sdWriteChunksCount == SD_WRITE_CHUNKS) {
+    return NULL;
+  }
+
+  SdWriteChunk * chunk = &sdWriteChunks[(sdWriteChunksHead + sdWriteChunksCount) % SD_WRITE_CHUNKS];
+  chunk->file = file;
+  chunk->size = 0;
+  chunk->close = false;
+  sdWriteChunksCount++;
+  sdWriteChunkOpen = true;
+  return chunk;
+}
+
+bool sdWriteQueueAppend(FIL * file, const void * data, uint32_t size)
+{
+  const uint8_t * src = (const uint8_t *)data;
+
+  CoEnterMutexSection(sdWriteMutex);
+
+  SdWriteError * entry = sdWriteQueueGetError(file);
+  if (entry && entry->closed) {
+    // the file was closed then opened again, forget the error of the previous one
+    entry->file = NULL;
+    entry = NULL;
+  }
+  bool result = (entry == NULL);
+
+  while (size > 0) {
+    SdWriteChunk * chunk = sdWriteQueueGetChunk(file);
+    if (!chunk) {
+      sdWriteQueueWait();
+      continue;
+    }
+    uint16_t count = min<uint32_t>(size, SD_WRITE_CHUNK_SIZE - chunk->size);
+    memcpy(&chunk->data[chunk->size], src, count);
+    chunk->size += count;
+    src += count;
+    size -= count;
+    sdWriteChunkTime = CoGetOSTime();
+    if (chunk->size == SD_WRITE_CHUNK_SIZE) {
+      sdWriteChunkOpen = false;
+      CoSetFlag(sdWriteFlag);
+    }
+  }
+
+  CoLeaveMutexSection(sdWriteMutex);
+
+  return result;
+}
+
+void sdWriteQueueClose(FIL * file)
+{
+  CoEnterMutexSection(sdWriteMutex);
+
+  SdWriteChunk * chunk;
+  while ((chunk = sdWriteQueueGetChunk(file)) == NULL) {
+    sdWriteQueueWait();
+  }
+  chunk->close = true;
+  sdWriteChunkOpen = false;
+
+  CoLeaveMutexSection(sdWriteMutex);
+
+  CoSetFlag(sdWriteFlag);
+}
+
+#if !defined(EEPROM)
+const char * sdWriteQueueFile(const char * path, const uint8_t * header, uint8_t headerSize, const uint8_t * data, uint16_t size)
+{
+  if (headerSize + size > SD_WRITE_FILE_SIZE || strlen(path) >= sizeof(sdWriteFiles[0].path)) {
+    return STR_SDCARD_ERROR;
+  }
+
+  CoEnterMutexSection(sdWriteMutex);
+
+  SdWriteFile * slot = NULL;
+  while (true) {
+    for (uint8_t i=0; i<SD_WRITE_FILES; i++) {
+      SdWriteFile & file = sdWriteFiles[i];
+      if (file.state == SD_WRITE_FILE_PENDING && !strcmp(file.path, path)) {
+        // an older snapshot of the same file hasn't been written yet, forget it
+        slot = &file;
+        break;
+      }
+      else if (file.state == SD_WRITE_FILE_FREE && !slot) {
+        slot = &file;
+      }
+    }
+    if (slot) {
+      break;
+    }
+    sdWriteQueueWait();
+  }
+
+  strcpy(slot->path, path);
+  memcpy(slot->data, header, headerSize);
+  memcpy(&slot->data[headerSize], data, size);
+  slot->size = headerSize + size;
+  slot->state = SD_WRITE_FILE_PENDING;
+
+  CoLeaveMutexSection(sdWriteMutex);
+
+  CoSetFlag(sdWriteFlag);
+
+  return NULL;
+}
+
+// called with the mutex taken, the first entry is replaced when the table is full
+void sdWriteQueueSetFileError(const char * path, const char * error)
+{
+  SdWriteFileError * entry = &sdWriteFileErrors[0];
+  for (uint8_t i=0; i<SD_WRITE_FILES; i++) {
+    if (sdWriteFileErrors[i].error && !strcmp(sdWriteFileErrors[i].path, path)) {
+      entry = &sdWriteFileErrors[i];
+      break;
+    }
+    else if (!sdWriteFileErrors[i].error) {
+      entry = &sdWriteFileErrors[i];
+    }
+  }
+  if (!entry->error) {
+    sdWriteFileErrorsCount++;
+  }
+  strcpy(entry->path, path);
+  entry->error = error;
+}
+
+// writes the next pending file, returns false when there was none
+bool sdWriteQueueWriteFile()
+{
+  SdWriteFile * file = NULL;
+
+  CoEnterMutexSection(sdWriteMutex);
+  for (uint8_t i=0; i<SD_WRITE_FILES; i++) {
+    if (sdWriteFiles[i].state == SD_WRITE_FILE_PENDING) {
+      file = &sdWriteFiles[i];
+      file->state = SD_WRITE_FILE_WRITING;
+      break;
+    }
+  }
+  CoLeaveMutexSection(sdWriteMutex);
+
+  if (!file) {
+    return false;
+  }
+
+  UINT written;
+  FRESULT result = f_open(&sdWriteFileHandle, file->path, FA_CREATE_ALWAYS | FA_WRITE);
+  if (result == FR_OK) {
+    result = f_write(&sdWriteFileHandle, file->data, file->size, &written);
+    if (result == FR_OK && written != file->size) {
+      result = FR_DENIED;
+    }
+    f_close(&sdWriteFileHandle);
+  }
+
+  CoEnterMutexSection(sdWriteMutex);
+  if (result != FR_OK) {
+    TRACE("sdWriteQueue %s error=%d", file->path, result);
+    sdWriteQueueSetFileError(file->path, SDCARD_ERROR(result));
+  }
+  file->state = SD_WRITE_FILE_FREE;
+  CoLeaveMutexSection(sdWriteMutex);
+
+  return true;
+}
+
+bool isSdWriteQueueFileError()
+{
+  return sdWriteFileErrorsCount > 0;
+}
+
+const char * sdWriteQueueFileError(const char * path)
+{
+  const char * result = NULL;
+
+  CoEnterMutexSection(sdWriteMutex);
+  for (uint8_t i=0; i<SD_WRITE_FILES; i++) {
+    SdWriteFileError & entry = sdWriteFileErrors[i];
+    if (entry.error && (!path || !strcmp(entry.path, path))) {
+      result = entry.error;
+      entry.error = NULL;
+      sdWriteFileErrorsCount--;
+      break;
+    }
+  }
+  CoLeaveMutexSection(sdWriteMutex);
+
+  return result;
+}
+#endif
+
+// writes the first chunk of the FIFO if it is complete (or if it waited long enough), returns false when there was none
+bool sdWriteQueueWriteChunk()
+{
+  SdWriteChunk * chunk = NULL;
+
+  CoEnterMutexSection(sdWriteMutex);
+  if (sdWriteChunksCount > 0) {
+    if (sdWriteChunksCount > 1 || !sdWriteChunkOpen) {
+      chunk = &sdWriteChunks[sdWriteChunksHead];
+    }
+    else if (sdWriteFlushRequests > 0 || (uint32_t)(CoGetOSTime() - sdWriteChunkTime) >= SD_WRITE_QUEUE_DELAY) {
+      chunk = &sdWriteChunks[sdWriteChunksHead];
+      sdWriteChunkOpen = false;
+    }
+  }
+  CoLeaveMutexSection(sdWriteMutex);
+
+  if (!chunk) {
+    return false;
+  }
+
+  bool error = false;
+  if (chunk->size > 0) {
+    UINT written;
+    error = (f_write(chunk->file, chunk->data, chunk->size, &written) != FR_OK || written != chunk->size);
+  }
+
+  if (chunk->close && f_close(chunk->file) != FR_OK) {
+    error = true;
+  }
+
+  CoEnterMutexSection(sdWriteMutex);
+  if (error) {
+    TRACE("sdWriteQueue chunk error");
+    sdWriteQueueSetError(chunk->file, chunk->close);
+  }
+  else if (chunk->close) {
+    SdWriteError * entry = sdWriteQueueGetError(chunk->file);
+    if (entry) {
+      // an earlier write failed, the error is kept for sdWriteQueueError()
+      entry->closed = true;
+    }
+  }
+  sdWriteChunksHead = (sdWriteChunksHead + 1) % SD_WRITE_CHUNKS;
+  sdWriteChunksCount--;
+  CoLeaveMutexSection(sdWriteMutex);
+
+  return true;
+}
+
+bool sdWriteQueueError(FIL * file)
+{
+  CoEnterMutexSection(sdWriteMutex);
+  SdWriteError * entry = sdWriteQueueGetError(file);
+  if (entry && entry->closed) {
+    entry->file = NULL;
+  }
+  CoLeaveMutexSection(sdWriteMutex);
+  return entry != NULL;
+}
+
+bool isSdWriteQueueEmpty()
+{
+  CoEnterMutexSection(sdWriteMutex);
+  bool result = (sdWriteChunksCount == 0);
+#if !defined(EEPROM)
+  for (uint8_t i=0; i<SD_WRITE_FILES; i++) {
+    if (sdWriteFiles[i].state != SD_WRITE_FILE_FREE) {
+      result = false;
+    }
+  }
+#endif
+  CoLeaveMutexSection(sdWriteMutex);
+  return result;
+}
+
+void sdWriteQueueFlush()
+{
+  CoEnterMutexSection(sdWriteMutex);
+  sdWriteFlushRequests++;
+  CoLeaveMutexSection(sdWriteMutex);
+
+  while (!isSdWriteQueueEmpty()) {
+    CoEnterMutexSection(sdWriteMutex);
+    sdWriteQueueWait();
+    CoLeaveMutexSection(sdWriteMutex);
+  }
+
+  CoEnterMutexSection(sdWriteMutex);
+  sdWriteFlushRequests--;
+  CoLeaveMutexSection(sdWriteMutex);
+}
+
+// writes everything which is ready to be written
+void sdWriteQueueProcess()
+{
+#if !defined(EEPROM)
+  while (sdWriteQueueWriteFile() || sdWriteQueueWriteChunk());
+#else
+  while (sdWriteQueueWriteChunk());
+#endif
+#if defined(DISK_CACHE)
+  diskCacheFlush(false);
+#endif
+}
+
+void sdWriteTask(void * pdata)
+{
+  while (1) {
+    CoWaitForSingleFlag(sdWriteFlag, SD_WRITE_QUEUE_DELAY);
+#if defined(SIMU)
+    CoTickDelay(1); // CoWaitForSingleFlag() returns immediately in the simulator
+    if (main_thread_running == 0) {
+      CoEnterMutexSection(sdWriteMutex);
+      sdWriteTaskRunning = false;
+      CoLeaveMutexSection(sdWriteMutex);
+      return;
+    }
+#endif
+    sdWriteQueueProcess();
+  }
+}
+
+void sdWriteQueueStart()
+{
+  sdWriteMutex = CoCreateMutex();
+  sdWriteFlag = CoCreateFlag(true, false);
+  sdWriteTaskRunning = true;
+  sdWriteTaskId = CoCreateTask(sdWriteTask, NULL, 20, &sdWriteStack.stack[SD_WRITE_STACK_SIZE-1], SD_WRITE_STACK_SIZE);
+}
+
+#else // SD_WRITE_QUEUE
+
+bool sdWriteQueueAppend(FIL * file, const void * data, uint32_t size)
+{
+  UINT written;
+  return f_write(file, data, size, &written) == FR_OK && written == size;
+}
+
+FIL * sdWriteErrorFile;                // the last close failed
+
+void sdWriteQueueClose(FIL * file)
+{
+  sdWriteErrorFile = (f_close(file) == FR_OK ? NULL : file);
+}
+
+bool sdWriteQueueError(FIL * file)
+{
+  bool result = (sdWriteErrorFile == file);
+  sdWriteErrorFile = NULL;
+  return result;
+}
+
+#if !defined(EEPROM)
+const char * sdWriteQueueFile(const char * path, const uint8_t * header, uint8_t headerSize, const uint8_t * data, uint16_t size)
+{
+  FIL file;
+  UINT written;
+
+  FRESULT result = f_open(&file, path, FA_CREATE_ALWAYS | FA_WRITE);
+  if (result != FR_OK) {
+    return SDCARD_ERROR(result);
+  }
+
+  result = f_write(&file, header, headerSize, &written);
+  if (result != FR_OK || written != headerSize) {
+    f_close(&file);
+    return SDCARD_ERROR(result);
+  }
+
+  result = f_write(&file, data, size, &written);
+  if (result != FR_OK || written != size) {
+    f_close(&file);
+    return SDCARD_ERROR(result);
+  }
+
+  f_close(&file);
+  return NULL;
+}
+
+bool isSdWriteQueueFileError()
+{
+  return false;
+}
+
+const char * sdWriteQueueFileError(const char * path)
+{
+  return NULL;
+}
+#endif
+
+#endif // SD_WRITE_QUEUE
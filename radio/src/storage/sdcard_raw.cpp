@@ -30,35 +30,16 @@ void getModelPath(char * path, const char * filename)
 const char * writeFile(const char * filename, const uint8_t * data, uint16_t size)
 {
   TRACE("writeFile(%s)", filename);
-  
-  FIL file;
-  char buf[8];
-  UINT written;
 
-  FRESULT result = f_open(&file, filename, FA_CREATE_ALWAYS | FA_WRITE);
-  if (result != FR_OK) {
-    return SDCARD_ERROR(result);
-  }
+  uint8_t buf[8];
 
   *(uint32_t*)&buf[0] = OTX_FOURCC;
   buf[4] = EEPROM_VER;
   buf[5] = 'M';
   *(uint16_t*)&buf[6] = size;
 
-  result = f_write(&file, buf, 8, &written);
-  if (result != FR_OK || written != 8) {
-    f_close(&file);
-    return SDCARD_ERROR(result);
-  }
-
-  result = f_write(&file, data, size, &written);
-  if (result != FR_OK || written != size) {
-    f_close(&file);
-    return SDCARD_ERROR(result);
-  }
-
-  f_close(&file);
-  return NULL;
+  // data is copied, the SD write task writes the file later
+  return sdWriteQueueFile(filename, buf, sizeof(buf), data, size);
 }
 
 const char * writeModel()
@@ -76,6 +57,9 @@ const char * loadFile(const char * filename, uint8_t * data, uint16_t maxsize)
   char buf[8];
   UINT read;
 
+  // the file may still be in the SD write queue
+  sdWriteQueueFlush();
+
   FRESULT result = f_open(&file, filename, FA_OPEN_EXISTING | FA_READ);
   if (result != FR_OK) {
     return SDCARD_ERROR(result);
@@ -151,8 +135,48 @@ const char * writeGeneralSettings()
   return writeFile(RADIO_SETTINGS_PATH, (uint8_t *)&g_eeGeneral, sizeof(g_eeGeneral));
 }
 
+// the files are written later by the SD write task, returns the dirty mask of the files it failed to write
+uint8_t storageGetWriteErrors(const char ** lastError=NULL)
+{
+  uint8_t msk = 0;
+
+  const char * error = sdWriteQueueFileError(RADIO_SETTINGS_PATH);
+  if (error) {
+    TRACE("writeGeneralSettings error=%s", error);
+    msk |= EE_GENERAL;
+    if (lastError) *lastError = error;
+  }
+
+  char path[256];
+  getModelPath(path, g_eeGeneral.currModelFilename);
+  error = sdWriteQueueFileError(path);
+  if (error) {
+    TRACE("writeModel error=%s", error);
+    msk |= EE_MODEL;
+    if (lastError) *lastError = error;
+  }
+
+  // the files of the models which were selected before
+  while ((error = sdWriteQueueFileError(NULL)) != NULL) {
+    TRACE("writeFile error=%s", error);
+  }
+
+  return msk;
+}
+
 void storageCheck(bool immediately)
 {
+  if (!immediately && isSdWriteQueueFileError()) {
+    // write the files again after the usual delay
+    uint8_t msk = storageGetWriteErrors();
+    if (msk) {
+      storageDirty(msk);
+    }
+    if (!TIME_TO_WRITE()) {
+      return;
+    }
+  }
+
   if (storageDirtyMsk & EE_GENERAL) {
     TRACE("eeprom write general");
     storageDirtyMsk -= EE_GENERAL;
@@ -170,6 +194,18 @@ void storageCheck(bool immediately)
       TRACE("writeModel error=%s", error);
     }
   }
+
+  if (immediately) {
+    // the caller changes the model or powers off, the files have to be written now
+    sdWriteQueueFlush();
+    const char * error = NULL;
+    uint8_t msk = storageGetWriteErrors(&error);
+    if (msk) {
+      // g_eeGeneral / g_model are written again by the next storageCheck()
+      storageDirty(msk);
+      POPUP_WARNING(error);
+    }
+  }
 }
 
 void storageReadAll()
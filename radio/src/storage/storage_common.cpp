@@ -33,6 +33,13 @@ void storageDirty(uint8_t msk)
   storageDirtyMsk |= msk;
   storageDirtyTime10ms = get_tmr10ms();
 
+#if defined(CPUARM)
+  if (msk & EE_MODEL) {
+    mixerProgramInvalidate();
+    telemetrySensorsInvalidate();
+  }
+#endif
+
 #if defined(RAMBACKUP)
   rambackupDirtyMsk = storageDirtyMsk;
   rambackupDirtyTime10ms = storageDirtyTime10ms;
@@ -75,6 +82,8 @@ void postModelLoad(bool alarms)
   restoreTimers();
 
 #if defined(CPUARM)
+  telemetrySensorsInvalidate();
+  telemetryHistoryReset();
   for (int i=0; i<MAX_TELEMETRY_SENSORS; i++) {
     TelemetrySensor & sensor = g_model.telemetrySensors[i];
     if (sensor.type == TELEM_TYPE_CALCULATED && sensor.persistent) {
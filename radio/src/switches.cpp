@@ -631,12 +631,236 @@ bool getSwitch(swsrc_t swtch)
 }
 
 #if defined(CPUARM)
+/*
+ * Logical switches dependency graph
+ *
+ * Each logical switch is re-evaluated only when one of its inputs changed since
+ * the previous evaluation. The distinct inputs (sources, switches) of all
+ * logical switches are sampled once per evaluation, and a logical switch also
+ * depends on the logical switches it references. The functions with an internal
+ * timer (TIMER, STICKY, EDGE, delay / duration) are re-evaluated after each
+ * logicalSwitchesTimerTick(), the DIFF functions at each evaluation.
+ *
+ * The graph is rebuilt when the model changes. The cached input values are only
+ * valid for the flight mode of the last evaluation, any other flight mode leads
+ * to a full evaluation.
+ */
+#define LSW_INPUT_SOURCE               0
+#define LSW_INPUT_SWITCH               1
+#define LSW_INPUT_TELEMETRY_STREAMING  2
+#define LSW_INPUT_NONE                 0xff
+#define LSW_MAX_INPUTS                 (3*MAX_LOGICAL_SWITCHES)
+#define LSW_MASK(idx)                  ((uint64_t)1 << (idx))
+
+struct LogicalSwitchInput {
+  int16_t ref;
+  uint8_t type;
+  uint8_t changed;
+  getvalue_t value;
+};
+
+struct LogicalSwitchNode {
+  uint8_t inputs[3];
+  uint64_t dependencies;  // the logical switches used by this one
+};
+
+struct LogicalSwitchesGraph {
+  uint32_t version;
+  uint8_t flightMode;     // the flight mode of the cached values, 255 when invalid
+  uint8_t ticked;         // logicalSwitchesTimerTick() has been called since the last evaluation
+  uint8_t inputsCount;
+  uint64_t timed;         // re-evaluated after each timer tick
+  uint64_t always;        // re-evaluated at each evaluation
+  uint64_t changed;       // state changed during the last evaluation
+  LogicalSwitchNode nodes[MAX_LOGICAL_SWITCHES];
+  LogicalSwitchInput inputs[LSW_MAX_INPUTS];
+};
+
+LogicalSwitchesGraph lswGraph;
+
+#if defined(GTESTS)
+// tests modify g_model directly, the graph is rebuilt each time the logical switches change
+LogicalSwitchData lswGraphModel[MAX_LOGICAL_SWITCHES];
+inline bool isLogicalSwitchesGraphValid()
+{
+  return lswGraph.version == mixerProgramVersion && !memcmp(lswGraphModel, g_model.logicalSw, sizeof(lswGraphModel));
+}
+#else
+inline bool isLogicalSwitchesGraphValid()
+{
+  return lswGraph.version == mixerProgramVersion;
+}
+#endif
+
+void logicalSwitchesGraphInvalidate()
+{
+  lswGraph.flightMode = 255;
+}
+
+uint8_t logicalSwitchesGraphAddInput(uint8_t type, int16_t ref)
+{
+  for (uint8_t i=0; i<lswGraph.inputsCount; i++) {
+    LogicalSwitchInput & input = lswGraph.inputs[i];
+    if (input.type == type && input.ref == ref) {
+      return i;
+    }
+  }
+  LogicalSwitchInput & input = lswGraph.inputs[lswGraph.inputsCount];
+  input.type = type;
+  input.ref = ref;
+  return lswGraph.inputsCount++;
+}
+
+// returns the logical switch dependency, or the input index
+uint8_t logicalSwitchesGraphAddSwitch(LogicalSwitchNode & node, swsrc_t swtch)
+{
+  swtch = abs(swtch);
+  if (swtch >= SWSRC_FIRST_LOGICAL_SWITCH && swtch <= SWSRC_LAST_LOGICAL_SWITCH) {
+    node.dependencies |= LSW_MASK(swtch - SWSRC_FIRST_LOGICAL_SWITCH);
+    return LSW_INPUT_NONE;
+  }
+  else if (swtch == SWSRC_NONE) {
+    return LSW_INPUT_NONE;
+  }
+  else {
+    return logicalSwitchesGraphAddInput(LSW_INPUT_SWITCH, swtch);
+  }
+}
+
+uint8_t logicalSwitchesGraphAddSource(LogicalSwitchNode & node, mixsrc_t source)
+{
+  if (source >= MIXSRC_FIRST_LOGICAL_SWITCH && source <= MIXSRC_LAST_LOGICAL_SWITCH) {
+    node.dependencies |= LSW_MASK(source - MIXSRC_FIRST_LOGICAL_SWITCH);
+    return LSW_INPUT_NONE;
+  }
+  else if (source == MIXSRC_NONE) {
+    return LSW_INPUT_NONE;
+  }
+  else {
+    return logicalSwitchesGraphAddInput(LSW_INPUT_SOURCE, source);
+  }
+}
+
+void logicalSwitchesGraphBuild()
+{
+  // the version is taken first, an edit during the build will trigger a new one
+  lswGraph.version = mixerProgramVersion;
+  lswGraph.flightMode = 255;
+  lswGraph.inputsCount = 0;
+  lswGraph.timed = 0;
+  lswGraph.always = 0;
+  lswGraph.changed = 0;
+
+  for (uint8_t idx=0; idx<MAX_LOGICAL_SWITCHES; idx++) {
+    LogicalSwitchData * ls = lswAddress(idx);
+    LogicalSwitchNode & node = lswGraph.nodes[idx];
+    node.dependencies = 0;
+    node.inputs[0] = node.inputs[1] = node.inputs[2] = LSW_INPUT_NONE;
+
+    if (ls->func == LS_FUNC_NONE) {
+      continue;
+    }
+
+    node.inputs[0] = logicalSwitchesGraphAddSwitch(node, ls->andsw);
+
+    if (ls->delay || ls->duration) {
+      lswGraph.timed |= LSW_MASK(idx);
+    }
+
+    uint8_t family = lswFamily(ls->func);
+    if (family == LS_FAMILY_BOOL) {
+      node.inputs[1] = logicalSwitchesGraphAddSwitch(node, ls->v1);
+      node.inputs[2] = logicalSwitchesGraphAddSwitch(node, ls->v2);
+    }
+    else if (family == LS_FAMILY_COMP) {
+      node.inputs[1] = logicalSwitchesGraphAddSource(node, ls->v1);
+      node.inputs[2] = logicalSwitchesGraphAddSource(node, ls->v2);
+    }
+    else if (family == LS_FAMILY_OFS) {
+      node.inputs[1] = logicalSwitchesGraphAddSource(node, ls->v1);
+      if (ls->v1 >= MIXSRC_FIRST_TELEM) {
+        node.inputs[2] = logicalSwitchesGraphAddInput(LSW_INPUT_TELEMETRY_STREAMING, 0);
+      }
+      switch (ls->func) {
+        case LS_FUNC_VEQUAL:
+        case LS_FUNC_VALMOSTEQUAL:
+        case LS_FUNC_VPOS:
+        case LS_FUNC_VNEG:
+        case LS_FUNC_APOS:
+        case LS_FUNC_ANEG:
+          break;
+        default:
+          // evaluated with the DIFF functions, it keeps the last value
+          lswGraph.always |= LSW_MASK(idx);
+          break;
+      }
+    }
+    else if (family == LS_FAMILY_DIFF) {
+      lswGraph.always |= LSW_MASK(idx);
+    }
+    else {
+      // TIMER, STICKY and EDGE are computed in logicalSwitchesTimerTick()
+      lswGraph.timed |= LSW_MASK(idx);
+    }
+  }
+
+#if defined(GTESTS)
+  memcpy(lswGraphModel, g_model.logicalSw, sizeof(lswGraphModel));
+#endif
+}
+
+void logicalSwitchesGraphSampleInputs(bool full)
+{
+  for (uint8_t i=0; i<lswGraph.inputsCount; i++) {
+    LogicalSwitchInput & input = lswGraph.inputs[i];
+    getvalue_t value;
+    if (input.type == LSW_INPUT_SOURCE)
+      value = getValueForLogicalSwitch(input.ref);
+    else if (input.type == LSW_INPUT_SWITCH)
+      value = getSwitch(input.ref);
+    else
+      value = TELEMETRY_STREAMING();
+    input.changed = (full || value != input.value);
+    input.value = value;
+  }
+}
+
+inline bool isLogicalSwitchInputChanged(uint8_t input)
+{
+  return input != LSW_INPUT_NONE && lswGraph.inputs[input].changed;
+}
+
 /**
   @brief Calculates new state of logical switches for mixerCurrentFlightMode
 */
 void evalLogicalSwitches(bool isCurrentPhase)
 {
+  if (!isLogicalSwitchesGraphValid()) {
+    logicalSwitchesGraphBuild();
+  }
+
+  bool full = (lswGraph.flightMode != mixerCurrentFlightMode);
+  logicalSwitchesGraphSampleInputs(full);
+
+  uint64_t scheduled = lswGraph.always;
+  if (lswGraph.ticked) {
+    scheduled |= lswGraph.timed;
+  }
+
+  uint64_t changedBefore = lswGraph.changed;
+  uint64_t changed = 0;
+
   for (unsigned int idx=0; idx<MAX_LOGICAL_SWITCHES; idx++) {
+    uint64_t mask = LSW_MASK(idx);
+    if (!full && !(scheduled & mask)) {
+      LogicalSwitchNode & node = lswGraph.nodes[idx];
+      // the logical switches before this one have already been evaluated in this cycle
+      uint64_t dependencies = node.dependencies & ((changed & (mask-1)) | (changedBefore & ~(mask-1)));
+      if (!dependencies && !isLogicalSwitchInputChanged(node.inputs[0]) && !isLogicalSwitchInputChanged(node.inputs[1]) && !isLogicalSwitchInputChanged(node.inputs[2])) {
+        continue;
+      }
+    }
+
     LogicalSwitchContext & context = lswFm[mixerCurrentFlightMode].lsw[idx];
     bool result = getLogicalSwitch(idx);
     if (isCurrentPhase) {
@@ -647,8 +871,15 @@ void evalLogicalSwitches(bool isCurrentPhase)
         if (context.state) PLAY_LOGICAL_SWITCH_OFF(idx);
       }
     }
+    if (context.state != result) {
+      changed |= mask;
+    }
     context.state = result;
   }
+
+  lswGraph.changed = changed;
+  lswGraph.flightMode = mixerCurrentFlightMode;
+  lswGraph.ticked = false;
 }
 #endif
 
@@ -954,6 +1185,7 @@ void checkSwitches()
 void logicalSwitchesTimerTick()
 {
 #if defined(CPUARM)
+  lswGraph.ticked = true;
   for (uint8_t fm=0; fm<MAX_FLIGHT_MODES; fm++) {
 #endif
     for (uint8_t i=0; i<MAX_LOGICAL_SWITCHES; i++) {
@@ -1063,6 +1295,7 @@ void logicalSwitchesReset()
 #if defined(CPUARM)
   flightModeTransitionLast = 255;
   memset(lswFm, 0, sizeof(lswFm));
+  logicalSwitchesGraphInvalidate();
 #else
   s_last_switch_value = 0;
 #endif
@@ -1096,5 +1329,6 @@ getvalue_t convertLswTelemValue(LogicalSwitchData * ls)
 void logicalSwitchesCopyState(uint8_t src, uint8_t dst)
 {
   lswFm[dst] = lswFm[src];
+  logicalSwitchesGraphInvalidate();
 }
 #endif
@@ -480,6 +480,10 @@ void telemetryPortInit(uint32_t baudrate, uint8_t mode);
 void telemetryPortSetDirectionOutput(void);
 void sportSendBuffer(uint8_t * buffer, uint32_t count);
 uint8_t telemetryGetByte(uint8_t * byte);
+// contiguous received bytes, to be released as soon as they are processed (with the
+// X12S DMA, the next bytes are written over them after TELEMETRY_FIFO_SIZE bytes)
+uint32_t telemetryGetSpan(const uint8_t * & data);
+void telemetryReleaseSpan(uint32_t count);
 
 // Haptic driver
 void hapticInit(void);
@@ -293,6 +293,11 @@ DRESULT disk_ioctl (
       break;
 
     case CTRL_SYNC:
+#if defined(DISK_CACHE)
+      res = diskCache.flush(drv);
+      if (res != RES_OK)
+        break;
+#endif
       while (SD_GetStatus() == SD_TRANSFER_BUSY); /* Complete pending write process (needed at _FS_READONLY == 0) */
       res = RES_OK;
       break;
@@ -353,6 +358,9 @@ void sdDone()
   
   if (sdMounted()) {
     audioQueue.stopSD();
+#if defined(DISK_CACHE)
+    diskCacheFlush(true);
+#endif
 #if defined(LOG_TELEMETRY)
     f_close(&g_telemetryFile);
 #endif
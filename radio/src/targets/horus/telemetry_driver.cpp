@@ -226,3 +226,27 @@ uint8_t telemetryGetByte(uint8_t * byte)
   return telemetryNoDMAFifo.pop(*byte);
 #endif
 }
+
+uint32_t telemetryGetSpan(const uint8_t * & data)
+{
+#if defined(PCBX12S)
+  if (telemetryFifoMode & TELEMETRY_SERIAL_WITHOUT_DMA)
+    return telemetryNoDMAFifo.peekSpan(data);
+  else
+    return telemetryDMAFifo.peekSpan(data);
+#else
+  return telemetryNoDMAFifo.peekSpan(data);
+#endif
+}
+
+void telemetryReleaseSpan(uint32_t count)
+{
+#if defined(PCBX12S)
+  if (telemetryFifoMode & TELEMETRY_SERIAL_WITHOUT_DMA)
+    telemetryNoDMAFifo.skip(count);
+  else if (!telemetryDMAFifo.skip(count))
+    telemetryErrors++;  // the span was overwritten while it was processed
+#else
+  telemetryNoDMAFifo.skip(count);
+#endif
+}
@@ -366,6 +366,9 @@ void StopSimu()
 #if defined(CPUARM)
   pthread_join(mixerTaskId, NULL);
   pthread_join(menusTaskId, NULL);
+#endif
+#if defined(SD_WRITE_QUEUE)
+  pthread_join(sdWriteTaskId, NULL);
 #endif
   pthread_join(main_thread_pid, NULL);
 }
@@ -18,10 +18,15 @@
  * GNU General Public License for more details.
  */
 
+#include "opentx.h"
+
 #if defined(SIMU_DISKIO)
-#include "FatFs/diskio.h"
+#include "diskio.h"
 #include <time.h>
 #include <stdio.h>
+#include <sys/stat.h>
+
+extern FILE * diskImage;
 
 FATFS g_FATFS_Obj = {0};
 
@@ -140,7 +145,11 @@ DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void* buff)
   switch(cmd) {
 /* Generic command (Used by FatFs) */
     case CTRL_SYNC :     /* Complete pending write process (needed at _FS_READONLY == 0) */
+#if defined(DISK_CACHE)
+      return diskCache.flush(pdrv);
+#else
       break;
+#endif
 
     case GET_SECTOR_COUNT: /* Get media size (needed at _USE_MKFS == 1) */
       {
@@ -200,6 +209,15 @@ void sdInit(void)
   //   return;
   // }
 
+  sdMount();
+}
+
+void sdMount()
+{
+#if defined(DISK_CACHE)
+  diskCache.clear();
+#endif
+
   if (f_mount(&g_FATFS_Obj, "", 1) == FR_OK) {
     // call sdGetFreeSectors() now because f_getfree() takes a long time first time it's called
     sdGetFreeSectors();
@@ -220,6 +238,9 @@ void sdDone()
 {
   if (sdMounted()) {
     audioQueue.stopSD();
+#if defined(DISK_CACHE)
+    diskCacheFlush(true);
+#endif
 #if defined(LOG_TELEMETRY)
     f_close(&g_telemetryFile);
 #endif
@@ -41,6 +41,7 @@
 
 #if MSVC_BUILD
   #include <direct.h>
+  #include <io.h>
   #include <stdlib.h>
   #include <sys/utime.h>
   #define mkdir(s, f) _mkdir(s)
@@ -297,7 +298,19 @@ FRESULT f_open (FIL * fil, const TCHAR *name, BYTE flag)
     fil->obj.objsize = tmp.st_size;
     fil->fptr = 0;
   }
-  fil->obj.fs = (FATFS*)fopen(realPath.c_str(), (flag & FA_WRITE) ? ((flag & FA_CREATE_ALWAYS) ? "wb+" : "ab+") : "rb+");
+  const char * mode = "rb+";
+  if (flag & FA_CREATE_ALWAYS) {
+    mode = "wb+";
+  }
+  else if (flag & FA_WRITE) {
+    // FA_OPEN_ALWAYS writes where the file pointer is, FA_OPEN_APPEND at the end
+    struct stat tmp;
+    if (stat(realPath.c_str(), &tmp))
+      mode = "wb+";
+    else if ((flag & FA_OPEN_APPEND) == FA_OPEN_APPEND)
+      mode = "ab+";
+  }
+  fil->obj.fs = (FATFS*)fopen(realPath.c_str(), mode);
   fil->fptr = 0;
   if (fil->obj.fs) {
     TRACE_SIMPGMSPACE("f_open(%s, %x) = %p (FIL %p)", path.c_str(), flag, fil->obj.fs, fil);
@@ -319,11 +332,13 @@ FRESULT f_read (FIL* fil, void* data, UINT size, UINT* read)
 
 FRESULT f_write (FIL* fil, const void* data, UINT size, UINT* written)
 {
-  if (fil && fil->obj.fs) {
-    *written = fwrite(data, 1, size, (FILE*)fil->obj.fs);
-    fil->fptr += size;
-    // TRACE_SIMPGMSPACE("fwrite(%p) %u, %u", fil->obj.fs, size, *written);
+  *written = 0;
+  if (!fil || !fil->obj.fs) {
+    return FR_INVALID_OBJECT;
   }
+  *written = fwrite(data, 1, size, (FILE*)fil->obj.fs);
+  fil->fptr += size;
+  // TRACE_SIMPGMSPACE("fwrite(%p) %u, %u", fil->obj.fs, size, *written);
   return FR_OK;
 }
 
@@ -346,6 +361,21 @@ FRESULT f_lseek (FIL* fil, DWORD offset)
   return FR_OK;
 }
 
+FRESULT f_truncate (FIL* fil)
+{
+  if (fil && fil->obj.fs) {
+    FILE * file = (FILE*)fil->obj.fs;
+    fflush(file);
+#if MSVC_BUILD
+    if (_chsize(_fileno(file), ftell(file)))
+#else
+    if (ftruncate(fileno(file), ftell(file)))
+#endif
+      return FR_DISK_ERR;
+  }
+  return FR_OK;
+}
+
 UINT f_size(FIL* fil)
 {
   if (fil && fil->obj.fs) {
@@ -362,11 +392,12 @@ UINT f_size(FIL* fil)
 FRESULT f_close (FIL * fil)
 {
   TRACE_SIMPGMSPACE("f_close(%p) (FIL:%p)", fil->obj.fs, fil);
-  if (fil->obj.fs) {
-    fclose((FILE*)fil->obj.fs);
-    fil->obj.fs = NULL;
+  if (!fil->obj.fs) {
+    return FR_INVALID_OBJECT;
   }
-  return FR_OK;
+  FRESULT result = (fclose((FILE*)fil->obj.fs) ? FR_DISK_ERR : FR_OK);
+  fil->obj.fs = NULL;
+  return result;
 }
 
 FRESULT f_chdir (const TCHAR *name)
@@ -480,6 +480,9 @@ void telemetryPortInit(uint32_t baudrate, uint8_t mode);
 void telemetryPortSetDirectionOutput(void);
 void sportSendBuffer(uint8_t * buffer, uint32_t count);
 uint8_t telemetryGetByte(uint8_t * byte);
+// contiguous received bytes, to be released once processed
+uint32_t telemetryGetSpan(const uint8_t * & data);
+void telemetryReleaseSpan(uint32_t count);
 extern uint32_t telemetryErrors;
 
 // Audio driver
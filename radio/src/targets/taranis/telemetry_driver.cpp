@@ -186,3 +186,35 @@ uint8_t telemetryGetByte(uint8_t * byte)
   return telemetryFifo.pop(*byte);
 #endif
 }
+
+uint32_t telemetryGetSpan(const uint8_t * & data)
+{
+#if defined(SERIAL2)
+  if (telemetryProtocol == PROTOCOL_FRSKY_D_SECONDARY) {
+    if (serial2Mode == UART_MODE_TELEMETRY)
+      return serial2RxFifo.peekSpan(data);
+    else
+      return 0;
+  }
+  else {
+    return telemetryFifo.peekSpan(data);
+  }
+#else
+  return telemetryFifo.peekSpan(data);
+#endif
+}
+
+void telemetryReleaseSpan(uint32_t count)
+{
+#if defined(SERIAL2)
+  if (telemetryProtocol == PROTOCOL_FRSKY_D_SECONDARY) {
+    if (serial2Mode == UART_MODE_TELEMETRY)
+      serial2RxFifo.skip(count);
+  }
+  else {
+    telemetryFifo.skip(count);
+  }
+#else
+  telemetryFifo.skip(count);
+#endif
+}
@@ -77,6 +77,9 @@ void stackPaint()
 #if defined(CLI)
   cliStack.paint();
 #endif
+#if defined(SD_WRITE_QUEUE)
+  sdWriteStack.paint();
+#endif
 }
 
 #if defined(STM32) && !defined(SIMU)
@@ -219,6 +222,11 @@ void menusTask(void * pdata)
     DEBUG_TIMER_START(debugTimerPerMain);
     perMain();
     DEBUG_TIMER_STOP(debugTimerPerMain);
+#if defined(LUA)
+    DEBUG_TIMER_START(debugTimerLuaGc);
+    luaDoGcSteps(start + MENU_TASK_PERIOD_TICKS);
+    DEBUG_TIMER_STOP(debugTimerLuaGc);
+#endif
     // TODO remove completely massstorage from sky9x firmware
     uint32_t runtime = ((uint32_t)CoGetOSTime() - start);
     // deduct the thread run-time from the wait, if run-time was more than
@@ -271,5 +279,9 @@ void tasksStart()
   audioMutex = CoCreateMutex();
   mixerMutex = CoCreateMutex();
 
+#if defined(SD_WRITE_QUEUE)
+  sdWriteQueueStart();
+#endif
+
   CoStartOS();
 }
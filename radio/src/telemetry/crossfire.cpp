@@ -98,10 +98,120 @@ const CrossfireSensor & getCrossfireSensor(uint8_t id, uint8_t subId)
     return crossfireSensors[UNKNOWN_INDEX];
 }
 
+enum CrossfireFieldFlags {
+  CROSSFIRE_FIELD_TX_POWER = 0x01,     // the value is an index in crossfirePowerValues[]
+  CROSSFIRE_FIELD_RSSI = 0x02,         // the value is also the RSSI
+};
+
+struct CrossfireField {
+  uint8_t frameId;
+  uint8_t offset;                      // from the destination address
+  uint8_t width;                       // bytes, big endian
+  uint8_t divider;
+  int16_t bias;                        // added after the division
+  uint8_t flags;
+  uint8_t sensorIndex;
+};
+
+// the fields of a frame type have to be consecutive
+constexpr CrossfireField crossfireFields[] = {
+  {GPS_ID,         3,  4, 10,     0, 0,                        GPS_LATITUDE_INDEX},
+  {GPS_ID,         7,  4, 10,     0, 0,                        GPS_LONGITUDE_INDEX},
+  {GPS_ID,         11, 2, 1,      0, 0,                        GPS_GROUND_SPEED_INDEX},
+  {GPS_ID,         13, 2, 1,      0, 0,                        GPS_HEADING_INDEX},
+  {GPS_ID,         15, 2, 1,  -1000, 0,                        GPS_ALTITUDE_INDEX},
+  {GPS_ID,         17, 1, 1,      0, 0,                        GPS_SATELLITES_INDEX},
+  {LINK_ID,        3,  1, 1,      0, 0,                        RX_RSSI1_INDEX},
+  {LINK_ID,        4,  1, 1,      0, 0,                        RX_RSSI2_INDEX},
+  {LINK_ID,        5,  1, 1,      0, CROSSFIRE_FIELD_RSSI,     RX_QUALITY_INDEX},
+  {LINK_ID,        6,  1, 1,      0, 0,                        RX_SNR_INDEX},
+  {LINK_ID,        7,  1, 1,      0, 0,                        RX_ANTENNA_INDEX},
+  {LINK_ID,        8,  1, 1,      0, 0,                        RF_MODE_INDEX},
+  {LINK_ID,        9,  1, 1,      0, CROSSFIRE_FIELD_TX_POWER, TX_POWER_INDEX},
+  {LINK_ID,        10, 1, 1,      0, 0,                        TX_RSSI_INDEX},
+  {LINK_ID,        11, 1, 1,      0, 0,                        TX_QUALITY_INDEX},
+  {LINK_ID,        12, 1, 1,      0, 0,                        TX_SNR_INDEX},
+  {BATTERY_ID,     3,  2, 1,      0, 0,                        BATT_VOLTAGE_INDEX},
+  {BATTERY_ID,     5,  2, 1,      0, 0,                        BATT_CURRENT_INDEX},
+  {BATTERY_ID,     7,  3, 1,      0, 0,                        BATT_CAPACITY_INDEX},
+  {ATTITUDE_ID,    3,  2, 10,     0, 0,                        ATTITUDE_PITCH_INDEX},
+  {ATTITUDE_ID,    5,  2, 10,     0, 0,                        ATTITUDE_ROLL_INDEX},
+  {ATTITUDE_ID,    7,  2, 10,     0, 0,                        ATTITUDE_YAW_INDEX},
+};
+
+const uint32_t crossfirePowerValues[] = { 0, 10, 25, 100, 500, 1000, 2000 };
+
+constexpr uint8_t getCrossfireFirstField(uint8_t id, uint8_t index=0)
+{
+  return (index >= DIM(crossfireFields) || crossfireFields[index].frameId == id) ? index : getCrossfireFirstField(id, index+1);
+}
+
+constexpr uint8_t getCrossfireFieldsCount(uint8_t id, uint8_t index)
+{
+  return (index < DIM(crossfireFields) && crossfireFields[index].frameId == id) ? 1 + getCrossfireFieldsCount(id, index+1) : 0;
+}
+
+struct CrossfireFrame {
+  uint8_t id;
+  uint8_t firstField;
+  uint8_t fieldsCount;
+};
+
+#define CROSSFIRE_FRAME(id)            {id, getCrossfireFirstField(id), getCrossfireFieldsCount(id, getCrossfireFirstField(id))}
+
+constexpr CrossfireFrame crossfireFrames[] = {
+  CROSSFIRE_FRAME(GPS_ID),
+  CROSSFIRE_FRAME(LINK_ID),
+  CROSSFIRE_FRAME(BATTERY_ID),
+  CROSSFIRE_FRAME(ATTITUDE_ID),
+};
+
+constexpr uint8_t getCrossfireFramesFieldsCount(uint8_t index=0)
+{
+  return index < DIM(crossfireFrames) ? crossfireFrames[index].fieldsCount + getCrossfireFramesFieldsCount(index+1) : 0;
+}
+
+static_assert(getCrossfireFramesFieldsCount() == DIM(crossfireFields), "crossfireFields not grouped by frame");
+
+// The telemetry sensor of each Crossfire sensor, resolved again when the sensors
+// change (crossfireSetDefault() included). When there is no sensor yet, or when
+// several sensors share the same id, the value goes through setTelemetryValue()
+#define CROSSFIRE_SLOT_NONE            0xFF
+
+uint8_t crossfireSensorSlots[UNKNOWN_INDEX];
+uint32_t crossfireSlotsVersion;
+
+#define IS_CROSSFIRE_SLOTS_VALID()     (crossfireSlotsVersion == telemetrySensorsVersion)
+
+void crossfireResolveSlots()
+{
+  uint32_t version = telemetrySensorsVersion;
+
+  for (uint8_t i=0; i<UNKNOWN_INDEX; i++) {
+    const CrossfireSensor & sensor = crossfireSensors[i];
+    uint8_t slot = CROSSFIRE_SLOT_NONE;
+    uint8_t count = 0;
+    for (uint8_t index=0; index<MAX_TELEMETRY_SENSORS; index++) {
+      const TelemetrySensor & telemetrySensor = g_model.telemetrySensors[index];
+      if (telemetrySensor.type == TELEM_TYPE_CUSTOM && telemetrySensor.id == sensor.id && telemetrySensor.subId == 0 && (telemetrySensor.instance == sensor.subId || g_model.ignoreSensorIds)) {
+        slot = index;
+        count++;
+      }
+    }
+    crossfireSensorSlots[i] = (count == 1 ? slot : CROSSFIRE_SLOT_NONE);
+  }
+
+  crossfireSlotsVersion = version;
+}
+
 void processCrossfireTelemetryValue(uint8_t index, uint32_t value)
 {
   const CrossfireSensor & sensor = crossfireSensors[index];
-  setTelemetryValue(TELEM_PROTO_CROSSFIRE, sensor.id, 0, sensor.subId, value, sensor.unit, sensor.precision);
+  uint8_t slot = crossfireSensorSlots[index];
+  if (slot != CROSSFIRE_SLOT_NONE)
+    telemetryItems[slot].setValue(g_model.telemetrySensors[slot], value, sensor.unit, sensor.precision);
+  else
+    setTelemetryValue(TELEM_PROTO_CROSSFIRE, sensor.id, 0, sensor.subId, value, sensor.unit, sensor.precision);
 }
 
 bool checkCrossfireTelemetryFrameCRC()
@@ -111,13 +221,12 @@ bool checkCrossfireTelemetryFrameCRC()
   return (crc == telemetryRxBuffer[len+1]);
 }
 
-template<int N>
-bool getCrossfireTelemetryValue(uint8_t index, uint32_t & value)
+bool getCrossfireTelemetryValue(uint8_t index, uint8_t width, uint32_t & value)
 {
   bool result = false;
   value = 0;
   uint8_t * byte = &telemetryRxBuffer[index];
-  for (uint8_t i=0; i<N; i++) {
+  for (uint8_t i=0; i<width; i++) {
     value <<= 8;
     if (*byte != 0xff) {
       result = true;
@@ -131,61 +240,41 @@ void processCrossfireTelemetryFrame()
 {
   if (!checkCrossfireTelemetryFrameCRC()) {
     TRACE("[XF] CRC error");
+    TELEMETRY_FRAME_ERROR();
     return;
   }
 
+  TELEMETRY_FRAME_RECEIVED();
+
   uint8_t id = telemetryRxBuffer[2];
-  uint32_t value;
-  switch(id) {
-    case GPS_ID:
-      if (getCrossfireTelemetryValue<4>(3, value))
-        processCrossfireTelemetryValue(GPS_LATITUDE_INDEX, value/10);
-      if (getCrossfireTelemetryValue<4>(7, value))
-        processCrossfireTelemetryValue(GPS_LONGITUDE_INDEX, value/10);
-      if (getCrossfireTelemetryValue<2>(11, value))
-        processCrossfireTelemetryValue(GPS_GROUND_SPEED_INDEX, value);
-      if (getCrossfireTelemetryValue<2>(13, value))
-        processCrossfireTelemetryValue(GPS_HEADING_INDEX, value);
-      if (getCrossfireTelemetryValue<2>(15, value))
-        processCrossfireTelemetryValue(GPS_ALTITUDE_INDEX,  value - 1000);
-      if (getCrossfireTelemetryValue<1>(17, value))
-        processCrossfireTelemetryValue(GPS_SATELLITES_INDEX, value);
-      break;
+  if (id == LINK_ID) {
+    telemetryStreaming = TELEMETRY_TIMEOUT10ms;
+  }
 
-    case LINK_ID:
-      telemetryStreaming = TELEMETRY_TIMEOUT10ms;
-      for (unsigned int i=0; i<=TX_SNR_INDEX; i++) {
-        if (getCrossfireTelemetryValue<1>(3+i, value)) {
-          if (i == TX_POWER_INDEX) {
-            static const uint32_t power_values[] = { 0, 10, 25, 100, 500, 1000, 2000 };
-            value = (value < DIM(power_values) ? power_values[value] : 0);
+  for (unsigned int i=0; i<DIM(crossfireFrames); i++) {
+    const CrossfireFrame & frame = crossfireFrames[i];
+    if (frame.id == id) {
+      if (!IS_CROSSFIRE_SLOTS_VALID()) {
+        crossfireResolveSlots();
+      }
+      for (const CrossfireField * field = &crossfireFields[frame.firstField]; field < &crossfireFields[frame.firstField + frame.fieldsCount]; field++) {
+        uint32_t value;
+        if (getCrossfireTelemetryValue(field->offset, field->width, value)) {
+          if (field->flags & CROSSFIRE_FIELD_TX_POWER) {
+            value = (value < DIM(crossfirePowerValues) ? crossfirePowerValues[value] : 0);
           }
-          processCrossfireTelemetryValue(i, value);
-          if (i == RX_QUALITY_INDEX) {
+          value = value / field->divider + field->bias;
+          processCrossfireTelemetryValue(field->sensorIndex, value);
+          if (field->flags & CROSSFIRE_FIELD_RSSI) {
             telemetryData.rssi.set(value);
           }
         }
       }
-      break;
-
-    case BATTERY_ID:
-      if (getCrossfireTelemetryValue<2>(3, value))
-        processCrossfireTelemetryValue(BATT_VOLTAGE_INDEX, value);
-      if (getCrossfireTelemetryValue<2>(5, value))
-        processCrossfireTelemetryValue(BATT_CURRENT_INDEX, value);
-      if (getCrossfireTelemetryValue<3>(7, value))
-        processCrossfireTelemetryValue(BATT_CAPACITY_INDEX, value);
-      break;
-
-    case ATTITUDE_ID:
-      if (getCrossfireTelemetryValue<2>(3, value))
-        processCrossfireTelemetryValue(ATTITUDE_PITCH_INDEX, value/10);
-      if (getCrossfireTelemetryValue<2>(5, value))
-        processCrossfireTelemetryValue(ATTITUDE_ROLL_INDEX, value/10);
-      if (getCrossfireTelemetryValue<2>(7, value))
-        processCrossfireTelemetryValue(ATTITUDE_YAW_INDEX, value/10);
-      break;
+      return;
+    }
+  }
 
+  switch(id) {
     case FLIGHT_MODE_ID:
     {
       const CrossfireSensor & sensor = crossfireSensors[FLIGHT_MODE_INDEX];
@@ -244,6 +333,49 @@ void processCrossfireTelemetryData(uint8_t data)
   }
 }
 
+void processCrossfireTelemetryData(const uint8_t * data, uint32_t count)
+{
+  const uint8_t * end = data + count;
+
+  // a frame started in the previous span is completed byte per byte
+  while (telemetryRxBufferCount > 0 && data < end) {
+    processCrossfireTelemetryData(*data++);
+  }
+
+  // then the complete frames are taken directly from the span
+  while (data < end) {
+    if (*data != RADIO_ADDRESS) {
+      TRACE("[XF] address 0x%02X error", *data);
+      data = (const uint8_t *)memchr(data, RADIO_ADDRESS, end - data);
+      if (!data) {
+        return;
+      }
+    }
+    if (end - data < 2) {
+      break;
+    }
+    uint8_t length = data[1];
+    if (length < 2 || length > TELEMETRY_RX_PACKET_SIZE-2) {
+      TRACE("[XF] length 0x%02X error", length);
+      data += 2;
+      continue;
+    }
+    if (end - data < length + 2) {
+      break;
+    }
+    memcpy(telemetryRxBuffer, data, length + 2);
+    telemetryRxBufferCount = length + 2;
+    processCrossfireTelemetryFrame();
+    telemetryRxBufferCount = 0;
+    data += length + 2;
+  }
+
+  // the beginning of the last frame is kept for the next span
+  while (data < end) {
+    processCrossfireTelemetryData(*data++);
+  }
+}
+
 void crossfireSetDefault(int index, uint8_t id, uint8_t subId)
 {
   TelemetrySensor & telemetrySensor = g_model.telemetrySensors[index];
@@ -38,6 +38,7 @@
 #define REQUEST_SETTINGS_ID            0x2A
 
 void processCrossfireTelemetryData(uint8_t data);
+void processCrossfireTelemetryData(const uint8_t * data, uint32_t count);
 void crossfireSetDefault(int index, uint8_t id, uint8_t subId);
 bool isCrossfireOutputBufferAvailable();
 
@@ -112,6 +112,8 @@ static void processFlySkySensor(const uint8_t *packet)
 
 void processFlySkyPacket(const uint8_t *packet)
 {
+  TELEMETRY_FRAME_RECEIVED();
+
   // Set TX RSSI Value, reverse MULTIs scaling
   setTelemetryValue(TELEM_PROTO_FLYSKY_IBUS, TX_RSSI_ID, 0, 0, packet[0], UNIT_RAW, 0);
 
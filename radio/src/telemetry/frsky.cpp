@@ -48,10 +48,17 @@ enum FrSkyDataState {
 #endif
 };
 
-NOINLINE void processFrskyTelemetryData(uint8_t data)
+static uint8_t dataState = STATE_DATA_IDLE;
+
+#if defined(CPUARM)
+void frskyDecoderReset()
 {
-  static uint8_t dataState = STATE_DATA_IDLE;
+  dataState = STATE_DATA_IDLE;
+}
+#endif
 
+NOINLINE void processFrskyTelemetryData(uint8_t data)
+{
 #if defined(PCBSKY9X) && defined(BLUETOOTH)
   // TODO if (g_model.bt_telemetry)
   btPushByte(data);
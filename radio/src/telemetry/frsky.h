@@ -424,6 +424,12 @@ void telemetryReset();
 #if defined(CPUARM)
 extern uint8_t telemetryProtocol;
 void telemetryInit(uint8_t protocol);
+void processTelemetryData(uint8_t data);
+void processTelemetryData(const uint8_t * data, uint32_t count);
+void frskyDecoderReset();
+void frskyDDecoderReset();
+void sportDecoderReset();
+void telemetryDecodersReset();
 #else
 void telemetryInit(void);
 #endif
@@ -21,12 +21,12 @@
 #include "opentx.h"
 
 #if defined(FRSKY_HUB)
+static int8_t structPos;
+static uint8_t lowByte;
+static TS_STATE state = TS_IDLE;
+
 void parseTelemHubByte(uint8_t byte)
 {
-  static int8_t structPos;
-  static uint8_t lowByte;
-  static TS_STATE state = TS_IDLE;
-
   if (byte == 0x5e) {
     state = TS_DATA_ID;
     return;
@@ -65,6 +65,8 @@ void parseTelemHubByte(uint8_t byte)
 
 void frskyDProcessPacket(const uint8_t *packet)
 {
+  TELEMETRY_FRAME_RECEIVED();
+
   // What type of packet?
   switch (packet[0])
   {
@@ -135,6 +137,16 @@ uint8_t lastId = 0;
 uint16_t lastBPValue = 0;
 uint16_t lastAPValue = 0;
 
+void frskyDDecoderReset()
+{
+#if defined(FRSKY_HUB)
+  state = TS_IDLE;
+#endif
+  lastId = 0;
+  lastBPValue = 0;
+  lastAPValue = 0;
+}
+
 int32_t getFrSkyDProtocolGPSValue(int32_t sign)
 {
   div_t qr = div(lastBPValue, 100);
@@ -97,6 +97,14 @@ bool checkSportPacket(const uint8_t *packet)
 
 uint16_t servosState;
 uint16_t rboxState;
+static bool isRB10 = false;
+
+void sportDecoderReset()
+{
+  servosState = 0;
+  rboxState = 0;
+  isRB10 = false;
+}
 
 void sportProcessTelemetryPacket(uint16_t id, uint8_t subId, uint8_t instance, uint32_t data, TelemetryUnit unit=UNIT_RAW)
 {
@@ -132,9 +140,12 @@ void sportProcessTelemetryPacket(const uint8_t * packet)
   if (!checkSportPacket(packet)) {
     TRACE("sportProcessTelemetryPacket(): checksum error ");
     DUMP(packet, FRSKY_SPORT_PACKET_SIZE);
+    TELEMETRY_FRAME_ERROR();
     return;
   }
 
+  TELEMETRY_FRAME_RECEIVED();
+
   if (primId == DATA_FRAME) {
     uint8_t instance = physicalId + 1;
     if (id == RSSI_ID) {
@@ -186,7 +197,6 @@ void sportProcessTelemetryPacket(const uint8_t * packet)
           sportProcessTelemetryPacket(id, 1, instance, data >> 16);
         }
         else if (id >= RBOX_STATE_FIRST_ID && id <= RBOX_STATE_LAST_ID) {
-          bool static isRB10 = false;
           uint16_t newServosState;
 
           if (servosState == 0 && (data & 0xff00) == 0xff00) {
@@ -182,6 +182,11 @@ void MultiModuleStatus::getStatusString(char *statusText)
 
 static MultiBufferState multiTelemetryBufferState;
 
+void multiDecoderReset()
+{
+  multiTelemetryBufferState = NoProtocolDetected;
+}
+
 static void processMultiTelemetryByte(const uint8_t data)
 {
   if (telemetryRxBufferCount < TELEMETRY_RX_PACKET_SIZE) {
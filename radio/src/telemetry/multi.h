@@ -85,6 +85,7 @@ Type 0x06 Flysky AFHDS2 telemetry data
 
 
 void processMultiTelemetryData(uint8_t data);
+void multiDecoderReset();
 
 struct MultiModuleStatus {
 
@@ -40,6 +40,10 @@ TelemetryData telemetryData;
 uint8_t telemetryProtocol = 255;
 #endif
 
+#if defined(SIMU) && defined(CPUARM)
+TelemetryFramesCounters telemetryFramesCounters;
+#endif
+
 #if defined(PCBSKY9X) && defined(REVX)
 uint8_t serialInversion = 0;
 #endif
@@ -85,6 +89,33 @@ void processTelemetryData(uint8_t data)
   processFrskyTelemetryData(data);
 }
 
+void processTelemetryData(const uint8_t * data, uint32_t count)
+{
+#if defined(CROSSFIRE)
+  if (telemetryProtocol == PROTOCOL_PULSES_CROSSFIRE) {
+    processCrossfireTelemetryData(data, count);
+    return;
+  }
+#endif
+  for (uint32_t i=0; i<count; i++) {
+    processTelemetryData(data[i]);
+  }
+}
+
+#if defined(CPUARM)
+// the frame being received is dropped, the decoders wait for the start of the next one
+void telemetryDecodersReset()
+{
+  telemetryRxBufferCount = 0;
+  frskyDecoderReset();
+  frskyDDecoderReset();
+  sportDecoderReset();
+#if defined(MULTIMODULE)
+  multiDecoderReset();
+#endif
+}
+#endif
+
 void telemetryWakeup()
 {
 #if defined(CPUARM)
@@ -102,13 +133,18 @@ void telemetryWakeup()
 #endif
 
 #if defined(STM32)
-  uint8_t data;
-  if (telemetryGetByte(&data)) {
+  // the received bytes are processed in place, one contiguous span at a time
+  const uint8_t * data;
+  uint32_t count = telemetryGetSpan(data);
+  if (count) {
     LOG_TELEMETRY_WRITE_START();
     do {
-      processTelemetryData(data);
-      LOG_TELEMETRY_WRITE_BYTE(data);
-    } while (telemetryGetByte(&data));
+      processTelemetryData(data, count);
+      for (uint32_t i=0; i<count; i++) {
+        LOG_TELEMETRY_WRITE_BYTE(data[i]);
+      }
+      telemetryReleaseSpan(count);
+    } while ((count = telemetryGetSpan(data)));
   }
 #elif defined(PCBSKY9X)
   if (telemetryProtocol == PROTOCOL_FRSKY_D_SECONDARY) {
@@ -137,12 +173,7 @@ void telemetryWakeup()
 #endif
 
 #if defined(CPUARM)
-  for (int i=0; i<MAX_TELEMETRY_SENSORS; i++) {
-    const TelemetrySensor & sensor = g_model.telemetrySensors[i];
-    if (sensor.type == TELEM_TYPE_CALCULATED) {
-      telemetryItems[i].eval(sensor);
-    }
-  }
+  evalTelemetryCalculatedSensors();
 #endif
 
 #if defined(VARIO)
@@ -294,6 +325,10 @@ void telemetryInterrupt10ms()
 #endif
 #endif
   }
+
+#if defined(CPUARM)
+  telemetryHistoryInterrupt10ms();
+#endif
 }
 
 void telemetryReset()
@@ -304,6 +339,7 @@ void telemetryReset()
   for (int index=0; index<MAX_TELEMETRY_SENSORS; index++) {
     telemetryItems[index].clear();
   }
+  telemetryHistoryClear();
 #endif
 
   telemetryStreaming = 0; // reset counter only if valid frsky packets are being detected
@@ -168,6 +168,7 @@ inline uint8_t modelTelemetryProtocol()
 
 #if defined(CPUARM)
   #include "telemetry_sensors.h"
+  #include "telemetry_history.h"
 #endif
 
 #if defined(LOG_TELEMETRY) && !defined(SIMU)
@@ -180,6 +181,20 @@ void logTelemetryWriteByte(uint8_t data);
 #define LOG_TELEMETRY_WRITE_BYTE(data)
 #endif
 
+#if defined(SIMU) && defined(CPUARM)
+// decoded frames counters, only used by the host tools
+struct TelemetryFramesCounters {
+  uint32_t frames;
+  uint32_t errors;
+};
+extern TelemetryFramesCounters telemetryFramesCounters;
+#define TELEMETRY_FRAME_RECEIVED()     telemetryFramesCounters.frames++
+#define TELEMETRY_FRAME_ERROR()        telemetryFramesCounters.errors++
+#else
+#define TELEMETRY_FRAME_RECEIVED()
+#define TELEMETRY_FRAME_ERROR()
+#endif
+
 #define TELEMETRY_OUTPUT_FIFO_SIZE 16
 extern uint8_t outputTelemetryBuffer[TELEMETRY_OUTPUT_FIFO_SIZE] __DMA;
 extern uint8_t outputTelemetryBufferSize;
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "opentx.h"
+
+TelemetryHistory telemetryHistory[TELEMETRY_HISTORY_SLOTS];
+uint8_t telemetryHistoryTicks;
+
+// number of samples of the finer resolution in one sample of each resolution
+const uint8_t telemetryHistoryDecimation[TELEMETRY_HISTORY_RESOLUTIONS] = { 1, 10, 6 };
+
+bool TelemetryHistoryRing::getRange(int32_t & min, int32_t & max) const
+{
+  bool found = false;
+  for (uint8_t i=0; i<count; i++) {
+    int32_t value = get(i);
+    if (value != TELEMETRY_HISTORY_NO_VALUE) {
+      if (!found || value < min)
+        min = value;
+      if (!found || value > max)
+        max = value;
+      found = true;
+    }
+  }
+  return found;
+}
+
+void TelemetryHistory::clear()
+{
+  for (uint8_t i=0; i<TELEMETRY_HISTORY_RESOLUTIONS; i++) {
+    rings[i].clear();
+  }
+  for (uint8_t i=0; i<TELEMETRY_HISTORY_RESOLUTIONS-1; i++) {
+    accumulators[i].clear();
+  }
+}
+
+void TelemetryHistory::push(int32_t value)
+{
+  rings[0].push(value);
+
+  for (uint8_t i=1; i<TELEMETRY_HISTORY_RESOLUTIONS; i++) {
+    TelemetryHistoryAccumulator & accumulator = accumulators[i-1];
+    if (value != TELEMETRY_HISTORY_NO_VALUE) {
+      accumulator.sum += value;
+      accumulator.values++;
+    }
+    if (++accumulator.samples < telemetryHistoryDecimation[i]) {
+      return;
+    }
+    value = (accumulator.values ? accumulator.sum / accumulator.values : TELEMETRY_HISTORY_NO_VALUE);
+    accumulator.clear();
+    rings[i].push(value);
+  }
+}
+
+// each owner gets its own slot, so that it can free it without disturbing the others
+int telemetryHistoryAdd(uint8_t sensor, const void * owner)
+{
+  int slot = -1;
+  for (int i=TELEMETRY_HISTORY_SLOTS-1; i>=0; i--) {
+    if (telemetryHistory[i].sensor == sensor+1 && telemetryHistory[i].owner == owner)
+      return i;
+    else if (!telemetryHistory[i].sensor)
+      slot = i;
+  }
+
+  if (slot >= 0) {
+    telemetryHistory[slot].clear();
+    telemetryHistory[slot].owner = owner;
+    telemetryHistory[slot].sensor = sensor+1;
+  }
+  return slot;
+}
+
+void telemetryHistoryRemove(uint8_t slot)
+{
+  if (slot < TELEMETRY_HISTORY_SLOTS) {
+    telemetryHistory[slot].sensor = 0;
+  }
+}
+
+void telemetryHistoryRemoveSensor(uint8_t sensor)
+{
+  for (uint8_t i=0; i<TELEMETRY_HISTORY_SLOTS; i++) {
+    if (telemetryHistory[i].sensor == sensor+1) {
+      telemetryHistory[i].sensor = 0;
+    }
+  }
+}
+
+void telemetryHistoryRemoveOwner(const void * owner)
+{
+  for (uint8_t i=0; i<TELEMETRY_HISTORY_SLOTS; i++) {
+    if (telemetryHistory[i].owner == owner) {
+      telemetryHistory[i].sensor = 0;
+    }
+  }
+}
+
+void telemetryHistoryClear()
+{
+  for (uint8_t i=0; i<TELEMETRY_HISTORY_SLOTS; i++) {
+    telemetryHistory[i].clear();
+  }
+  telemetryHistoryTicks = 0;
+}
+
+void telemetryHistoryReset()
+{
+  for (uint8_t i=0; i<TELEMETRY_HISTORY_SLOTS; i++) {
+    telemetryHistory[i].sensor = 0;
+  }
+  telemetryHistoryClear();
+}
+
+void telemetryHistoryInterrupt10ms()
+{
+  if (++telemetryHistoryTicks < 100) {
+    return;
+  }
+  telemetryHistoryTicks = 0;
+
+  for (uint8_t i=0; i<TELEMETRY_HISTORY_SLOTS; i++) {
+    TelemetryHistory & history = telemetryHistory[i];
+    if (history.sensor) {
+      TelemetryItem & item = telemetryItems[history.sensor-1];
+      if (TELEMETRY_STREAMING() && item.isAvailable() && !item.isOld())
+        history.push(item.value);
+      else
+        history.push(TELEMETRY_HISTORY_NO_VALUE);
+    }
+  }
+}
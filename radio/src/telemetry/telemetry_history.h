@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _TELEMETRY_HISTORY_H_
+#define _TELEMETRY_HISTORY_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#if defined(PCBHORUS)
+  #define TELEMETRY_HISTORY_SLOTS      8
+#else
+  #define TELEMETRY_HISTORY_SLOTS      4
+#endif
+#define TELEMETRY_HISTORY_LENGTH       60         // samples kept at each resolution
+#define TELEMETRY_HISTORY_NO_VALUE     INT32_MIN  // the sensor was not received during the sample period
+
+enum TelemetryHistoryResolution {
+  TELEMETRY_HISTORY_1S,
+  TELEMETRY_HISTORY_10S,
+  TELEMETRY_HISTORY_1MIN,
+  TELEMETRY_HISTORY_RESOLUTIONS
+};
+
+class TelemetryHistoryRing {
+  public:
+    int32_t values[TELEMETRY_HISTORY_LENGTH];
+    uint8_t head;       // next write position
+    uint8_t count;
+
+    void clear()
+    {
+      head = 0;
+      count = 0;
+    }
+
+    void push(int32_t value)
+    {
+      values[head] = value;
+      head = (head + 1) % TELEMETRY_HISTORY_LENGTH;
+      if (count < TELEMETRY_HISTORY_LENGTH) {
+        count++;
+      }
+    }
+
+    // index 0 is the oldest sample
+    int32_t get(uint8_t index) const
+    {
+      return values[(head + TELEMETRY_HISTORY_LENGTH - count + index) % TELEMETRY_HISTORY_LENGTH];
+    }
+
+    // returns false when the ring has no value
+    bool getRange(int32_t & min, int32_t & max) const;
+};
+
+// the samples of the coarser resolutions are the average of the finer ones
+class TelemetryHistoryAccumulator {
+  public:
+    int64_t sum;
+    uint8_t values;     // samples with a value
+    uint8_t samples;
+
+    void clear()
+    {
+      sum = 0;
+      values = 0;
+      samples = 0;
+    }
+};
+
+class TelemetryHistory {
+  public:
+    uint8_t sensor;     // sensor index + 1, 0 when the slot is free
+    const void * owner; // the Lua script which added the slot, it is freed with the script
+    TelemetryHistoryRing rings[TELEMETRY_HISTORY_RESOLUTIONS];
+    TelemetryHistoryAccumulator accumulators[TELEMETRY_HISTORY_RESOLUTIONS-1];
+
+    void clear();
+    void push(int32_t value);
+};
+
+extern TelemetryHistory telemetryHistory[TELEMETRY_HISTORY_SLOTS];
+
+// the history is sampled every second in the 10ms interrupt, the GUI and the
+// Lua scripts read the rings in place without locking: a sample pushed while
+// a curve is drawn may shift it by one sample until the next refresh
+int telemetryHistoryAdd(uint8_t sensor, const void * owner=NULL);
+void telemetryHistoryRemove(uint8_t slot);
+void telemetryHistoryRemoveSensor(uint8_t sensor);
+void telemetryHistoryRemoveOwner(const void * owner);
+void telemetryHistoryClear();
+void telemetryHistoryReset();
+void telemetryHistoryInterrupt10ms();
+
+inline const TelemetryHistoryRing * getTelemetryHistory(uint8_t slot, uint8_t resolution)
+{
+  if (slot >= TELEMETRY_HISTORY_SLOTS || resolution >= TELEMETRY_HISTORY_RESOLUTIONS || !telemetryHistory[slot].sensor)
+    return NULL;
+  return &telemetryHistory[slot].rings[resolution];
+}
+
+#endif // _TELEMETRY_HISTORY_H_
@@ -23,6 +23,51 @@
 TelemetryItem telemetryItems[MAX_TELEMETRY_SENSORS];
 uint8_t allowNewSensors;
 
+// Custom sensors indexed by (id, subId). The instance is checked while walking
+// a bucket, as it has to be ignored when g_model.ignoreSensorIds is set. The
+// index is only built and used by the telemetry (mixer) task, the Lua scripts
+// look for their sensors with a linear scan
+#define TELEMETRY_INDEX_HASH_BITS      6
+#define TELEMETRY_INDEX_HASH_SIZE      (1 << TELEMETRY_INDEX_HASH_BITS)
+#define TELEMETRY_INDEX_NONE           0xFF
+
+uint8_t telemetryIndexFirst[TELEMETRY_INDEX_HASH_SIZE];
+uint8_t telemetryIndexNext[MAX_TELEMETRY_SENSORS];
+uint32_t telemetryIndexVersion;
+volatile uint32_t telemetrySensorsVersion = 1;
+
+#define IS_TELEMETRY_INDEX_VALID() (telemetryIndexVersion == telemetrySensorsVersion)
+
+void telemetrySensorsInvalidate()
+{
+  telemetrySensorsVersion++;
+}
+
+inline uint8_t getTelemetryIndexHash(uint16_t id, uint8_t subId)
+{
+  return (uint32_t(id ^ (subId << 11)) * 2654435761u) >> (32 - TELEMETRY_INDEX_HASH_BITS);
+}
+
+void telemetryIndexBuild()
+{
+  uint32_t version = telemetrySensorsVersion;
+
+  memset(telemetryIndexFirst, TELEMETRY_INDEX_NONE, sizeof(telemetryIndexFirst));
+
+  // backwards, so that each bucket is walked in the sensors order
+  for (int index=MAX_TELEMETRY_SENSORS-1; index>=0; index--) {
+    TelemetrySensor & telemetrySensor = g_model.telemetrySensors[index];
+    if (telemetrySensor.type == TELEM_TYPE_CUSTOM) {
+      uint8_t hash = getTelemetryIndexHash(telemetrySensor.id, telemetrySensor.subId);
+      telemetryIndexNext[index] = telemetryIndexFirst[hash];
+      telemetryIndexFirst[hash] = index;
+    }
+  }
+
+  // a change during the build will trigger a new one
+  telemetryIndexVersion = version;
+}
+
 // TODO in maths
 uint32_t getDistFromEarthAxis(int32_t latitude)
 {
@@ -34,6 +79,8 @@ uint32_t getDistFromEarthAxis(int32_t latitude)
 
 void TelemetryItem::setValue(const TelemetrySensor & sensor, int32_t val, uint32_t unit, uint32_t prec)
 {
+  // updated is set last, once the value and its timestamp are written, as the calculated sensors may be
+  // evaluated by another task. Even partial values (cells, GPS, date) are read by the calculated sensors
   int32_t newVal = val;
 
   if (unit == UNIT_CELLS) {
@@ -63,6 +110,7 @@ void TelemetryItem::setValue(const TelemetrySensor & sensor, int32_t val, uint32
         }
         else {
           // we didn't receive all cells values
+          updated = 1;
           return;
         }
       }
@@ -70,6 +118,7 @@ void TelemetryItem::setValue(const TelemetrySensor & sensor, int32_t val, uint32
     }
     else {
       // we didn't receive all cells values
+      updated = 1;
       return;
     }
   }
@@ -99,6 +148,7 @@ void TelemetryItem::setValue(const TelemetrySensor & sensor, int32_t val, uint32
     }
     gps.latitude = newVal;
     lastReceived = now();
+    updated = 1;
     return;
   }
   else if (unit == UNIT_GPS_LONGITUDE) {
@@ -107,22 +157,26 @@ void TelemetryItem::setValue(const TelemetrySensor & sensor, int32_t val, uint32
     }
     gps.longitude = newVal;
     lastReceived = now();
+    updated = 1;
     return;
   }
   else if (unit == UNIT_DATETIME_YEAR) {
     datetime.year = newVal;
+    updated = 1;
     return;
   }
   else if (unit == UNIT_DATETIME_DAY_MONTH) {
     uint32_t data = uint32_t(newVal);
     datetime.month = data >> 8;
     datetime.day = data & 0xFF;
+    updated = 1;
     return;
   }
   else if (unit == UNIT_DATETIME_HOUR_MIN) {
     uint32_t data = uint32_t(newVal);
     datetime.hour = (data & 0xFF);
     datetime.min = data >> 8;
+    updated = 1;
     return;
   }
   else if (unit == UNIT_DATETIME_SEC) {
@@ -137,6 +191,7 @@ void TelemetryItem::setValue(const TelemetrySensor & sensor, int32_t val, uint32
   else if (unit == UNIT_TEXT) {
     *((uint32_t*)&text[prec]) = newVal;
     lastReceived = now();
+    updated = 1;
     return;
   }
   else {
@@ -196,6 +251,7 @@ void TelemetryItem::setValue(const TelemetrySensor & sensor, int32_t val, uint32
 
   value = newVal;
   lastReceived = now();
+  updated = 1;
 }
 
 void TelemetryItem::per10ms(const TelemetrySensor & sensor)
@@ -390,10 +446,137 @@ void TelemetryItem::eval(const TelemetrySensor & sensor)
   }
 }
 
+#if MAX_TELEMETRY_SENSORS > 32
+  #error "The calculated sensors sources are stored in 32 bits masks"
+#endif
+
+// Calculated sensors evaluated by eval(), sorted so that sources come first
+uint8_t telemetryCalcOrder[MAX_TELEMETRY_SENSORS];
+uint8_t telemetryCalcCount;
+uint32_t telemetryCalcSources[MAX_TELEMETRY_SENSORS];
+uint32_t telemetryCalcVersion;
+
+#if defined(GTESTS)
+  // tests modify g_model directly, the graph is rebuilt when the sensors differ
+  TelemetrySensor telemetryCalcSensors[MAX_TELEMETRY_SENSORS];
+  #define IS_TELEMETRY_CALC_VALID() (!memcmp(telemetryCalcSensors, g_model.telemetrySensors, sizeof(telemetryCalcSensors)))
+#else
+  #define IS_TELEMETRY_CALC_VALID() (telemetryCalcVersion == telemetrySensorsVersion)
+#endif
+
+inline uint32_t getTelemetrySourceMask(int source)
+{
+  unsigned int index = abs(source) - 1;
+  return (index < MAX_TELEMETRY_SENSORS ? (uint32_t)1 << index : 0);
+}
+
+uint32_t getTelemetryCalcSources(const TelemetrySensor & sensor)
+{
+  switch (sensor.formula) {
+    case TELEM_FORMULA_CELL:
+      return getTelemetrySourceMask(sensor.cell.source);
+
+    case TELEM_FORMULA_DIST:
+      return getTelemetrySourceMask(sensor.dist.gps) | getTelemetrySourceMask(sensor.dist.alt);
+
+    case TELEM_FORMULA_ADD:
+    case TELEM_FORMULA_AVERAGE:
+    case TELEM_FORMULA_MIN:
+    case TELEM_FORMULA_MAX:
+      return getTelemetrySourceMask(sensor.calc.sources[0]) | getTelemetrySourceMask(sensor.calc.sources[1]) |
+             getTelemetrySourceMask(sensor.calc.sources[2]) | getTelemetrySourceMask(sensor.calc.sources[3]);
+
+    case TELEM_FORMULA_MULTIPLY:
+      return getTelemetrySourceMask(sensor.calc.sources[0]) | getTelemetrySourceMask(sensor.calc.sources[1]);
+
+    default:
+      // totalize is done in setValue(), consumption in per10ms()
+      return 0;
+  }
+}
+
+void telemetryCalcBuild()
+{
+  uint32_t version = telemetrySensorsVersion;
+  uint32_t remaining = 0;
+
+  for (int index=0; index<MAX_TELEMETRY_SENSORS; index++) {
+    TelemetrySensor & telemetrySensor = g_model.telemetrySensors[index];
+    telemetryCalcSources[index] = 0;
+    if (telemetrySensor.type == TELEM_TYPE_CALCULATED) {
+      telemetryCalcSources[index] = getTelemetryCalcSources(telemetrySensor);
+      if (telemetryCalcSources[index]) {
+        remaining |= (uint32_t)1 << index;
+      }
+    }
+  }
+
+  // a sensor is added once all its calculated sources are
+  telemetryCalcCount = 0;
+  while (remaining) {
+    uint32_t added = 0;
+    for (int index=0; index<MAX_TELEMETRY_SENSORS; index++) {
+      uint32_t mask = (uint32_t)1 << index;
+      if ((remaining & mask) && !(telemetryCalcSources[index] & remaining & ~mask)) {
+        telemetryCalcOrder[telemetryCalcCount++] = index;
+        added |= mask;
+      }
+    }
+    if (!added) {
+      // sources loop, the remaining sensors are evaluated in the sensors order
+      for (int index=0; index<MAX_TELEMETRY_SENSORS; index++) {
+        if (remaining & ((uint32_t)1 << index)) {
+          telemetryCalcOrder[telemetryCalcCount++] = index;
+        }
+      }
+      break;
+    }
+    remaining &= ~added;
+  }
+
+#if defined(GTESTS)
+  memcpy(telemetryCalcSensors, g_model.telemetrySensors, sizeof(telemetryCalcSensors));
+#endif
+
+  telemetryCalcVersion = version;
+}
+
+void evalTelemetryCalculatedSensors()
+{
+  uint32_t updated = 0;
+
+  if (!IS_TELEMETRY_CALC_VALID()) {
+    telemetryCalcBuild();
+    // the formulas or the sources may have changed
+    updated = (uint32_t)-1;
+  }
+
+  // the flags are set by setValue() / setOld(), which may run in the Lua task
+  for (int index=0; index<MAX_TELEMETRY_SENSORS; index++) {
+    TelemetryItem & telemetryItem = telemetryItems[index];
+    if (telemetryItem.updated) {
+      telemetryItem.updated = 0;
+      updated |= (uint32_t)1 << index;
+    }
+  }
+
+  for (int i=0; i<telemetryCalcCount; i++) {
+    uint8_t index = telemetryCalcOrder[i];
+    if (telemetryCalcSources[index] & updated) {
+      TelemetryItem & telemetryItem = telemetryItems[index];
+      telemetryItem.eval(g_model.telemetrySensors[index]);
+      // eval() may also have set it old without calling setValue()
+      telemetryItem.updated = 0;
+      updated |= (uint32_t)1 << index;
+    }
+  }
+}
+
 void delTelemetryIndex(uint8_t index)
 {
   memclear(&g_model.telemetrySensors[index], sizeof(TelemetrySensor));
   telemetryItems[index].clear();
+  telemetryHistoryRemoveSensor(index);
   storageDirty(EE_MODEL);
 }
 
@@ -419,16 +602,36 @@ int lastUsedTelemetryIndex()
   return -1;
 }
 
+inline bool isTelemetrySensorMatching(const TelemetrySensor & telemetrySensor, uint16_t id, uint8_t subId, uint8_t instance)
+{
+  return telemetrySensor.type == TELEM_TYPE_CUSTOM && telemetrySensor.id == id && telemetrySensor.subId == subId && (telemetrySensor.instance == instance || g_model.ignoreSensorIds);
+}
+
 int setTelemetryValue(TelemetryProtocol protocol, uint16_t id, uint8_t subId, uint8_t instance, int32_t value, uint32_t unit, uint32_t prec)
 {
   bool available = false;
 
-  for (int index=0; index<MAX_TELEMETRY_SENSORS; index++) {
-    TelemetrySensor & telemetrySensor = g_model.telemetrySensors[index];
-    if (telemetrySensor.type == TELEM_TYPE_CUSTOM && telemetrySensor.id == id && telemetrySensor.subId == subId && (telemetrySensor.instance == instance || g_model.ignoreSensorIds)) {
-      telemetryItems[index].setValue(telemetrySensor, value, unit, prec);
-      available = true;
-      // we continue search here, because sensors can share the same id and instance
+  // we continue search after a match, because sensors can share the same id and instance
+  if (protocol == TELEM_PROTO_LUA) {
+    // called by the Lua scripts in the menus task
+    for (uint8_t index=0; index<MAX_TELEMETRY_SENSORS; index++) {
+      TelemetrySensor & telemetrySensor = g_model.telemetrySensors[index];
+      if (isTelemetrySensorMatching(telemetrySensor, id, subId, instance)) {
+        telemetryItems[index].setValue(telemetrySensor, value, unit, prec);
+        available = true;
+      }
+    }
+  }
+  else {
+    if (!IS_TELEMETRY_INDEX_VALID()) {
+      telemetryIndexBuild();
+    }
+    for (uint8_t index=telemetryIndexFirst[getTelemetryIndexHash(id, subId)]; index!=TELEMETRY_INDEX_NONE; index=telemetryIndexNext[index]) {
+      TelemetrySensor & telemetrySensor = g_model.telemetrySensors[index];
+      if (isTelemetrySensorMatching(telemetrySensor, id, subId, instance)) {
+        telemetryItems[index].setValue(telemetrySensor, value, unit, prec);
+        available = true;
+      }
     }
   }
 
@@ -438,6 +641,8 @@ int setTelemetryValue(TelemetryProtocol protocol, uint16_t id, uint8_t subId, ui
 
   int index = availableTelemetryIndex();
   if (index >= 0) {
+    // the Lua sensors are initialized by the caller, the index is rebuilt lazily
+    telemetrySensorsInvalidate();
     switch (protocol) {
 #if defined(TELEMETRY_FRSKY_SPORT)
       case TELEM_PROTO_FRSKY_SPORT:
@@ -48,6 +48,8 @@ class TelemetryItem
 
     uint8_t lastReceived;       // for detection of sensor loss
 
+    uint8_t updated;            // new value or lost, the calculated sensors using it will be evaluated
+
     union {
       struct {
         int32_t  offsetAuto;
@@ -129,6 +131,7 @@ class TelemetryItem
     inline void setOld()
     {
       lastReceived = TELEMETRY_VALUE_OLD;
+      updated = 1;
     }
 
     void gpsReceived(); // TODO seems not used
@@ -137,4 +140,12 @@ class TelemetryItem
 extern TelemetryItem telemetryItems[MAX_TELEMETRY_SENSORS];
 extern uint8_t allowNewSensors;
 
+extern volatile uint32_t telemetrySensorsVersion;
+
+// to be called when sensors are added, deleted or their id / subId / instance / type is modified
+void telemetrySensorsInvalidate();
+
+// evaluates the calculated sensors whose sources received a value since the last call
+void evalTelemetryCalculatedSensors();
+
 #endif // _TELEMETRY_SENSORS_H_
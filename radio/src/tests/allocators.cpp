@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x 
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "gtests.h"
+#include "bin_allocator.h"
+
+TEST(BinAllocator, mallocFree)
+{
+  BinAllocator<16, 4> allocator;
+  void * bins[4];
+
+  for (int i=0; i<4; i++) {
+    bins[i] = allocator.malloc(16);
+    EXPECT_NE(bins[i], (void *)NULL);
+    EXPECT_TRUE(allocator.is_member(bins[i]));
+  }
+  EXPECT_EQ(allocator.size(), 4u);
+  EXPECT_EQ(allocator.malloc(1), (void *)NULL);
+  EXPECT_EQ(allocator.malloc(17), (void *)NULL);
+  EXPECT_EQ(allocator.stats().failures, 1u);
+
+  EXPECT_TRUE(allocator.free(bins[2]));
+  EXPECT_FALSE(allocator.free(bins[2]));
+  EXPECT_FALSE(allocator.free((char *)bins[1] + 1));
+  EXPECT_TRUE(allocator.free(bins[0]));
+  EXPECT_EQ(allocator.size(), 2u);
+
+  // the last freed bins are reused first
+  EXPECT_EQ(allocator.malloc(8), bins[0]);
+  EXPECT_EQ(allocator.malloc(8), bins[2]);
+  EXPECT_EQ(allocator.malloc(8), (void *)NULL);
+
+  const BinAllocatorStats & stats = allocator.stats();
+  EXPECT_EQ(stats.used, 4u);
+  EXPECT_EQ(stats.maxUsed, 4u);
+  EXPECT_EQ(stats.failures, 2u);
+}
+
+#if defined(USE_BIN_ALLOCATOR)
+TEST(SlabAllocator, sizeClasses)
+{
+  SlabAllocator allocator;
+
+  void * a = allocator.malloc(1);
+  void * b = allocator.malloc(16);
+  void * c = allocator.malloc(17);
+  void * d = allocator.malloc(SLAB_MAX_SIZE);
+  void * e = allocator.malloc(SLAB_MAX_SIZE + 1);
+  EXPECT_TRUE(allocator.is_member(a));
+  EXPECT_TRUE(allocator.is_member(d));
+  EXPECT_FALSE(allocator.is_member(e));
+  EXPECT_EQ(allocator.block_size(a), 16u);
+  EXPECT_EQ(allocator.block_size(b), 16u);
+  EXPECT_EQ(allocator.block_size(c), 32u);
+  EXPECT_EQ(allocator.block_size(d), (size_t)SLAB_MAX_SIZE);
+  EXPECT_EQ((char *)b - (char *)a, 16);
+
+  const SlabAllocatorStats & stats = allocator.stats();
+  EXPECT_EQ(stats.freePages, SLAB_PAGES - 3);
+  EXPECT_EQ(stats.classes[0].blocks, 2u);
+  EXPECT_EQ(stats.classes[0].requested, 17u);
+  EXPECT_EQ(stats.heapBytes, (uint32_t)SLAB_MAX_SIZE + 1);
+
+  allocator.free(a, 1);
+  allocator.free(b, 16);
+  allocator.free(c, 17);
+  allocator.free(d, SLAB_MAX_SIZE);
+  allocator.free(e, SLAB_MAX_SIZE + 1);
+  EXPECT_EQ(stats.freePages, SLAB_PAGES);
+  EXPECT_EQ(stats.classes[0].requested, 0u);
+  EXPECT_EQ(stats.heapBytes, 0u);
+  EXPECT_EQ(allocator.fragmentation(), 0u);
+}
+
+TEST(SlabAllocator, realloc)
+{
+  SlabAllocator allocator;
+
+  char * p = (char *)allocator.realloc(NULL, 0, 10);
+  strcpy(p, "OpenTX");
+  // same size class, the block doesn't move
+  EXPECT_EQ(allocator.realloc(p, 10, 12), p);
+  // bigger class
+  char * q = (char *)allocator.realloc(p, 12, 100);
+  EXPECT_NE(q, p);
+  EXPECT_EQ(allocator.block_size(q), 128u);
+  EXPECT_STREQ(q, "OpenTX");
+  // to the heap and back
+  p = (char *)allocator.realloc(q, 100, 1000);
+  EXPECT_FALSE(allocator.is_member(p));
+  EXPECT_STREQ(p, "OpenTX");
+  q = (char *)allocator.realloc(p, 1000, 20);
+  EXPECT_TRUE(allocator.is_member(q));
+  EXPECT_STREQ(q, "OpenTX");
+  EXPECT_EQ(allocator.stats().heapBytes, 0u);
+  EXPECT_EQ(allocator.stats().classes[1].requested, 20u);
+  allocator.free(q, 20);
+}
+
+TEST(SlabAllocator, pagesReuse)
+{
+  SlabAllocator allocator;
+  const int count = SLAB_PAGE_SIZE / 16 * 2;
+  void * blocks[count];
+
+  for (int i=0; i<count; i++) {
+    blocks[i] = allocator.malloc(16);
+  }
+  EXPECT_EQ(allocator.stats().classes[0].pages, 2u);
+  EXPECT_EQ(allocator.fragmentation(), 0u);
+
+  // every other block freed, half of the pages is lost
+  for (int i=0; i<count; i+=2) {
+    allocator.free(blocks[i], 16);
+  }
+  EXPECT_EQ(allocator.stats().classes[0].pages, 2u);
+  EXPECT_EQ(allocator.fragmentation(), 50u);
+
+  // the freed blocks are reused before a new page is taken
+  for (int i=0; i<count; i+=2) {
+    blocks[i] = allocator.malloc(16);
+  }
+  EXPECT_EQ(allocator.stats().classes[0].pages, 2u);
+
+  // empty pages may be reused by another class
+  for (int i=0; i<count; i++) {
+    allocator.free(blocks[i], 16);
+  }
+  EXPECT_EQ(allocator.stats().classes[0].pages, 0u);
+  EXPECT_EQ(allocator.stats().freePages, SLAB_PAGES);
+  for (int i=0; i<SLAB_PAGES * (SLAB_PAGE_SIZE / SLAB_MAX_SIZE); i++) {
+    EXPECT_TRUE(allocator.is_member(allocator.malloc(SLAB_MAX_SIZE)));
+  }
+  EXPECT_EQ(allocator.stats().freePages, 0u);
+
+  // all the pages are used, the block goes to the heap
+  void * p = allocator.malloc(16);
+  EXPECT_FALSE(allocator.is_member(p));
+  EXPECT_EQ(allocator.stats().failures, 1u);
+  allocator.free(p, 16);
+}
+
+TEST(SlabAllocator, release)
+{
+  SlabAllocator allocator;
+
+  void * p = allocator.malloc(16);
+  EXPECT_TRUE(allocator.is_member(p));
+
+  // a block is still allocated, the arena is kept
+  allocator.release();
+  EXPECT_TRUE(allocator.is_member(p));
+  EXPECT_EQ(allocator.stats().pages, SLAB_PAGES);
+
+  allocator.free(p, 16);
+  allocator.release();
+  EXPECT_FALSE(allocator.is_member(p));
+  EXPECT_EQ(allocator.stats().pages, 0);
+
+  // allocated again at the next small block
+  p = allocator.malloc(16);
+  EXPECT_TRUE(allocator.is_member(p));
+  EXPECT_EQ(allocator.stats().freePages, SLAB_PAGES - 1);
+  allocator.free(p, 16);
+}
+#endif
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Common code of the host-side tools, which run the SIMU firmware core
+ * without any GUI
+ */
+
+#include "bench_simu.h"
+
+uint16_t anaInValues[NUM_STICKS+NUM_POTS+NUM_SLIDERS] = { 0 };
+
+uint16_t anaIn(uint8_t chan)
+{
+  if (chan < NUM_STICKS+NUM_POTS+NUM_SLIDERS)
+    return anaInValues[chan];
+  else
+    return 0;
+}
+
+uint16_t getAnalogValue(uint8_t index)
+{
+  return anaIn(index);
+}
+
+const char * benchLoadModel(int argc, char ** argv)
+{
+#if defined(EEPROM)
+  if (argc < 1) {
+    return "eeprom filename missing";
+  }
+  StartEepromThread(argv[0]);
+  if (!eepromOpen() || !eeLoadGeneral()) {
+    return "bad eeprom image";
+  }
+  uint8_t index = (argc > 1 ? atoi(argv[1]) : g_eeGeneral.currModel);
+  if (index >= MAX_MODELS || eeLoadModelData(index) < EEPROM_MIN_MODEL_SIZE) {
+    return "model not found";
+  }
+#else
+  if (argc < 2) {
+    return "model filename missing";
+  }
+  simuFatfsSetPaths(argv[0], argv[0]);
+  generalDefault();
+#if defined(PCBHORUS)
+  // created by opentxInit() on the radio, the custom screens of the model are loaded into it
+  topbar = new Topbar(&g_model.topbarData);
+#endif
+  const char * error = readModel(argv[1], (uint8_t *)&g_model, sizeof(g_model));
+  if (error) {
+    return error;
+  }
+#endif
+  postModelLoad(false);
+  return NULL;
+}
+
+void benchUnloadModel()
+{
+#if defined(EEPROM)
+  StopEepromThread();
+#endif
+}
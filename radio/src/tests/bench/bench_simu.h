@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _BENCH_SIMU_H_
+#define _BENCH_SIMU_H_
+
+#include "opentx.h"
+
+// the analog inputs seen by the SIMU firmware core, centered values (-1024..1024)
+extern uint16_t anaInValues[NUM_STICKS+NUM_POTS+NUM_SLIDERS];
+
+// loads the model given on the command line, returns an error string or NULL
+// EEPROM targets: <eeprom.bin> [model index]
+// SD card targets: <settings directory> <model.bin>
+const char * benchLoadModel(int argc, char ** argv);
+void benchUnloadModel();
+
+#if defined(EEPROM)
+  #define BENCH_MODEL_USAGE            "<eeprom.bin> [model index]"
+#else
+  #define BENCH_MODEL_USAGE            "<settings directory> <model.bin>"
+#endif
+
+#endif // _BENCH_SIMU_H_
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Host-side mixer benchmark
+ *
+ * Loads a real model, then runs doMixerCalculations() in a tight loop with
+ * moving sticks. The per-stage durations are taken from the DEBUG_TIMERS
+ * instrumentation of the firmware (the same stages the CLI shows on a radio),
+ * which uses the host steady clock in SIMU, and accumulated into latency
+ * histograms. With -j, the fading flight modes
+ * are evaluated by several threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include "bench_simu.h"
+
+#if !defined(DEBUG_TIMERS) || !defined(MIXER_THREADS)
+  #error "mixer-bench needs DEBUG_TIMERS and MIXER_THREADS"
+#endif
+
+#define BENCH_DEFAULT_ITERATIONS       100000
+#define BENCH_DEFAULT_RUNS_PER_TICK    5        // the mixer runs every 2ms on the radio
+#define BENCH_HISTOGRAM_SIZE           10000    // 1us buckets, up to 10ms
+
+class LatencyHistogram
+{
+  public:
+    LatencyHistogram():
+      count(0),
+      max(0)
+    {
+      memset(buckets, 0, sizeof(buckets));
+    }
+
+    void add(uint32_t value)
+    {
+      buckets[value < BENCH_HISTOGRAM_SIZE ? value : BENCH_HISTOGRAM_SIZE] += 1;
+      if (value > max)
+        max = value;
+      count += 1;
+    }
+
+    uint32_t getPercentile(unsigned int percent) const
+    {
+      uint64_t threshold = ((uint64_t)count * percent + 99) / 100;
+      uint64_t sum = 0;
+      for (uint32_t i=0; i<BENCH_HISTOGRAM_SIZE; i++) {
+        sum += buckets[i];
+        if (sum >= threshold)
+          return i;
+      }
+      return max;
+    }
+
+    uint32_t getMax() const
+    {
+      return max;
+    }
+
+    uint32_t getCount() const
+    {
+      return count;
+    }
+
+    uint32_t getCountAbove(uint32_t value) const
+    {
+      uint32_t result = 0;
+      for (uint32_t i=value+1; i<=BENCH_HISTOGRAM_SIZE; i++) {
+        result += buckets[i];
+      }
+      return result;
+    }
+
+  protected:
+    uint32_t buckets[BENCH_HISTOGRAM_SIZE + 1];
+    uint32_t count;
+    uint32_t max;
+};
+
+struct BenchStage
+{
+  const char * name;
+  uint8_t timer;
+  bool tick10msOnly;
+  LatencyHistogram histogram;
+};
+
+BenchStage benchStages[] = {
+  { "getADC",              debugTimerGetAdc,          false },
+  { "getSwitchesPosition", debugTimerGetSwitches,     false },
+  { "evalFlightModeMixes", debugTimerFlightModeMixes, false },
+  { "evalFunctions",       debugTimerFunctions,       true  },
+  { "applyLimits",         debugTimerLimits,          false },
+  { "evalMixes",           debugTimerEvalMixes,       false },
+};
+
+LatencyHistogram benchTotal;
+
+void benchMoveSticks(uint32_t iteration)
+{
+  // slow sine sweeps with a different period on each analog, the SIMU core takes centered values
+  for (int i=0; i<NUM_STICKS+NUM_POTS+NUM_SLIDERS; i++) {
+    double phase = (2 * M_PI * iteration) / (500 + 37 * i);
+    anaInValues[i] = (int16_t)(RESX * sin(phase));
+  }
+}
+
+void benchUsage()
+{
+  fprintf(stderr, "usage: mixer-bench [-n iterations] [-t runs per 10ms tick] [-j threads] " BENCH_MODEL_USAGE "\n");
+}
+
+void benchPrintHistogram(const char * name, const LatencyHistogram & histogram)
+{
+  printf("%-22s %10u %8uus %8uus %8uus\n", name, histogram.getCount(), histogram.getPercentile(50), histogram.getPercentile(99), histogram.getMax());
+}
+
+int main(int argc, char ** argv)
+{
+  uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+  uint32_t runsPerTick = BENCH_DEFAULT_RUNS_PER_TICK;
+  uint32_t threads = 1;
+
+  int arg = 1;
+  for (; arg < argc && argv[arg][0] == '-'; arg++) {
+    if (!strcmp(argv[arg], "-n") && arg+1 < argc) {
+      iterations = atoi(argv[++arg]);
+    }
+    else if (!strcmp(argv[arg], "-t") && arg+1 < argc) {
+      runsPerTick = max<uint32_t>(1, atoi(argv[++arg]));
+    }
+    else if (!strcmp(argv[arg], "-j") && arg+1 < argc) {
+      threads = max<uint32_t>(1, atoi(argv[++arg]));
+    }
+    else {
+      benchUsage();
+      return 1;
+    }
+  }
+
+  if (arg >= argc) {
+    benchUsage();
+    return 1;
+  }
+
+  simuInit();
+  sourceRangesInit();
+  g_tmr10ms = 1;
+
+  const char * error = benchLoadModel(argc-arg, &argv[arg]);
+  if (error) {
+    fprintf(stderr, "mixer-bench: %s\n", error);
+    return 1;
+  }
+
+  mixerThreadsStart(threads);
+
+  printf("%u iterations, %u mixer runs per 10ms tick, %u mixer threads\n", iterations, runsPerTick, threads);
+
+  for (uint32_t i=0; i<iterations; i++) {
+    bool tick10ms = (i % runsPerTick) == 0;
+    if (tick10ms) {
+      g_tmr10ms++;
+    }
+
+    benchMoveSticks(i);
+
+    for (unsigned int s=0; s<DIM(benchStages); s++) {
+      debugTimers[benchStages[s].timer].reset();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    doMixerCalculations();
+    auto duration = std::chrono::steady_clock::now() - start;
+    benchTotal.add(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+
+    for (unsigned int s=0; s<DIM(benchStages); s++) {
+      BenchStage & stage = benchStages[s];
+      if (tick10ms || !stage.tick10msOnly) {
+        stage.histogram.add(debugTimers[stage.timer].getLast());
+      }
+    }
+  }
+
+  printf("%-22s %10s %10s %10s %10s\n", "stage", "samples", "p50", "p99", "max");
+  for (unsigned int s=0; s<DIM(benchStages); s++) {
+    benchPrintHistogram(benchStages[s].name, benchStages[s].histogram);
+  }
+  benchPrintHistogram("doMixerCalculations", benchTotal);
+
+  printf("%u/%u mixer runs above the 2ms budget\n", benchTotal.getCountAbove(2000), benchTotal.getCount());
+
+  mixerThreadsStop();
+  benchUnloadModel();
+
+  return 0;
+}
@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Offline mixer replay
+ *
+ * Reads a CSV log written by logsWrite(), feeds it row by row into the SIMU
+ * firmware core (sticks, pots, switches and telemetry sensors), runs the
+ * mixer, the logical switches, the special functions and the timers for each
+ * 10ms of logged time, and writes the resulting channelOutputs as a CSV file.
+ * The replay runs as fast as possible, not in real time.
+ *
+ * The logged logical switches are ignored, they are computed again from the
+ * replayed model. GPS, date and cells sensors are not replayed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "bench_simu.h"
+
+#define REPLAY_MAX_LINE                4096
+#define REPLAY_MAX_COLUMNS             256
+#define REPLAY_LABEL_LEN               (TELEM_LABEL_LEN+7)
+
+enum ReplayColumnType {
+  REPLAY_COLUMN_IGNORED,
+  REPLAY_COLUMN_TIME,
+  REPLAY_COLUMN_ANALOG,
+  REPLAY_COLUMN_SWITCH,
+  REPLAY_COLUMN_SENSOR,
+};
+
+struct ReplayColumn {
+  uint8_t type;
+  uint8_t index;
+};
+
+ReplayColumn replayColumns[REPLAY_MAX_COLUMNS];
+unsigned int replayColumnsCount = 0;
+bool replayRtcTime = false;
+int16_t replayAnalogs[NUM_STICKS+NUM_POTS+NUM_SLIDERS];
+
+// same order as the switches in the log header, it is also the simuSetSwitch() numbering
+#if defined(PCBX7)
+const char * const replaySwitchNames[] = { "SA", "SB", "SC", "SD", "SF", "SH" };
+#elif defined(PCBTARANIS) || defined(PCBHORUS)
+const char * const replaySwitchNames[] = { "SA", "SB", "SC", "SD", "SE", "SF", "SG", "SH" };
+#else
+const char * const replaySwitchNames[] = { "THR", "RUD", "ELE", "3POS", "AIL", "GEA", "TRN" };
+#endif
+
+// splits a CSV line in place, returns the number of fields
+unsigned int replaySplitLine(char * line, char ** fields)
+{
+  unsigned int count = 0;
+  char * field = line;
+  while (count < REPLAY_MAX_COLUMNS) {
+    fields[count++] = field;
+    char * end = strpbrk(field, ",\r\n");
+    if (!end || *end != ',') {
+      if (end) *end = '\0';
+      break;
+    }
+    *end = '\0';
+    field = end + 1;
+  }
+  return count;
+}
+
+// the analog labels, as written by writeHeader()
+void replayGetAnalogLabel(uint8_t index, char * label)
+{
+  const char * p = STR_VSRCRAW + (index+1) * STR_VSRCRAW[0] + 2;
+  uint8_t len = 0;
+  for (uint8_t j=0; j<STR_VSRCRAW[0]-1; ++j) {
+    if (!*p) break;
+    label[len++] = *p++;
+  }
+  label[len] = '\0';
+}
+
+// the sensor labels, as written by writeHeader()
+void replayGetSensorLabel(uint8_t index, char * label)
+{
+  TelemetrySensor & sensor = g_model.telemetrySensors[index];
+  memset(label, 0, REPLAY_LABEL_LEN);
+  zchar2str(label, sensor.label, TELEM_LABEL_LEN);
+  uint8_t unit = sensor.unit;
+  if (unit == UNIT_CELLS) unit = UNIT_VOLTS;
+  if (UNIT_RAW < unit && unit < UNIT_FIRST_VIRTUAL) {
+    strcat(label, "(");
+    strncat(label, STR_VTELEMUNIT+1+3*unit, 3);
+    strcat(label, ")");
+  }
+}
+
+bool isSensorReplayable(uint8_t index)
+{
+  uint8_t unit = g_model.telemetrySensors[index].unit;
+  return unit != UNIT_GPS && unit != UNIT_DATETIME && unit != UNIT_CELLS && unit != UNIT_TEXT;
+}
+
+ReplayColumn replayFindColumn(const char * name, unsigned int position)
+{
+  char label[REPLAY_LABEL_LEN];
+
+  if (position == 0 && !strcmp(name, "Date")) {
+    replayRtcTime = true;
+    return { REPLAY_COLUMN_IGNORED, 0 };
+  }
+
+  if (!strcmp(name, "Time")) {
+    return { REPLAY_COLUMN_TIME, 0 };
+  }
+
+  for (uint8_t i=0; i<NUM_STICKS+NUM_POTS+NUM_SLIDERS; i++) {
+    replayGetAnalogLabel(i, label);
+    if (!strcmp(name, label)) {
+      return { REPLAY_COLUMN_ANALOG, i };
+    }
+  }
+
+  for (uint8_t i=0; i<DIM(replaySwitchNames); i++) {
+    if (!strcmp(name, replaySwitchNames[i])) {
+      return { REPLAY_COLUMN_SWITCH, i };
+    }
+  }
+
+  for (uint8_t i=0; i<MAX_TELEMETRY_SENSORS; i++) {
+    if (isTelemetryFieldAvailable(i) && isSensorReplayable(i)) {
+      replayGetSensorLabel(i, label);
+      if (!strcmp(name, label)) {
+        return { REPLAY_COLUMN_SENSOR, i };
+      }
+    }
+  }
+
+  return { REPLAY_COLUMN_IGNORED, 0 };
+}
+
+void replayParseHeader(char * line)
+{
+  char * fields[REPLAY_MAX_COLUMNS];
+  replayColumnsCount = replaySplitLine(line, fields);
+  for (unsigned int i=0; i<replayColumnsCount; i++) {
+    replayColumns[i] = replayFindColumn(fields[i], i);
+  }
+}
+
+// "12.5" with prec=2 gives 1250
+int32_t replayParseDecimal(const char * value, uint8_t prec)
+{
+  bool negative = (*value == '-');
+  if (negative) value++;
+  int32_t result = strtol(value, (char **)&value, 10);
+  for (uint8_t i=0; i<prec; i++) {
+    result *= 10;
+    if (*value == '.' && value[1] >= '0' && value[1] <= '9') {
+      result += *++value - '0';
+    }
+    else {
+      value = "";
+    }
+  }
+  return negative ? -result : result;
+}
+
+// the time of the row, in 10ms
+tmr10ms_t replayParseTime(const char * value)
+{
+  if (replayRtcTime) {
+    // hh:mm:ss.xxx
+    int hour = 0, min = 0;
+    double sec = 0;
+    sscanf(value, "%d:%d:%lf", &hour, &min, &sec);
+    return (hour * 3600 + min * 60) * 100 + (tmr10ms_t)(sec * 100);
+  }
+  else {
+    return strtoul(value, NULL, 10);
+  }
+}
+
+void replaySetSensorValue(uint8_t index, int32_t value)
+{
+  // the logged values are already converted, filtered and offset
+  TelemetryItem & item = telemetryItems[index];
+  if (!item.isAvailable()) {
+    item.valueMin = item.valueMax = value;
+  }
+  else if (value < item.valueMin) {
+    item.valueMin = value;
+  }
+  else if (value > item.valueMax) {
+    item.valueMax = value;
+  }
+  item.value = value;
+  item.lastReceived = TelemetryItem::now();
+}
+
+// applies a row to the inputs of the SIMU core, returns the time of the row
+tmr10ms_t replayParseRow(char * line)
+{
+  char * fields[REPLAY_MAX_COLUMNS];
+  unsigned int count = min(replaySplitLine(line, fields), replayColumnsCount);
+  tmr10ms_t time = 0;
+
+  for (unsigned int i=0; i<count; i++) {
+    const char * value = fields[i];
+    ReplayColumn & column = replayColumns[i];
+    switch (column.type) {
+      case REPLAY_COLUMN_TIME:
+        time = replayParseTime(value);
+        break;
+      case REPLAY_COLUMN_ANALOG:
+        replayAnalogs[column.index] = atoi(value);
+        break;
+      case REPLAY_COLUMN_SWITCH:
+        simuSetSwitch(column.index, atoi(value));
+        break;
+      case REPLAY_COLUMN_SENSOR:
+        if (*value) {
+          replaySetSensorValue(column.index, replayParseDecimal(value, g_model.telemetrySensors[column.index].prec));
+          telemetryStreaming = TELEMETRY_TIMEOUT10ms;
+        }
+        break;
+    }
+  }
+
+  // the log contains calibratedAnalogs[], evalInputs() transformations are reverted
+  for (uint8_t i=0; i<NUM_STICKS+NUM_POTS+NUM_SLIDERS; i++) {
+    uint8_t ch = (i < NUM_STICKS ? CONVERT_MODE(i) : i);
+    int16_t v = replayAnalogs[ch];
+#if defined(PCBTARANIS) && !defined(PCBX7)
+    if (i==POT1 || i==SLIDER1) {
+      v = -v;
+    }
+#endif
+    if (g_model.throttleReversed && ch==THR_STICK) {
+      v = -v;
+    }
+    anaInValues[i] = v;
+  }
+
+  return time;
+}
+
+void replayWriteHeader(FILE * output, uint8_t channels)
+{
+  fputs("Time", output);
+  for (uint8_t i=0; i<channels; i++) {
+    fprintf(output, ",CH%d", i+1);
+  }
+  fputs("\n", output);
+}
+
+void replayWriteRow(FILE * output, tmr10ms_t time, uint8_t channels)
+{
+  fprintf(output, "%u", time);
+  for (uint8_t i=0; i<channels; i++) {
+    fprintf(output, ",%d", channelOutputs[i]);
+  }
+  fputs("\n", output);
+}
+
+void replayUsage()
+{
+  fprintf(stderr, "usage: mixer-replay [-o outputs.csv] [-c channels] [-j threads] <log.csv> " BENCH_MODEL_USAGE "\n");
+}
+
+int main(int argc, char ** argv)
+{
+  const char * outputFilename = NULL;
+  uint32_t channels = MAX_OUTPUT_CHANNELS;
+  uint32_t threads = 1;
+
+  int arg = 1;
+  for (; arg < argc && argv[arg][0] == '-'; arg++) {
+    if (!strcmp(argv[arg], "-o") && arg+1 < argc) {
+      outputFilename = argv[++arg];
+    }
+    else if (!strcmp(argv[arg], "-c") && arg+1 < argc) {
+      channels = limit<uint32_t>(1, atoi(argv[++arg]), MAX_OUTPUT_CHANNELS);
+    }
+    else if (!strcmp(argv[arg], "-j") && arg+1 < argc) {
+      threads = max<uint32_t>(1, atoi(argv[++arg]));
+    }
+    else {
+      replayUsage();
+      return 1;
+    }
+  }
+
+  if (arg + 1 >= argc) {
+    replayUsage();
+    return 1;
+  }
+
+  FILE * log = fopen(argv[arg], "r");
+  if (!log) {
+    fprintf(stderr, "mixer-replay: cannot open %s\n", argv[arg]);
+    return 1;
+  }
+
+  FILE * output = stdout;
+  if (outputFilename) {
+    output = fopen(outputFilename, "w");
+    if (!output) {
+      fprintf(stderr, "mixer-replay: cannot create %s\n", outputFilename);
+      return 1;
+    }
+  }
+
+  simuInit();
+  sourceRangesInit();
+  g_tmr10ms = 1;
+
+  const char * error = benchLoadModel(argc-arg-1, &argv[arg+1]);
+  if (error) {
+    fprintf(stderr, "mixer-replay: %s\n", error);
+    return 1;
+  }
+
+  static char line[REPLAY_MAX_LINE];
+  if (!fgets(line, sizeof(line), log)) {
+    fprintf(stderr, "mixer-replay: empty log\n");
+    return 1;
+  }
+  replayParseHeader(line);
+
+  mixerThreadsStart(threads);
+  replayWriteHeader(output, channels);
+
+  uint32_t rows = 0;
+  uint64_t runs = 0;
+  tmr10ms_t lastTime = 0;
+  tmr10ms_t start10ms = g_tmr10ms;
+  auto start = std::chrono::steady_clock::now();
+
+  while (fgets(line, sizeof(line), log)) {
+    tmr10ms_t time = replayParseRow(line);
+
+    // the clock advances by the logged time difference, the mixer runs once per 10ms of it.
+    // A row logged in the same 10ms as the previous one is only applied to the inputs
+    uint32_t steps = 0;
+    if (rows == 0) {
+      steps = 1;
+    }
+    else if (time > lastTime) {
+      steps = time - lastTime;
+    }
+    else if (replayRtcTime && time < lastTime) {
+      steps = time + 24*3600*100 - lastTime; // midnight
+    }
+    lastTime = time;
+
+    for (uint32_t i=0; i<steps; i++) {
+      g_tmr10ms++;
+      doMixerCalculations();
+    }
+
+    replayWriteRow(output, g_tmr10ms - start10ms, channels);
+    runs += steps;
+    rows++;
+  }
+
+  auto duration = std::chrono::steady_clock::now() - start;
+  double seconds = std::chrono::duration_cast<std::chrono::microseconds>(duration).count() / 1000000.0;
+  fprintf(stderr, "%u rows, %llu mixer runs (%.1fs of flight) in %.3fs, %.0f runs/s\n", rows, (unsigned long long)runs, runs / 100.0, seconds, seconds > 0 ? runs / seconds : 0);
+
+  mixerThreadsStop();
+  benchUnloadModel();
+
+  fclose(log);
+  if (output != stdout) {
+    fclose(output);
+  }
+
+  return 0;
+}
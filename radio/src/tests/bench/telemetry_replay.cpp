@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Offline telemetry replay
+ *
+ * Reads a raw telemetry capture, as written by logTelemetryWriteByte() (or
+ * plain hex bytes, one or more per line), and runs it through each telemetry
+ * decoder of the SIMU firmware core. For each decoder it reports the number
+ * of decoded frames, the CRC errors (S.PORT and Crossfire frames are the only
+ * ones with a CRC), the decoding speed and the resulting sensors table.
+ *
+ * The bytes are given to processTelemetryData() by spans of the -b size, as
+ * the telemetry driver does, -b 1 runs the byte by byte decoders.
+ *
+ * Built with TELEMETRY_FUZZER, the same code is a libFuzzer target: the first
+ * byte of the input selects the decoder, the second one the span size.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+#include "bench_simu.h"
+
+#define REPLAY_MAX_LINE                4096
+#define REPLAY_DEFAULT_SPAN            64
+
+struct TelemetryDecoder {
+  const char * name;
+  uint8_t protocol;
+};
+
+const TelemetryDecoder telemetryDecoders[] = {
+  { "frsky-d", PROTOCOL_FRSKY_D },
+  { "sport", PROTOCOL_FRSKY_SPORT },
+#if defined(CROSSFIRE)
+  { "crossfire", PROTOCOL_PULSES_CROSSFIRE },
+#endif
+#if defined(MULTIMODULE)
+  { "spektrum", PROTOCOL_SPEKTRUM },
+  { "ibus", PROTOCOL_FLYSKY_IBUS },
+  { "multi", PROTOCOL_MULTIMODULE },
+#endif
+};
+
+// the sensors of the model, restored before each decoder run
+TelemetrySensor replaySensors[MAX_TELEMETRY_SENSORS];
+
+// each decoder run (and each fuzzer input) starts from the same state, nothing is left by the previous one
+void replayReset(uint8_t protocol)
+{
+  telemetryReset();
+  telemetryDecodersReset();
+  memcpy(g_model.telemetrySensors, replaySensors, sizeof(g_model.telemetrySensors));
+  telemetrySensorsInvalidate();
+  memclear(&telemetryFramesCounters, sizeof(telemetryFramesCounters));
+  telemetryProtocol = protocol;
+  allowNewSensors = true;
+}
+
+void replayFeed(const uint8_t * data, uint32_t count, uint32_t span)
+{
+  while (count > 0) {
+    uint32_t size = min<uint32_t>(span, count);
+    processTelemetryData(data, size);
+    evalTelemetryCalculatedSensors();
+    data += size;
+    count -= size;
+  }
+}
+
+#if defined(TELEMETRY_FUZZER)
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t * data, size_t size)
+{
+  static bool initialized = false;
+  if (!initialized) {
+    if (!freopen("/dev/null", "w", stdout)) { // the firmware traces
+      perror("telemetry-fuzzer");
+    }
+    simuInit();
+    sourceRangesInit();
+    g_tmr10ms = 1;
+    generalDefault();
+    modelDefault(0);
+    memcpy(replaySensors, g_model.telemetrySensors, sizeof(replaySensors));
+    initialized = true;
+  }
+
+  if (size < 2) {
+    return 0;
+  }
+
+  replayReset(telemetryDecoders[data[0] % DIM(telemetryDecoders)].protocol);
+  replayFeed(data + 2, size - 2, data[1] + 1);
+  return 0;
+}
+#else
+// appends the bytes of a capture line, the timestamp written by
+// logTelemetryWriteStart() ends with the last ':' of the line
+void replayParseLine(char * line, std::vector<uint8_t> & bytes)
+{
+  char * p = strrchr(line, ':');
+  p = (p ? p+1 : line);
+  while (true) {
+    char * end;
+    unsigned long value = strtoul(p, &end, 16);
+    if (end == p)
+      break;
+    bytes.push_back(value);
+    p = end;
+  }
+}
+
+void replayPrintSensors()
+{
+  for (int i=0; i<MAX_TELEMETRY_SENSORS; i++) {
+    if (!isTelemetryFieldAvailable(i)) {
+      continue;
+    }
+
+    TelemetrySensor & sensor = g_model.telemetrySensors[i];
+    TelemetryItem & item = telemetryItems[i];
+    char label[TELEM_LABEL_LEN+1];
+    zchar2str(label, sensor.label, TELEM_LABEL_LEN);
+    fprintf(stderr, "  %2d %-4s %04X/%d/%d ", i+1, label, sensor.id, sensor.subId, sensor.instance);
+
+    if (!item.isAvailable()) {
+      fprintf(stderr, "---\n");
+    }
+    else if (sensor.unit == UNIT_GPS) {
+      fprintf(stderr, "%.6f %.6f\n", item.gps.latitude / 1000000.0, item.gps.longitude / 1000000.0);
+    }
+    else if (sensor.unit == UNIT_DATETIME) {
+      fprintf(stderr, "%04d-%02d-%02d %02d:%02d:%02d\n", item.datetime.year, item.datetime.month, item.datetime.day, item.datetime.hour, item.datetime.min, item.datetime.sec);
+    }
+    else if (sensor.unit == UNIT_TEXT) {
+      fprintf(stderr, "%.*s\n", (int)sizeof(item.text), item.text);
+    }
+    else {
+      double divisor = (sensor.prec == 2 ? 100.0 : (sensor.prec == 1 ? 10.0 : 1.0));
+      fprintf(stderr, "%.*f", sensor.prec, item.value / divisor);
+      if (sensor.unit > UNIT_RAW && sensor.unit < UNIT_FIRST_VIRTUAL) {
+        fprintf(stderr, "%.3s", STR_VTELEMUNIT+1+3*sensor.unit);
+      }
+      fprintf(stderr, " (min %.*f, max %.*f)\n", sensor.prec, item.valueMin / divisor, sensor.prec, item.valueMax / divisor);
+    }
+  }
+}
+
+void replayUsage()
+{
+  fprintf(stderr, "usage: telemetry-replay [-p decoder] [-b span] [-r repeats] [-v] <capture.log> [" BENCH_MODEL_USAGE "]\n");
+  fprintf(stderr, "decoders:");
+  for (unsigned int i=0; i<DIM(telemetryDecoders); i++) {
+    fprintf(stderr, " %s", telemetryDecoders[i].name);
+  }
+  fprintf(stderr, "\n");
+}
+
+int main(int argc, char ** argv)
+{
+  const char * decoderName = NULL;
+  uint32_t span = REPLAY_DEFAULT_SPAN;
+  uint32_t repeats = 1;
+  bool verbose = false;
+
+  int arg = 1;
+  for (; arg < argc && argv[arg][0] == '-'; arg++) {
+    if (!strcmp(argv[arg], "-p") && arg+1 < argc) {
+      decoderName = argv[++arg];
+    }
+    else if (!strcmp(argv[arg], "-b") && arg+1 < argc) {
+      span = max<uint32_t>(1, atoi(argv[++arg]));
+    }
+    else if (!strcmp(argv[arg], "-r") && arg+1 < argc) {
+      repeats = max<uint32_t>(1, atoi(argv[++arg]));
+    }
+    else if (!strcmp(argv[arg], "-v")) {
+      verbose = true;
+    }
+    else {
+      replayUsage();
+      return 1;
+    }
+  }
+
+  if (arg >= argc) {
+    replayUsage();
+    return 1;
+  }
+
+  FILE * capture = fopen(argv[arg], "r");
+  if (!capture) {
+    fprintf(stderr, "telemetry-replay: cannot open %s\n", argv[arg]);
+    return 1;
+  }
+
+  std::vector<uint8_t> bytes;
+  static char line[REPLAY_MAX_LINE];
+  while (fgets(line, sizeof(line), capture)) {
+    replayParseLine(line, bytes);
+  }
+  fclose(capture);
+
+  if (bytes.empty()) {
+    fprintf(stderr, "telemetry-replay: empty capture\n");
+    return 1;
+  }
+
+  // the firmware traces (CRC errors, invalid start bytes) go to stdout
+  if (!verbose && !freopen("/dev/null", "w", stdout)) {
+    perror("telemetry-replay");
+  }
+
+  simuInit();
+  sourceRangesInit();
+  g_tmr10ms = 1;
+
+  if (arg + 1 < argc) {
+    const char * error = benchLoadModel(argc-arg-1, &argv[arg+1]);
+    if (error) {
+      fprintf(stderr, "telemetry-replay: %s\n", error);
+      return 1;
+    }
+  }
+  else {
+    generalDefault();
+    modelDefault(0);
+  }
+  memcpy(replaySensors, g_model.telemetrySensors, sizeof(replaySensors));
+
+  fprintf(stderr, "%u bytes, spans of %u bytes\n", (unsigned int)bytes.size(), span);
+
+  bool found = false;
+  for (unsigned int i=0; i<DIM(telemetryDecoders); i++) {
+    const TelemetryDecoder & decoder = telemetryDecoders[i];
+    if (decoderName && strcmp(decoderName, decoder.name)) {
+      continue;
+    }
+    found = true;
+
+    double seconds = 0;
+    for (uint32_t r=0; r<repeats; r++) {
+      replayReset(decoder.protocol);
+      auto start = std::chrono::steady_clock::now();
+      replayFeed(&bytes[0], bytes.size(), span);
+      auto duration = std::chrono::steady_clock::now() - start;
+      seconds += std::chrono::duration_cast<std::chrono::microseconds>(duration).count() / 1000000.0;
+    }
+
+    uint32_t frames = telemetryFramesCounters.frames;
+    uint32_t errors = telemetryFramesCounters.errors;
+    fprintf(stderr, "%s: %u frames, %u CRC errors (%.2f%%), %.0f frames/s, %.1f MB/s\n", decoder.name, frames, errors,
+            frames + errors > 0 ? errors * 100.0 / (frames + errors) : 0,
+            seconds > 0 ? frames * repeats / seconds : 0,
+            seconds > 0 ? bytes.size() * repeats / seconds / 1000000.0 : 0);
+    replayPrintSensors();
+  }
+
+  if (!found) {
+    replayUsage();
+    return 1;
+  }
+
+  if (arg + 1 < argc) {
+    benchUnloadModel();
+  }
+
+  return 0;
+}
+#endif
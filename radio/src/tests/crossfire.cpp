@@ -43,5 +43,103 @@ TEST(Crossfire, crc8)
   uint8_t crc = crc8(&frame[2], frame[1]-1);
   ASSERT_EQ(frame[frame[1]+1], crc);
 }
+
+TEST(Crossfire, processTelemetrySpans)
+{
+  uint8_t frame[] = { RADIO_ADDRESS, 0x0C, LINK_ID, 0x50, 0x51, 87, 0x05, 0x00, 0x02, 0x01, 0x40, 98, 0x06, 0x00 };
+  uint8_t stream[3 + 2*sizeof(frame)] = { 0x00, 0x11, 0x22 };
+
+  frame[13] = crc8(&frame[2], frame[1]-1);
+  memcpy(&stream[3], frame, sizeof(frame));
+  frame[5] = 88;
+  frame[13] = crc8(&frame[2], frame[1]-1);
+  memcpy(&stream[3+sizeof(frame)], frame, sizeof(frame));
+
+  // both frames are decoded wherever the stream is split
+  for (unsigned int split=0; split<=sizeof(stream); split++) {
+    MODEL_RESET();
+    TELEMETRY_RESET();
+    allowNewSensors = true;
+    telemetryRxBufferCount = 0;
+    processCrossfireTelemetryData(stream, split);
+    processCrossfireTelemetryData(stream+split, sizeof(stream)-split);
+    EXPECT_EQ(telemetryItems[2].valueMin, 87);
+    EXPECT_EQ(telemetryItems[2].value, 88);
+    EXPECT_EQ(telemetryRxBufferCount, 0);
+  }
+}
+
+TEST(Crossfire, processTelemetryFields)
+{
+  uint8_t battery[] = { RADIO_ADDRESS, 0x0A, BATTERY_ID, 0x00, 0x7B, 0x00, 0x0C, 0x00, 0x04, 0x00, 50, 0x00 };
+  uint8_t link[] = { RADIO_ADDRESS, 0x0C, LINK_ID, 0x50, 0x51, 87, 0x05, 0x00, 0x02, 0x03, 0x40, 98, 0x06, 0x00 };
+  battery[11] = crc8(&battery[2], battery[1]-1);
+  link[13] = crc8(&link[2], link[1]-1);
+
+  MODEL_RESET();
+  TELEMETRY_RESET();
+  allowNewSensors = true;
+  telemetryRxBufferCount = 0;
+  processCrossfireTelemetryData(battery, sizeof(battery));
+  processCrossfireTelemetryData(link, sizeof(link));
+  EXPECT_EQ(telemetryItems[0].value, 123);   // voltage
+  EXPECT_EQ(telemetryItems[1].value, 12);    // current
+  EXPECT_EQ(telemetryItems[2].value, 1024);  // capacity
+  EXPECT_EQ(telemetryItems[5].value, 87);    // RX quality
+  EXPECT_EQ(telemetryItems[9].value, 100);   // TX power
+
+  // two sensors sharing the same id both receive the value
+  g_model.telemetrySensors[13] = g_model.telemetrySensors[0];
+  telemetrySensorsInvalidate();
+  battery[4] = 0x7C;
+  battery[11] = crc8(&battery[2], battery[1]-1);
+  processCrossfireTelemetryData(battery, sizeof(battery));
+  EXPECT_EQ(telemetryItems[0].value, 124);
+  EXPECT_EQ(telemetryItems[13].value, 124);
+}
+
+TEST(Crossfire, sensorsSlots)
+{
+  // only the voltage field is valid
+  uint8_t battery[] = { RADIO_ADDRESS, 0x0A, BATTERY_ID, 0x00, 0x7B, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 50, 0x00 };
+  battery[11] = crc8(&battery[2], battery[1]-1);
+
+  MODEL_RESET();
+  TELEMETRY_RESET();
+  allowNewSensors = true;
+  telemetryRxBufferCount = 0;
+  processCrossfireTelemetryData(battery, sizeof(battery));
+  EXPECT_EQ(telemetryItems[0].value, 123);
+
+  // the voltage sensor doesn't match any more, the value goes to a new sensor, then to its slot
+  g_model.telemetrySensors[0].instance = 10;
+  telemetrySensorsInvalidate();
+  battery[4] = 0x7C;
+  battery[11] = crc8(&battery[2], battery[1]-1);
+  processCrossfireTelemetryData(battery, sizeof(battery));
+  EXPECT_EQ(telemetryItems[0].value, 123);
+  EXPECT_EQ(telemetryItems[1].value, 124);
+  battery[4] = 0x7D;
+  battery[11] = crc8(&battery[2], battery[1]-1);
+  processCrossfireTelemetryData(battery, sizeof(battery));
+  EXPECT_EQ(telemetryItems[0].value, 123);
+  EXPECT_EQ(telemetryItems[1].value, 125);
+
+  // the slots are kept until the sensors are invalidated
+  g_model.ignoreSensorIds = 1;
+  battery[4] = 0x7E;
+  battery[11] = crc8(&battery[2], battery[1]-1);
+  processCrossfireTelemetryData(battery, sizeof(battery));
+  EXPECT_EQ(telemetryItems[0].value, 123);
+  EXPECT_EQ(telemetryItems[1].value, 126);
+
+  // both sensors match when the sensors ids are ignored
+  telemetrySensorsInvalidate();
+  battery[4] = 0x7F;
+  battery[11] = crc8(&battery[2], battery[1]-1);
+  processCrossfireTelemetryData(battery, sizeof(battery));
+  EXPECT_EQ(telemetryItems[0].value, 127);
+  EXPECT_EQ(telemetryItems[1].value, 127);
+}
 #endif
 
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "gtests.h"
+
+#if defined(DISK_CACHE) && defined(SIMU_DISKIO)
+// the cache reads and writes the ./sdcard.image file through simudisk.cpp
+
+#define TEST_IMAGE_SECTORS             1024
+
+extern FILE * diskImage;
+
+class DiskCacheTest : public testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      // each sector is filled with its number
+      FILE * image = fopen("sdcard.image", "wb");
+      ASSERT_TRUE(image != NULL);
+      uint8_t buffer[BLOCK_SIZE];
+      for (DWORD sector=0; sector<TEST_IMAGE_SECTORS; sector++) {
+        memset(buffer, sector, BLOCK_SIZE);
+        fwrite(buffer, BLOCK_SIZE, 1, image);
+      }
+      fclose(image);
+      if (diskImage) {
+        fclose(diskImage);
+      }
+      ASSERT_EQ(0, disk_initialize(0));
+      ASSERT_EQ((uint32_t)TEST_IMAGE_SECTORS, sdGetNoSectors());
+      diskCache.clear();
+    }
+
+    // a write failure of the card
+    void ejectCard()
+    {
+      image = diskImage;
+      diskImage = NULL;
+    }
+
+    void insertCard()
+    {
+      diskImage = image;
+    }
+
+    FILE * image;
+};
+
+// the value of the sector on the card, bypassing the cache
+static uint8_t readImageSector(DWORD sector)
+{
+  uint8_t buffer[BLOCK_SIZE];
+  __disk_read(0, buffer, sector, 1);
+  return buffer[0];
+}
+
+static uint8_t readCacheSector(DWORD sector)
+{
+  uint8_t buffer[BLOCK_SIZE];
+  EXPECT_EQ(RES_OK, diskCache.read(0, buffer, sector, 1));
+  return buffer[0];
+}
+
+TEST_F(DiskCacheTest, readAhead)
+{
+  // not sequential, the block is loaded alone
+  EXPECT_EQ(32, readCacheSector(32));
+  EXPECT_EQ(1u, diskCache.getStats().noMisses);
+  EXPECT_EQ(0u, diskCache.getStats().noReadAheads);
+
+  for (DWORD sector=33; sector<48; sector++) {
+    EXPECT_EQ(sector, readCacheSector(sector));
+  }
+  EXPECT_EQ(15u, diskCache.getStats().noHits);
+
+  // sequential miss, the next block is read ahead
+  EXPECT_EQ(48, readCacheSector(48));
+  EXPECT_EQ(2u, diskCache.getStats().noMisses);
+  EXPECT_EQ(1u, diskCache.getStats().noReadAheads);
+  EXPECT_EQ(64, readCacheSector(64));
+  EXPECT_EQ(2u, diskCache.getStats().noMisses);
+}
+
+TEST_F(DiskCacheTest, writeBack)
+{
+  uint8_t buffer[BLOCK_SIZE];
+  EXPECT_EQ(5, readCacheSector(5));
+
+  // the sector is cached, it is only written to the cache
+  memset(buffer, 0xA5, BLOCK_SIZE);
+  EXPECT_EQ(RES_OK, diskCache.write(0, buffer, 5, 1));
+  EXPECT_EQ(1u, diskCache.getStats().noWriteBacks);
+  EXPECT_EQ(0u, diskCache.getStats().noDiskWrites);
+  EXPECT_EQ(5, readImageSector(5));
+  EXPECT_EQ(0xA5, readCacheSector(5));
+
+  EXPECT_EQ(RES_OK, diskCache.flush(0));
+  EXPECT_EQ(1u, diskCache.getStats().noDiskWrites);
+  EXPECT_EQ(0xA5, readImageSector(5));
+  EXPECT_EQ(4, readImageSector(4));
+  EXPECT_EQ(6, readImageSector(6));
+}
+
+TEST_F(DiskCacheTest, failedWrite)
+{
+  uint8_t buffer[(DISK_CACHE_BLOCK_SECTORS + 1) * BLOCK_SIZE];
+  EXPECT_EQ(16, readCacheSector(16));
+
+  // too big for the cache, it goes straight to the card and fails
+  memset(buffer, 0xA5, sizeof(buffer));
+  ejectCard();
+  EXPECT_NE(RES_OK, diskCache.write(0, buffer, 10, DISK_CACHE_BLOCK_SECTORS + 1));
+  insertCard();
+
+  // the cached copy still has the sectors of the card
+  EXPECT_EQ(16, readCacheSector(16));
+  EXPECT_EQ(26, readCacheSector(26));
+  EXPECT_EQ(26, readImageSector(26));
+
+  // the same write once the card is back updates the cached copy
+  EXPECT_EQ(RES_OK, diskCache.write(0, buffer, 10, DISK_CACHE_BLOCK_SECTORS + 1));
+  EXPECT_EQ(0xA5, readCacheSector(16));
+  EXPECT_EQ(0xA5, readImageSector(26));
+  EXPECT_EQ(27, readCacheSector(27));
+}
+
+TEST_F(DiskCacheTest, syncFlush)
+{
+  uint8_t buffer[BLOCK_SIZE];
+  EXPECT_EQ(5, readCacheSector(5));
+  memset(buffer, 0xA5, BLOCK_SIZE);
+  EXPECT_EQ(RES_OK, diskCache.write(0, buffer, 5, 1));
+  EXPECT_EQ(5, readImageSector(5));
+
+  // f_sync() and f_close() end with a CTRL_SYNC
+  EXPECT_EQ(RES_OK, disk_ioctl(0, CTRL_SYNC, NULL));
+  EXPECT_EQ(0xA5, readImageSector(5));
+}
+
+TEST_F(DiskCacheTest, unmountFlush)
+{
+  uint8_t buffer[BLOCK_SIZE];
+  ASSERT_EQ(FR_OK, f_mkfs("", FM_FAT | FM_SFD, 0, buffer, sizeof(buffer)));
+  sdMount();
+  ASSERT_TRUE(sdMounted());
+
+  readCacheSector(TEST_IMAGE_SECTORS - DISK_CACHE_BLOCK_SECTORS);
+  memset(buffer, 0xA5, BLOCK_SIZE);
+  EXPECT_EQ(RES_OK, diskCache.write(0, buffer, TEST_IMAGE_SECTORS - DISK_CACHE_BLOCK_SECTORS, 1));
+  EXPECT_NE(0xA5, readImageSector(TEST_IMAGE_SECTORS - DISK_CACHE_BLOCK_SECTORS));
+
+  sdDone();
+  EXPECT_FALSE(sdMounted());
+  EXPECT_EQ(0xA5, readImageSector(TEST_IMAGE_SECTORS - DISK_CACHE_BLOCK_SECTORS));
+}
+
+TEST_F(DiskCacheTest, failedFlush)
+{
+  uint8_t buffer[BLOCK_SIZE];
+  EXPECT_EQ(5, readCacheSector(5));
+  memset(buffer, 0xA5, BLOCK_SIZE);
+  EXPECT_EQ(RES_OK, diskCache.write(0, buffer, 5, 1));
+
+  ejectCard();
+  EXPECT_NE(RES_OK, disk_ioctl(0, CTRL_SYNC, NULL));
+  EXPECT_NE(RES_OK, diskCache.flush(0));
+  insertCard();
+
+  // the sector is still dirty, the next flush writes it
+  EXPECT_EQ(5, readImageSector(5));
+  EXPECT_EQ(0xA5, readCacheSector(5));
+  EXPECT_EQ(0u, diskCache.getStats().noDiskWrites);
+  EXPECT_EQ(RES_OK, disk_ioctl(0, CTRL_SYNC, NULL));
+  EXPECT_EQ(1u, diskCache.getStats().noDiskWrites);
+  EXPECT_EQ(0xA5, readImageSector(5));
+}
+#endif
@@ -553,4 +553,154 @@ TEST(FrSkySPORT, frskyCurrent)
   EXPECT_EQ(telemetryItems[0].valueMax, 505);
 }
 
+TEST(FrSkySPORT, sensorsSharingId)
+{
+  MODEL_RESET();
+  TELEMETRY_RESET();
+  allowNewSensors = true;
+
+  setTelemetryValue(TELEM_PROTO_FRSKY_SPORT, RSSI_ID, 0, 1, 50, UNIT_DB, 0);
+  setTelemetryValue(TELEM_PROTO_FRSKY_SPORT, RSSI_ID, 0, 2, 60, UNIT_DB, 0);
+  EXPECT_EQ(telemetryItems[0].value, 50);
+  EXPECT_EQ(telemetryItems[1].value, 60);
+
+  // a copy of the first sensor receives the same values, once the sensors index (built by the
+  // first lookup after the sensors creation) is invalidated
+  setTelemetryValue(TELEM_PROTO_FRSKY_SPORT, RSSI_ID, 0, 1, 55, UNIT_DB, 0);
+  g_model.telemetrySensors[2] = g_model.telemetrySensors[0];
+  setTelemetryValue(TELEM_PROTO_FRSKY_SPORT, RSSI_ID, 0, 1, 65, UNIT_DB, 0);
+  EXPECT_EQ(telemetryItems[0].value, 65);
+  EXPECT_FALSE(telemetryItems[2].isAvailable());
+  telemetrySensorsInvalidate();
+  setTelemetryValue(TELEM_PROTO_FRSKY_SPORT, RSSI_ID, 0, 1, 70, UNIT_DB, 0);
+  EXPECT_EQ(telemetryItems[0].value, 70);
+  EXPECT_EQ(telemetryItems[1].value, 60);
+  EXPECT_EQ(telemetryItems[2].value, 70);
+
+  // any instance matches when the sensors ids are ignored
+  g_model.ignoreSensorIds = 1;
+  setTelemetryValue(TELEM_PROTO_FRSKY_SPORT, RSSI_ID, 0, 3, 80, UNIT_DB, 0);
+  EXPECT_EQ(telemetryItems[0].value, 80);
+  EXPECT_EQ(telemetryItems[1].value, 80);
+  EXPECT_EQ(telemetryItems[2].value, 80);
+  EXPECT_FALSE(g_model.telemetrySensors[3].isAvailable());
+}
+
+TEST(FrSkySPORT, calculatedSensorsOrder)
+{
+  MODEL_RESET();
+  TELEMETRY_RESET();
+
+  // sensor 1 = 2 * sensor 2, sensor 2 = max(sensor 3), sensor 3 = RSSI
+  g_model.telemetrySensors[0].type = TELEM_TYPE_CALCULATED;
+  g_model.telemetrySensors[0].formula = TELEM_FORMULA_ADD;
+  g_model.telemetrySensors[0].unit = UNIT_DB;
+  g_model.telemetrySensors[0].calc.sources[0] = 2;
+  g_model.telemetrySensors[0].calc.sources[1] = 2;
+  g_model.telemetrySensors[1].type = TELEM_TYPE_CALCULATED;
+  g_model.telemetrySensors[1].formula = TELEM_FORMULA_MAX;
+  g_model.telemetrySensors[1].unit = UNIT_DB;
+  g_model.telemetrySensors[1].calc.sources[0] = 3;
+  frskySportSetDefault(2, RSSI_ID, 0, 0);
+
+  // the sources are evaluated first
+  setTelemetryValue(TELEM_PROTO_FRSKY_SPORT, RSSI_ID, 0, 0, 50, UNIT_DB, 0);
+  telemetryWakeup();
+  EXPECT_EQ(telemetryItems[1].value, 50);
+  EXPECT_EQ(telemetryItems[0].value, 100);
+
+  // nothing is evaluated while the sources don't receive anything
+  telemetryItems[0].value = 0;
+  telemetryWakeup();
+  EXPECT_EQ(telemetryItems[0].value, 0);
+
+  setTelemetryValue(TELEM_PROTO_FRSKY_SPORT, RSSI_ID, 0, 0, 60, UNIT_DB, 0);
+  telemetryWakeup();
+  EXPECT_EQ(telemetryItems[1].value, 60);
+  EXPECT_EQ(telemetryItems[0].value, 120);
+}
+
+TEST(FrSkySPORT, sensorHistory)
+{
+  MODEL_RESET();
+  TELEMETRY_RESET();
+  telemetryHistoryReset();
+  telemetryStreaming = TELEMETRY_TIMEOUT10ms;
+  frskySportSetDefault(0, T1_FIRST_ID, 0, 0);
+
+  EXPECT_EQ(telemetryHistoryAdd(0), 0);
+  EXPECT_EQ(telemetryHistoryAdd(1), 1);
+  EXPECT_EQ(telemetryHistoryAdd(0), 0);
+
+  // one sample per second, averaged to 10s and 1min
+  for (int i=0; i<70; i++) {
+    setTelemetryValue(TELEM_PROTO_FRSKY_SPORT, T1_FIRST_ID, 0, 0, i, UNIT_CELSIUS, 0);
+    for (int j=0; j<100; j++) {
+      telemetryHistoryInterrupt10ms();
+    }
+  }
+
+  const TelemetryHistoryRing * ring = getTelemetryHistory(0, TELEMETRY_HISTORY_1S);
+  ASSERT_TRUE(ring != NULL);
+  EXPECT_EQ(ring->count, TELEMETRY_HISTORY_LENGTH);
+  EXPECT_EQ(ring->get(0), 10);
+  EXPECT_EQ(ring->get(TELEMETRY_HISTORY_LENGTH-1), 69);
+
+  ring = getTelemetryHistory(0, TELEMETRY_HISTORY_10S);
+  EXPECT_EQ(ring->count, 7);
+  EXPECT_EQ(ring->get(0), 4);
+  EXPECT_EQ(ring->get(6), 64);
+
+  ring = getTelemetryHistory(0, TELEMETRY_HISTORY_1MIN);
+  EXPECT_EQ(ring->count, 1);
+  EXPECT_EQ(ring->get(0), 29);
+
+  // the second sensor was never received
+  int32_t min, max;
+  EXPECT_FALSE(getTelemetryHistory(1, TELEMETRY_HISTORY_1S)->getRange(min, max));
+
+  telemetryItems[0].setOld();
+  for (int j=0; j<100; j++) {
+    telemetryHistoryInterrupt10ms();
+  }
+  ring = getTelemetryHistory(0, TELEMETRY_HISTORY_1S);
+  EXPECT_EQ(ring->get(TELEMETRY_HISTORY_LENGTH-1), TELEMETRY_HISTORY_NO_VALUE);
+  EXPECT_TRUE(ring->getRange(min, max));
+  EXPECT_EQ(min, 11);
+  EXPECT_EQ(max, 69);
+
+  telemetryHistoryRemove(1);
+  EXPECT_TRUE(getTelemetryHistory(1, TELEMETRY_HISTORY_1S) == NULL);
+  telemetryHistoryReset();
+  EXPECT_TRUE(getTelemetryHistory(0, TELEMETRY_HISTORY_1S) == NULL);
+}
+
+TEST(FrSkySPORT, sensorHistoryOwners)
+{
+  MODEL_RESET();
+  TELEMETRY_RESET();
+  telemetryHistoryReset();
+  frskySportSetDefault(0, T1_FIRST_ID, 0, 0);
+  frskySportSetDefault(1, T2_FIRST_ID, 0, 0);
+
+  int script1, script2;
+  EXPECT_EQ(telemetryHistoryAdd(0, &script1), 0);
+  EXPECT_EQ(telemetryHistoryAdd(0, &script2), 1);
+  EXPECT_EQ(telemetryHistoryAdd(1, &script1), 2);
+  EXPECT_EQ(telemetryHistoryAdd(0, &script1), 0);
+
+  // the slots of an unloaded script are freed, the other scripts keep theirs
+  telemetryHistoryRemoveOwner(&script1);
+  EXPECT_TRUE(getTelemetryHistory(0, TELEMETRY_HISTORY_1S) == NULL);
+  EXPECT_TRUE(getTelemetryHistory(1, TELEMETRY_HISTORY_1S) != NULL);
+  EXPECT_TRUE(getTelemetryHistory(2, TELEMETRY_HISTORY_1S) == NULL);
+
+  // the slots of a deleted sensor are freed, whatever their owner
+  EXPECT_EQ(telemetryHistoryAdd(1, &script2), 0);
+  delTelemetryIndex(0);
+  EXPECT_TRUE(getTelemetryHistory(0, TELEMETRY_HISTORY_1S) != NULL);
+  EXPECT_TRUE(getTelemetryHistory(1, TELEMETRY_HISTORY_1S) == NULL);
+  telemetryHistoryReset();
+}
+
 #endif  //#if defined(TELEMETRY_FRSKY_SPORT)
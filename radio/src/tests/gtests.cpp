@@ -148,6 +148,7 @@ int main(int argc, char **argv)
 {
   QCoreApplication app(argc, argv);
   simuInit();
+  sourceRangesInit();
   StartEepromThread(NULL);
   menuLevel = 0;
   menuHandlers[0] = menuMainView;
@@ -58,6 +58,11 @@ inline void MODEL_RESET()
   extern uint8_t s_mixer_first_run_done;
   s_mixer_first_run_done = false;
   lastFlightMode = 255;
+#if defined(CPUARM)
+  // the tests modify g_model directly, they call the same invalidation hooks than the menus
+  mixerProgramInvalidate();
+  telemetrySensorsInvalidate();
+#endif
 }
 
 inline void MIXER_RESET()
@@ -89,6 +94,7 @@ inline void TELEMETRY_RESET()
   }
 #endif
   memclear(g_model.telemetrySensors, sizeof(g_model.telemetrySensors));
+  telemetrySensorsInvalidate();
 #endif
 }
 
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x 
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "gtests.h"
+#include "logsbinary.h"
+
+static void appendLogsBinaryHeader(QByteArray & buffer, quint32 start)
+{
+  buffer.append(LOGS_BINARY_MAGIC);
+  buffer.append((char)LOGS_BINARY_VERSION);
+  buffer.append((char)1);                 // columns count
+  buffer.append((char)6).append((char)0); // record size
+  buffer.append((char)start).append((char)(start >> 8)).append((char)(start >> 16)).append((char)(start >> 24));
+  buffer.append(QByteArray("Alt(m)").leftJustified(LOGS_BINARY_LABEL_LEN, '\0'));
+  buffer.append((char)1);                 // int16
+  buffer.append((char)0);                 // precision
+}
+
+static void appendLogsBinaryRecord(QByteArray & buffer, quint32 time, qint16 value)
+{
+  buffer.append((char)time).append((char)(time >> 8)).append((char)(time >> 16)).append((char)(time >> 24));
+  buffer.append((char)value).append((char)(value >> 8));
+}
+
+TEST(LogsBinary, truncatedSession)
+{
+  QByteArray buffer;
+
+  appendLogsBinaryHeader(buffer, 0);
+  appendLogsBinaryRecord(buffer, 100, 10);
+  appendLogsBinaryRecord(buffer, 200, 20);
+  buffer.append(QByteArray(512 - buffer.size(), '\xFF'));
+
+  // interrupted by a power loss in the middle of a record, neither padded nor sector aligned
+  appendLogsBinaryHeader(buffer, 3600);
+  appendLogsBinaryRecord(buffer, 100, 30);
+  appendLogsBinaryRecord(buffer, 200, 40);
+  buffer.chop(3);
+
+  appendLogsBinaryHeader(buffer, 7200);
+  appendLogsBinaryRecord(buffer, 100, 50);
+  appendLogsBinaryRecord(buffer, 200, -60);
+  buffer.append(QByteArray(1024 - buffer.size(), '\xFF'));
+
+  QList<QStringList> csvlog;
+  EXPECT_EQ(parseLogsBinary(buffer, csvlog), 1);
+  ASSERT_EQ(csvlog.size(), 6);
+  EXPECT_EQ(csvlog[0], QStringList() << "Date" << "Time" << "Alt(m)");
+  EXPECT_EQ(csvlog[1], QStringList() << "1970-01-01" << "00:00:01.000" << "10");
+  EXPECT_EQ(csvlog[2], QStringList() << "1970-01-01" << "00:00:02.000" << "20");
+  EXPECT_EQ(csvlog[3], QStringList() << "1970-01-01" << "01:00:01.000" << "30");
+  EXPECT_EQ(csvlog[4], QStringList() << "1970-01-01" << "02:00:01.000" << "50");
+  EXPECT_EQ(csvlog[5], QStringList() << "1970-01-01" << "02:00:02.000" << "-60");
+}
@@ -165,4 +165,83 @@ TEST(Lua, testModelInputs)
 
 }
 
+TEST(Lua, testFindFieldByName)
+{
+  LuaField field;
+
+  // twice, the second time the name comes from the cache
+  for (int i=0; i<2; i++) {
+    EXPECT_TRUE(luaFindFieldByName("ail", field));
+    EXPECT_EQ(MIXSRC_Ail, field.id);
+    EXPECT_TRUE(luaFindFieldByName("ch1", field));
+    EXPECT_EQ(MIXSRC_CH1, field.id);
+    EXPECT_TRUE(luaFindFieldByName("ch10", field));
+    EXPECT_EQ(MIXSRC_CH1+9, field.id);
+    EXPECT_TRUE(luaFindFieldByName("ls2", field));
+    EXPECT_EQ(MIXSRC_SW1+1, field.id);
+  }
+  EXPECT_FALSE(luaFindFieldByName("ch0", field));
+  EXPECT_FALSE(luaFindFieldByName("ch", field));
+  EXPECT_FALSE(luaFindFieldByName("ch100", field));
+  EXPECT_FALSE(luaFindFieldByName("unknown", field));
+
+  luaExecStr("info = getFieldInfo('ch3')");
+  luaExecStr("if info.id ~= getFieldInfo('ch1').id + 2 then error('getFieldInfo()') end");
+  luaExecStr("if info.desc ~= 'Channel CH3' then error('getFieldInfo() desc') end");
+  luaExecStr("if getFieldInfo('ail').name ~= 'ail' then error('getFieldInfo() name') end");
+}
+
+TEST(Lua, testDrawBatch)
+{
+  static uint8_t refBuf[DISPLAY_BUFFER_SIZE];
+
+  luaLcdAllowed = true;
+
+  lcdClear();
+  luaExecStr("lcd.drawText(2, 2, 'batch', SMLSIZE)");
+  luaExecStr("lcd.drawNumber(60, 2, 1234, PREC1)");
+  luaExecStr("lcd.drawLine(0, 20, 100, 40, SOLID, 0)");
+  luaExecStr("lcd.drawLine(0, 30, 100, 30, DOTTED, 0)");
+  luaExecStr("lcd.drawRectangle(5, 45, 40, 12, 0)");
+  luaExecStr("lcd.drawFilledRectangle(10, 47, 30, 8, 0)");
+  memcpy(refBuf, displayBuf, DISPLAY_BUFFER_SIZE);
+
+  // the trailing entries after count are ignored
+  lcdClear();
+  luaExecStr("lcd.drawBatch({DRAW_TEXT, 2, 2, 'batch', SMLSIZE, DRAW_NUMBER, 60, 2, 1234, PREC1, "
+             "DRAW_LINE, 0, 20, 100, 40, SOLID, 0, DRAW_LINE, 0, 30, 100, 30, DOTTED, 0, "
+             "DRAW_RECT, 5, 45, 40, 12, 0, DRAW_FILLED_RECT, 10, 47, 30, 8, 0, DRAW_POINT, 1, 1}, 36)");
+  EXPECT_EQ(0, memcmp(refBuf, displayBuf, DISPLAY_BUFFER_SIZE));
+
+  luaExecStr("if pcall(lcd.drawBatch, {DRAW_TEXT, 2, 2, 'batch'}) then error('incomplete command') end");
+  luaExecStr("if pcall(lcd.drawBatch, {0, 2, 2}) then error('invalid command') end");
+  luaExecStr("if pcall(lcd.drawBatch, {DRAW_POINT, 2, 'x'}) then error('invalid argument') end");
+
+  luaLcdAllowed = false;
+}
+
+TEST(Lua, testDelSensorHistory)
+{
+  static const int otherScript = 0;
+  char script[80];
+
+  telemetryHistoryClear();
+  int otherSlot = telemetryHistoryAdd(0, &otherScript);
+  int slot = telemetryHistoryAdd(0, luaRunningScript);
+  ASSERT_NE(otherSlot, slot);
+
+  // the slot of another script is kept
+  sprintf(script, "if pcall(delSensorHistory, %d) then error('slot of another script') end", otherSlot);
+  luaExecStr(script);
+  EXPECT_TRUE(telemetryHistory[otherSlot].sensor);
+  luaExecStr("if pcall(delSensorHistory, 1000) then error('invalid slot') end");
+
+  sprintf(script, "delSensorHistory(%d)", slot);
+  luaExecStr(script);
+  EXPECT_FALSE(telemetryHistory[slot].sensor);
+  EXPECT_TRUE(telemetryHistory[otherSlot].sensor);
+
+  telemetryHistoryClear();
+}
+
 #endif   // #if defined(LUA)
@@ -18,6 +18,7 @@
  * GNU General Public License for more details.
  */
 
+#include <vector>
 #include "gtests.h"
 
 class TrimsTest : public OpenTxTest {};
@@ -78,6 +79,7 @@ TEST_F(TrimsTest, throttleTrim)
 
   // now the same tests with extended Trims
   g_model.extendedTrims = 1;
+  mixerProgramInvalidate();
   // stick max + trim max
   anaInValues[THR_STICK] = +1024;
   setTrimValue(0, THR_STICK, TRIM_EXTENDED_MAX);
@@ -138,6 +140,7 @@ TEST_F(TrimsTest, invertedThrottlePlusThrottleTrim)
 
   // now the same tests with extended Trims
   g_model.extendedTrims = 1;
+  mixerProgramInvalidate();
   // stick max + trim max
   anaInValues[THR_STICK] = +1024;
   setTrimValue(0, THR_STICK, TRIM_EXTENDED_MAX);
@@ -210,6 +213,7 @@ TEST_F(TrimsTest, throttleTrimWithZeroWeightOnThrottle)
 
   // now some tests with extended Trims
   g_model.extendedTrims = 1;
+  mixerProgramInvalidate();
   // trim min + various stick positions = should always be same value
   setTrimValue(0, THR_STICK, TRIM_EXTENDED_MIN);
   anaInValues[THR_STICK] = -1024;
@@ -287,6 +291,7 @@ TEST_F(TrimsTest, invertedThrottlePlusthrottleTrimWithZeroWeightOnThrottle)
 
   // now some tests with extended Trims
   g_model.extendedTrims = 1;
+  mixerProgramInvalidate();
   // trim min + various stick positions = should always be same value
   setTrimValue(0, THR_STICK, TRIM_EXTENDED_MIN);
   anaInValues[THR_STICK] = -1024;
@@ -407,6 +412,33 @@ TEST(Curves, LinearIntpol)
   EXPECT_EQ(applyCustomCurve(-192, 0), -192);
 }
 
+#if defined(CPUARM)
+TEST(Curves, SmoothCurveTangents)
+{
+  SYSTEM_RESET();
+  MODEL_RESET();
+  MIXER_RESET();
+  modelDefault(0);
+  g_model.curves[0].smooth = 1;
+  for (int8_t i=-2; i<=2; i++) {
+    g_model.points[2+i] = 50*i;
+  }
+  evalMixes(1);
+  EXPECT_EQ(applyCustomCurve(128, 0), 128);
+
+  // the mixer keeps the tangents of the linear curve until the model is invalidated
+  g_model.points[1] = 0;
+  g_model.points[3] = 0;
+  evalMixes(1);
+  EXPECT_NE(applyCustomCurve(128, 0), 0);
+
+  mixerProgramInvalidate();
+  EXPECT_EQ(applyCustomCurve(128, 0), 0);
+  evalMixes(1);
+  EXPECT_EQ(applyCustomCurve(128, 0), 0);
+}
+#endif
+
 
 #if !defined(CPUARM)
 TEST(FlightModes, nullFadeOut_posFadeIn)
@@ -965,6 +997,47 @@ TEST(Heli, SimpleTest)
 }
 #endif
 
+#if defined(CPUARM)
+TEST_F(MixerTest, programInvalidation)
+{
+  g_model.mixData[0].destCh = 0;
+  g_model.mixData[0].srcRaw = MIXSRC_MAX;
+  g_model.mixData[0].weight = 100;
+  evalFlightModeMixes(e_perout_mode_normal, 0);
+  EXPECT_EQ(chans[0], CHANNEL_MAX);
+
+  // the compiled program is kept until the model is invalidated
+  g_model.mixData[0].weight = 50;
+  evalFlightModeMixes(e_perout_mode_normal, 0);
+  EXPECT_EQ(chans[0], CHANNEL_MAX);
+
+  mixerProgramInvalidate();
+  evalFlightModeMixes(e_perout_mode_normal, 0);
+  EXPECT_EQ(chans[0], CHANNEL_MAX/2);
+}
+#endif
+
+#if defined(VIRTUAL_INPUTS)
+TEST_F(MixerTest, inputsCacheInvalidation)
+{
+  ExpoData * expo = expoAddress(0);
+  expo->srcRaw = MIXSRC_MAX;
+  expo->curve.type = CURVE_REF_FUNC;
+  expo->curve.value = CURVE_X_GT0;
+  evalFlightModeMixes(e_perout_mode_normal, 0);
+  EXPECT_EQ(anas[0], 1024);
+
+  // the curve is not part of the cached line inputs, the result is kept until the model is invalidated
+  expo->curve.value = CURVE_X_LT0;
+  evalFlightModeMixes(e_perout_mode_normal, 0);
+  EXPECT_EQ(anas[0], 1024);
+
+  mixerProgramInvalidate();
+  evalFlightModeMixes(e_perout_mode_normal, 0);
+  EXPECT_EQ(anas[0], 0);
+}
+#endif
+
 TEST(Trainer, UnpluggedTest)
 {
   SYSTEM_RESET();
@@ -981,3 +1054,266 @@ TEST(Trainer, UnpluggedTest)
   ppmInput[0] = 1024;
   CHECK_DELAY(0, 5000);
 }
+
+#if defined(CPUARM)
+// The getValue() if / else chain as it was before the dispatch table,
+// kept here as the reference
+getvalue_t getValueChain(mixsrc_t i)
+{
+#if defined(HELI)
+  extern MIXER_THREAD_LOCAL int16_t cyc_anas[3];
+#endif
+
+  if (i == MIXSRC_NONE) {
+    return 0;
+  }
+  else if (i <= MIXSRC_LAST_INPUT) {
+    return anas[i-MIXSRC_FIRST_INPUT];
+  }
+#if defined(LUA_INPUTS)
+  else if (i <= MIXSRC_LAST_LUA) {
+#if defined(LUA_MODEL_SCRIPTS)
+    div_t qr = div(i-MIXSRC_FIRST_LUA, MAX_SCRIPT_OUTPUTS);
+    return scriptInputsOutputs[qr.quot].outputs[qr.rem].value;
+#else
+    return 0;
+#endif
+  }
+#endif
+  else if (i>=MIXSRC_FIRST_STICK && i<=MIXSRC_LAST_POT+NUM_MOUSE_ANALOGS) {
+    return calibratedAnalogs[i-MIXSRC_Rud];
+  }
+#if defined(ROTARY_ENCODERS)
+  else if (i <= MIXSRC_LAST_ROTARY_ENCODER) {
+    return getRotaryEncoder(i-MIXSRC_REa);
+  }
+#endif
+  else if (i == MIXSRC_MAX) {
+    return 1024;
+  }
+  else if (i <= MIXSRC_CYC3) {
+#if defined(HELI)
+    return cyc_anas[i - MIXSRC_CYC1];
+#else
+    return 0;
+#endif
+  }
+  else if (i <= MIXSRC_LAST_TRIM) {
+    return calc1000toRESX((int16_t)8 * getTrimValue(mixerCurrentFlightMode, i-MIXSRC_FIRST_TRIM));
+  }
+#if defined(PCBFLAMENCO)
+  else if (i==MIXSRC_SA) return (switchState(SW_SA0) ? -1024 : (switchState(SW_SA1) ? 0 : 1024));
+  else if (i==MIXSRC_SB) return (switchState(SW_SB0) ? -1024 : 1024);
+  else if (i==MIXSRC_SC) return (switchState(SW_SC0) ? -1024 : (switchState(SW_SC1) ? 0 : 1024));
+  else if (i==MIXSRC_SE) return (switchState(SW_SE0) ? -1024 : 1024);
+  else if (i==MIXSRC_SF) return (switchState(SW_SF0) ? -1024 : (switchState(SW_SF1) ? 0 : 1024));
+#elif defined(PCBTARANIS) || defined(PCBHORUS)
+  else if ((i >= MIXSRC_FIRST_SWITCH) && (i <= MIXSRC_LAST_SWITCH)) {
+    mixsrc_t sw = i-MIXSRC_FIRST_SWITCH;
+    if (SWITCH_EXISTS(sw)) {
+      return (switchState(3*sw) ? -1024 : (switchState(3*sw+1) ? 0 : 1024));
+    }
+    else {
+      return 0;
+    }
+  }
+#else
+  else if (i == MIXSRC_3POS) {
+    return (getSwitch(SW_ID0+1) ? -1024 : (getSwitch(SW_ID1+1) ? 0 : 1024));
+  }
+  else if (i < MIXSRC_SW1) {
+    return getSwitch(SWSRC_THR+i-MIXSRC_THR) ? 1024 : -1024;
+  }
+#endif
+  else if (i <= MIXSRC_LAST_LOGICAL_SWITCH) {
+    return getSwitch(SWSRC_FIRST_LOGICAL_SWITCH+i-MIXSRC_FIRST_LOGICAL_SWITCH) ? 1024 : -1024;
+  }
+  else if (i <= MIXSRC_LAST_TRAINER) {
+    int16_t x = ppmInput[i-MIXSRC_FIRST_TRAINER];
+    if (i<MIXSRC_FIRST_TRAINER+NUM_CAL_PPM) {
+      x -= g_eeGeneral.trainer.calib[i-MIXSRC_FIRST_TRAINER];
+    }
+    return x*2;
+  }
+  else if (i <= MIXSRC_LAST_CH) {
+    return ex_chans[i-MIXSRC_CH1];
+  }
+#if defined(GVARS)
+  else if (i <= MIXSRC_LAST_GVAR) {
+    return GVAR_VALUE(i-MIXSRC_GVAR1, getGVarFlightMode(mixerCurrentFlightMode, i - MIXSRC_GVAR1));
+  }
+#endif
+  else if (i == MIXSRC_TX_VOLTAGE) {
+    return g_vbat100mV;
+  }
+  else if (i < MIXSRC_FIRST_TIMER) {
+#if defined(RTCLOCK)
+    return (g_rtcTime % SECS_PER_DAY) / 60;
+#else
+    return 0;
+#endif
+  }
+  else if (i <= MIXSRC_LAST_TIMER) {
+    return timersStates[i-MIXSRC_FIRST_TIMER].val;
+  }
+  else if (i <= MIXSRC_LAST_TELEM) {
+    i -= MIXSRC_FIRST_TELEM;
+    div_t qr = div(i, 3);
+    TelemetryItem & telemetryItem = telemetryItems[qr.quot];
+    switch (qr.rem) {
+      case 1:
+        return telemetryItem.valueMin;
+      case 2:
+        return telemetryItem.valueMax;
+      default:
+        return telemetryItem.value;
+    }
+  }
+  else return 0;
+}
+
+TEST_F(MixerTest, getValueDispatch)
+{
+#if defined(HELI)
+  extern MIXER_THREAD_LOCAL int16_t cyc_anas[3];
+  for (int i=0; i<3; i++) {
+    cyc_anas[i] = 100 + i;
+  }
+#endif
+
+  for (int i=0; i<MAX_INPUTS; i++) {
+    anas[i] = 10*i - 500;
+  }
+#if defined(LUA_MODEL_SCRIPTS)
+  for (int i=0; i<MAX_SCRIPTS; i++) {
+    for (int j=0; j<MAX_SCRIPT_OUTPUTS; j++) {
+      scriptInputsOutputs[i].outputs[j].value = 100*i + j;
+    }
+  }
+#endif
+  for (int i=0; i<NUM_CALIBRATED_ANALOGS; i++) {
+    calibratedAnalogs[i] = 7*i - 300;
+  }
+  for (int i=0; i<NUM_STICKS; i++) {
+    setTrimValue(0, i, 3*i - 5);
+  }
+  for (int i=0; i<MAX_TRAINER_CHANNELS; i++) {
+    ppmInput[i] = 20*i - 80;
+  }
+  for (int i=0; i<NUM_CAL_PPM; i++) {
+    g_eeGeneral.trainer.calib[i] = i + 1;
+  }
+  for (int i=0; i<MAX_OUTPUT_CHANNELS; i++) {
+    ex_chans[i] = 30*i - 400;
+  }
+#if defined(GVARS)
+  for (int i=0; i<MAX_GVARS; i++) {
+    g_model.flightModeData[0].gvars[i] = i - 4;
+  }
+#endif
+  g_vbat100mV = 82;
+  for (int i=0; i<TIMERS; i++) {
+    timersStates[i].val = 60 + i;
+  }
+  for (int i=0; i<MAX_TELEMETRY_SENSORS; i++) {
+    telemetryItems[i].value = 1000 + i;
+    telemetryItems[i].valueMin = -1000 - i;
+    telemetryItems[i].valueMax = 2000 + i;
+  }
+  simuSetSwitch(0, -1);
+  simuSetSwitch(1, 0);
+  simuSetSwitch(2, 1);
+  g_model.logicalSw[0].func = LS_FUNC_VPOS;
+  g_model.logicalSw[0].v1 = MIXSRC_FIRST_STICK;
+  g_model.logicalSw[0].v2 = -10;
+  evalLogicalSwitches();
+
+  for (unsigned int i=0; i<=MIXSRC_LAST_TELEM+10; i++) {
+    EXPECT_EQ(getValueChain(i), getValue(i)) << "source " << i;
+  }
+}
+#endif
+
+#if defined(MIXER_THREADS)
+bool isFadeParallelizable(ACTIVE_PHASES_TYPE flightModes);
+
+// the outputs of each mixer run of a flight modes sequence, with the fades overlapping
+static std::vector<int16_t> runFadingFlightModes()
+{
+  static const struct {
+    int8_t switchPosition;
+    uint16_t runs;
+  } sequence[] = { { 0, 20 }, { -1, 6 }, { 1, 6 }, { -1, 8 }, { 0, 300 } };
+
+  std::vector<int16_t> result;
+  lastFlightMode = 255;
+  int run = 0;
+  for (auto & step: sequence) {
+    simuSetSwitch(0, step.switchPosition);
+    for (int i=0; i<step.runs; i++, run++) {
+      anaInValues[RUD_STICK] = (run * 37) % 2048 - 1024;
+      anaInValues[ELE_STICK] = (run * 53) % 2048 - 1024;
+      anaInValues[THR_STICK] = (run * 71) % 2048 - 1024;
+      evalMixes(1);
+      result.insert(result.end(), channelOutputs, channelOutputs + 4);
+    }
+  }
+  return result;
+}
+
+TEST_F(MixerTest, fadingFlightModesThreads)
+{
+  for (int p=0; p<3; p++) {
+    g_model.flightModeData[p].fadeIn = 5;
+    g_model.flightModeData[p].fadeOut = 5;
+  }
+  g_model.flightModeData[1].swtch = SWSRC_SA0;
+  g_model.flightModeData[2].swtch = SWSRC_SA2;
+
+  // the Ele input is only written in FM0
+  expoAddress(1)->flightModes = 0x06;
+
+  // each flight mode has its own mixes on CH1 and CH2, CH3 mixes CH1 and CH2
+  memclear(g_model.mixData, sizeof(g_model.mixData));
+  for (int p=0; p<3; p++) {
+    MixData * md = mixAddress(p);
+    md->destCh = 0;
+    md->srcRaw = MIXSRC_FIRST_INPUT + p;
+    md->weight = 100 - 40*p;
+    md->mltpx = MLTPX_ADD;
+    md->flightModes = 0x07 & ~(1 << p);
+  }
+  for (int p=0; p<3; p++) {
+    MixData * md = mixAddress(3+p);
+    md->destCh = 1;
+    md->srcRaw = MIXSRC_FIRST_INPUT + 1;
+    md->weight = 30*p - 50;
+    md->offset = 10*p;
+    md->mltpx = MLTPX_ADD;
+    md->flightModes = 0x07 & ~(1 << p);
+  }
+  for (int i=0; i<2; i++) {
+    MixData * md = mixAddress(6+i);
+    md->destCh = 2;
+    md->srcRaw = MIXSRC_CH1 + i;
+    md->weight = 50;
+    md->mltpx = MLTPX_ADD;
+  }
+  mixerProgramInvalidate();
+
+  // the fades weights are kept by evalMixes() from one test to the other, a first run ends all the fades
+  runFadingFlightModes();
+
+  std::vector<int16_t> sequential = runFadingFlightModes();
+
+  EXPECT_TRUE(isFadeParallelizable(0x07));
+  mixerThreadsStart(4);
+  std::vector<int16_t> parallel = runFadingFlightModes();
+  mixerThreadsStop();
+
+  ASSERT_EQ(sequential.size(), parallel.size());
+  for (unsigned int i=0; i<sequential.size(); i++) {
+    EXPECT_EQ(sequential[i], parallel[i]) << "run " << i/4 << " CH" << i%4+1;
+  }
+}
+#endif
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) OpenTX
+ *
+ * Based on code named
+ *   th9x - http://code.google.com/p/th9x
+ *   er9x - http://code.google.com/p/er9x
+ *   gruvin9x - http://code.google.com/p/gruvin9x
+ *
+ * License GPLv2: http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <string>
+#include "gtests.h"
+
+#if defined(SD_WRITE_QUEUE) && !defined(SIMU_DISKIO)
+// the SD write task isn't started in the gtests, sdWriteQueueFlush() writes the queue itself.
+// The files are written in the current directory through simufatfs.cpp
+
+static std::string readSdFile(const char * path)
+{
+  FIL file;
+  char buffer[64];
+  UINT read;
+  std::string result;
+  if (f_open(&file, path, FA_READ) != FR_OK) {
+    return "<missing>";
+  }
+  do {
+    f_read(&file, buffer, sizeof(buffer), &read);
+    result.append(buffer, read);
+  } while (read > 0);
+  f_close(&file);
+  return result;
+}
+
+TEST(SdWriteQueue, appendsOrder)
+{
+  FIL fileA, fileB;
+  ASSERT_EQ(FR_OK, f_open(&fileA, "sdqueue_a.txt", FA_CREATE_ALWAYS | FA_WRITE));
+  ASSERT_EQ(FR_OK, f_open(&fileB, "sdqueue_b.txt", FA_CREATE_ALWAYS | FA_WRITE));
+
+  EXPECT_TRUE(sdWriteQueueAppend(&fileA, "A1,", 3));
+  EXPECT_TRUE(sdWriteQueueAppend(&fileB, "B1,", 3));
+  EXPECT_TRUE(sdWriteQueueAppend(&fileA, "A2,", 3));
+
+  // more than the whole queue, the append waits for free chunks
+  std::string big;
+  for (int i=0; i<1000; i++) {
+    big += std::to_string(i) + ",";
+  }
+  EXPECT_TRUE(sdWriteQueueAppend(&fileB, big.data(), big.size()));
+
+  EXPECT_TRUE(sdWriteQueueAppend(&fileA, "A3", 2));
+  sdWriteQueueClose(&fileA);
+  sdWriteQueueClose(&fileB);
+  sdWriteQueueFlush();
+
+  EXPECT_FALSE(sdWriteQueueError(&fileA));
+  EXPECT_FALSE(sdWriteQueueError(&fileB));
+  EXPECT_EQ("A1,A2,A3", readSdFile("sdqueue_a.txt"));
+  EXPECT_EQ("B1," + big, readSdFile("sdqueue_b.txt"));
+
+  f_unlink("sdqueue_a.txt");
+  f_unlink("sdqueue_b.txt");
+}
+
+TEST(SdWriteQueue, appendsErrors)
+{
+  FIL fileA, fileB;
+  memclear(&fileA, sizeof(fileA));
+  memclear(&fileB, sizeof(fileB));
+
+  // neither file is open, the writes and the close fail in the SD write task
+  EXPECT_TRUE(sdWriteQueueAppend(&fileA, "A1", 2));
+  EXPECT_TRUE(sdWriteQueueAppend(&fileB, "B1", 2));
+  sdWriteQueueFlush();
+
+  // the error of the first file isn't replaced by the second one
+  EXPECT_FALSE(sdWriteQueueAppend(&fileA, "A2", 2));
+  EXPECT_FALSE(sdWriteQueueAppend(&fileB, "B2", 2));
+
+  sdWriteQueueClose(&fileA);
+  sdWriteQueueClose(&fileB);
+  sdWriteQueueFlush();
+
+  // the errors are reported once after the close
+  EXPECT_TRUE(sdWriteQueueError(&fileA));
+  EXPECT_FALSE(sdWriteQueueError(&fileA));
+  EXPECT_TRUE(sdWriteQueueError(&fileB));
+  EXPECT_FALSE(sdWriteQueueError(&fileB));
+
+  // only the close fails
+  sdWriteQueueClose(&fileA);
+  sdWriteQueueFlush();
+  EXPECT_TRUE(sdWriteQueueError(&fileA));
+  EXPECT_FALSE(sdWriteQueueError(&fileA));
+}
+
+#if !defined(EEPROM)
+TEST(SdWriteQueue, filesSnapshots)
+{
+  const uint8_t header[] = { 'H', ':' };
+  const uint8_t data1[] = { '1', '1', '1' };
+  const uint8_t data2[] = { '2', '2' };
+
+  // the second snapshot replaces the first one, which hasn't been written yet
+  EXPECT_EQ((const char *)NULL, sdWriteQueueFile("sdqueue_f.bin", header, sizeof(header), data1, sizeof(data1)));
+  EXPECT_EQ((const char *)NULL, sdWriteQueueFile("sdqueue_f.bin", header, sizeof(header), data2, sizeof(data2)));
+  sdWriteQueueFlush();
+  EXPECT_FALSE(isSdWriteQueueFileError());
+  EXPECT_EQ("H:22", readSdFile("sdqueue_f.bin"));
+
+  f_unlink("sdqueue_f.bin");
+}
+
+TEST(SdWriteQueue, filesErrors)
+{
+  const uint8_t header[] = { 'H', ':' };
+  const uint8_t data[] = { '1' };
+
+  EXPECT_EQ((const char *)NULL, sdWriteQueueFile("sdqueue_nodir/f1.bin", header, sizeof(header), data, sizeof(data)));
+  EXPECT_EQ((const char *)NULL, sdWriteQueueFile("sdqueue_nodir/f2.bin", header, sizeof(header), data, sizeof(data)));
+  sdWriteQueueFlush();
+
+  // both errors are kept until they are read
+  EXPECT_TRUE(isSdWriteQueueFileError());
+  EXPECT_NE((const char *)NULL, sdWriteQueueFileError("sdqueue_nodir/f2.bin"));
+  EXPECT_EQ((const char *)NULL, sdWriteQueueFileError("sdqueue_nodir/f2.bin"));
+  EXPECT_TRUE(isSdWriteQueueFileError());
+  EXPECT_NE((const char *)NULL, sdWriteQueueFileError(NULL));
+  EXPECT_FALSE(isSdWriteQueueFileError());
+}
+#endif
+#endif
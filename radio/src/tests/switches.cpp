@@ -153,6 +153,129 @@ TEST(getSwitch, inputWithTrim)
 }
 #endif
 
+#if defined(CPUARM)
+TEST(evalLogicalSwitches, dependencies)
+{
+  MODEL_RESET();
+  MIXER_RESET();
+
+  // L1 uses L2 (evaluated after it), L3 uses L1 (evaluated before it)
+  setLogicalSwitch(0, LS_FUNC_AND, SWSRC_SW2, SWSRC_NONE);
+  setLogicalSwitch(1, LS_FUNC_VPOS, MIXSRC_FIRST_STICK, 0);
+  setLogicalSwitch(2, LS_FUNC_AND, SWSRC_SW1, SWSRC_NONE);
+  setLogicalSwitch(3, LS_FUNC_VNEG, MIXSRC_FIRST_STICK+1, 0);
+
+  calibratedAnalogs[0] = -100;
+  calibratedAnalogs[1] = -100;
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW1), false);
+  EXPECT_EQ(getSwitch(SWSRC_SW2), false);
+  EXPECT_EQ(getSwitch(SWSRC_SW3), false);
+  EXPECT_EQ(getSwitch(SWSRC_SW4), true);
+
+  // L1 sees the new L2 state one cycle later, L3 in the same cycle than L1
+  calibratedAnalogs[0] = 100;
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW1), false);
+  EXPECT_EQ(getSwitch(SWSRC_SW2), true);
+  EXPECT_EQ(getSwitch(SWSRC_SW3), false);
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW1), true);
+  EXPECT_EQ(getSwitch(SWSRC_SW3), true);
+
+  // nothing changed
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW1), true);
+  EXPECT_EQ(getSwitch(SWSRC_SW2), true);
+  EXPECT_EQ(getSwitch(SWSRC_SW3), true);
+  EXPECT_EQ(getSwitch(SWSRC_SW4), true);
+
+  // only the second stick changed
+  calibratedAnalogs[1] = 100;
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW3), true);
+  EXPECT_EQ(getSwitch(SWSRC_SW4), false);
+
+  // model edit
+  setLogicalSwitch(3, LS_FUNC_VPOS, MIXSRC_FIRST_STICK+1, 0);
+  evalLogicalSwitches();
+  EXPECT_EQ(getSwitch(SWSRC_SW4), true);
+}
+
+#define LSW_SCENARIO_STEPS             80
+#define LSW_SCENARIO_SWITCHES          10
+
+// runs the same inputs sequence from a reset state, with the incremental
+// evaluation or with a full evaluation at each cycle
+void evalLogicalSwitchesScenario(bool full, bool states[LSW_SCENARIO_STEPS][LSW_SCENARIO_SWITCHES])
+{
+  extern void logicalSwitchesGraphInvalidate();
+
+  mixerCurrentFlightMode = 0;
+  logicalSwitchesReset();
+
+  for (int step=0; step<LSW_SCENARIO_STEPS; step++) {
+    calibratedAnalogs[0] = ((step / 3) % 2) ? 100 : -100;
+    calibratedAnalogs[1] = ((step / 5) % 3) ? -100 : 100;
+    calibratedAnalogs[2] = ((step / 4) % 5) * 400 - 800;
+    if (step >= 40 && step < 50)
+      mixerCurrentFlightMode = 1;
+    else if (step >= 60 && step < 64)
+      mixerCurrentFlightMode = 2;
+    else
+      mixerCurrentFlightMode = 0;
+
+    // the timers tick every other cycle, as the mixer runs faster than them
+    if (step % 2 == 0) {
+      logicalSwitchesTimerTick();
+    }
+    if (full) {
+      logicalSwitchesGraphInvalidate();
+    }
+    evalLogicalSwitches();
+
+    for (int i=0; i<LSW_SCENARIO_SWITCHES; i++) {
+      states[step][i] = getSwitch(SWSRC_SW1+i);
+    }
+  }
+
+  mixerCurrentFlightMode = 0;
+}
+
+TEST(evalLogicalSwitches, incrementalAndFull)
+{
+  MODEL_RESET();
+  MIXER_RESET();
+
+  setLogicalSwitch(0, LS_FUNC_VPOS, MIXSRC_FIRST_STICK, 0);
+  setLogicalSwitch(1, LS_FUNC_VPOS, MIXSRC_FIRST_STICK+1, 0);
+  setLogicalSwitch(2, LS_FUNC_TIMER, -127, -126, 0, 0, 0, SWSRC_SW2);
+  setLogicalSwitch(3, LS_FUNC_STICKY, SWSRC_SW1, SWSRC_SW2);
+  setLogicalSwitch(4, LS_FUNC_EDGE, SWSRC_SW1, -129, -1);
+  setLogicalSwitch(5, LS_FUNC_AND, SWSRC_SW1, SWSRC_NONE, 0, 4, 6);
+  setLogicalSwitch(6, LS_FUNC_DIFFEGREATER, MIXSRC_FIRST_STICK+2, 30);
+  setLogicalSwitch(7, LS_FUNC_OR, SWSRC_SW4, SWSRC_SW9);
+  setLogicalSwitch(8, LS_FUNC_AND, SWSRC_SW3, SWSRC_SW5);
+  setLogicalSwitch(9, LS_FUNC_VPOS, MIXSRC_FIRST_STICK+1, 0, 0, 0, 0, SWSRC_SW4);
+
+  static bool incremental[LSW_SCENARIO_STEPS][LSW_SCENARIO_SWITCHES];
+  static bool full[LSW_SCENARIO_STEPS][LSW_SCENARIO_SWITCHES];
+  evalLogicalSwitchesScenario(false, incremental);
+  evalLogicalSwitchesScenario(true, full);
+
+  for (int i=0; i<LSW_SCENARIO_SWITCHES; i++) {
+    bool wasOn = false, wasOff = false;
+    for (int step=0; step<LSW_SCENARIO_STEPS; step++) {
+      EXPECT_EQ(incremental[step][i], full[step][i]) << "L" << i+1 << " at step " << step;
+      wasOn |= full[step][i];
+      wasOff |= !full[step][i];
+    }
+    // the scenario must toggle each logical switch to be meaningful
+    EXPECT_TRUE(wasOn && wasOff) << "L" << i+1;
+  }
+}
+#endif
+
 #if defined(PCBTARANIS) || defined(PCBHORUS)
 TEST(evalLogicalSwitches, playFile)
 {
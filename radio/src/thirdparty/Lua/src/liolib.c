@@ -590,6 +590,7 @@ static int f_write (lua_State *L) {
 #else
 static int io_write (lua_State *L) {
   FILE *f = tofile(L);
+  lua__filewritten();  /* the file may be a script source */
   lua_pushvalue(L, 1);  /* push file at the stack top (to be returned) */
   return g_write(L, f, 2);
 }
@@ -421,6 +421,7 @@ struct lua_Debug {
 #if defined(USE_FATFS)
   #include "FatFs/ff.h"
   int lua__getc(FIL *f);
+  void lua__filewritten(void);
   #define lua_getc(f) lua__getc(&f)
   #define lua_fclose  f_close
 #else